@@ -29,6 +29,7 @@
 #define CDIO__PARANOIA__CDDA_H_
 
 #include <cdio/cdio.h>
+#include <limits.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -76,7 +77,93 @@ typedef struct TOC_s {
 /** For compatibility. TOC is deprecated, use TOC_t instead. */
 #define TOC TOC_t
 
-/** \brief Structure for cdparanoia's CD-ROM access */
+/** Number of buckets in each series of a cdda_latency_t.  Bucket 0
+    counts read commands that took under a microsecond and bucket i
+    those that took from 2^(i-1) up to 2^i microseconds; the last one
+    also counts everything slower, from about 4 seconds on.
+*/
+#define CDDA_LATENCY_BUCKETS 24
+
+/** \brief The kinds of read command a cdda_latency_t keeps apart. */
+typedef enum {
+  CDDA_LATENCY_SEEK       = 0, /**< read that doesn't start where the
+                                    previous one ended */
+  CDDA_LATENCY_SEQUENTIAL = 1, /**< read that does */
+  CDDA_LATENCY_RETRY      = 2, /**< read reissued after an error */
+  CDDA_LATENCY_SERIES     = 3  /**< number of series */
+} cdda_latency_series_t;
+
+/** \brief How long a drive's read commands have taken.
+
+    Kept for every drive from the time it is opened; see
+    cdio_cddap_latency().
+*/
+typedef struct cdda_latency_s {
+  long      count[CDDA_LATENCY_SERIES][CDDA_LATENCY_BUCKETS];
+                           /**< log2 histogram of each series */
+  long long total_us[CDDA_LATENCY_SERIES]; /**< sum of each series */
+  long      max_us[CDDA_LATENCY_SERIES];   /**< slowest of each series */
+  long      retries;       /**< read commands reissued after an error */
+  long      reductions;    /**< retries that asked for fewer sectors */
+} cdda_latency_t;
+
+/** Bytes of C2 error pointers per sector: one bit for each of the
+    CDIO_CD_FRAMESIZE_RAW bytes of audio, the first byte's in the most
+    significant bit.  See cdio_cddap_read_c2().
+*/
+#define CDDA_C2_SIZE (CDIO_CD_FRAMESIZE_RAW / 8)
+
+/** \brief A stretch of disc a drive had trouble reading.
+
+    See cdio_cddap_trouble().
+*/
+typedef struct cdda_range_s {
+  lsn_t begin;   /**< first sector */
+  lsn_t end;     /**< one past the last sector */
+  long  sectors; /**< most sectors per read command used there */
+} cdda_range_t;
+
+/** A cdda_profile_t field that hasn't been measured or set. */
+#define CDDA_PROFILE_UNKNOWN LONG_MIN
+
+/** \brief What is known about a drive model, kept between runs.
+
+    A profile database is a text file holding one of these for each
+    drive model seen, so that what a drive had to be probed for once
+    doesn't have to be probed for on every disc.  See
+    cdio_cddap_profile_use().
+*/
+typedef struct cdda_profile_s {
+  char id[256];            /**< vendor, model and firmware revision as
+                                the drive reports them */
+  long bigendianp;         /**< as in cdrom_drive_t */
+  long nsectors;           /**< sectors per read */
+  long cache_sectors;      /**< readahead cache size, as cd-paranoia -A
+                                measures it; 0 means no cache */
+  long cache_granularity;  /**< cache tail granularity, ditto */
+  long sample_offset;      /**< read offset in samples; kept for the
+                                application, the library doesn't use it */
+  long dynoverlap;         /**< search overlap paranoia settled on, in
+                                samples */
+  long dyndrift;           /**< drift paranoia settled on, in samples */
+} cdda_profile_t;
+
+/** \brief Structure for cdparanoia's CD-ROM access
+
+   Thread safety: the library keeps no global state on the read path,
+   so different cdrom_drive_t objects may be opened, read and closed
+   concurrently from different threads without any locking.
+
+   A single cdrom_drive_t must only be used by one thread at a time.
+   The one exception is the error and message log: cdda_errors() and
+   cdda_messages() may be called from any thread while another thread
+   is reading (this is what lets a paranoia reader thread, see
+   cdio_paranoia_threaded(), read while the caller collects messages).
+
+   Changing settings such as cdda_verbose_set(), nsectors or
+   i_test_flags while another thread is reading from the same drive
+   is not supported.
+*/
 struct cdrom_drive_s {
 
   CdIo_t *p_cdio;
@@ -137,6 +224,20 @@ struct cdrom_drive_s {
 		       the flag masks to simulate a particular kind of
 		       failure.    */
 
+  /* The fields below are private to the library.  They hold what
+     used to be static state so that separate drives can be used from
+     separate threads; see the thread-safety notes above. */
+  uint64_t rand_state; /**< random state for simulated jitter */
+  void *msg_lock;      /**< guards errorbuf and messagebuf */
+  void *test_state;    /**< state of a simulated drive, see
+                            cdio_cddap_identify_sim() */
+  cdda_latency_t latency; /**< see cdio_cddap_latency() */
+  void *read_ctl;      /**< read size control, see cdio_cddap_trouble() */
+  int c2;              /**< 1 if the drive returns C2 error pointers,
+                            -1 if it doesn't, 0 if not known yet */
+  lsn_t read_next;     /**< sector after the last one read, or -1 */
+  char *profile_path;  /**< see cdio_cddap_profile_use() */
+  cdda_profile_t *profile;
 };
 
 
@@ -212,6 +313,118 @@ extern cdrom_drive_t *cdio_cddap_identify(const char *psz_device,
 cdrom_drive_t *cdio_cddap_identify_cdio(CdIo_t *p_cdio,
 					int messagedest, char **ppsz_messages);
 
+/** \brief How a simulated drive misbehaves.
+
+    A simulated drive reads a disc image through libcdio (for example
+    a .cue/.bin pair) and deliberately returns data the way a bad real
+    drive would, so that paranoia can be regression-tested and
+    benchmarked without a disc.  Every random choice is drawn from
+    seed, so the same image, settings and sequence of reads always
+    return the same data.
+
+    Percentages run from 0 to 100.  A zero field turns that fault off,
+    so an all-zero cdda_sim_t is a perfect drive.
+*/
+typedef struct cdda_sim_s {
+  unsigned long seed;   /**< seeds every random choice below */
+  int jitter_bytes;     /**< reads start up to this many bytes early
+                             or late */
+  int jitter_percent;   /**< chance a read (or fragment) lands off;
+                             the rest of the read follows it */
+  int frag_bytes;       /**< deliver each read in fragments of at most
+                             this many bytes, each jittered on its own */
+  int dropdupe_percent; /**< chance a read (or fragment) drops or
+                             duplicates one 16-bit sample */
+  int scratches;        /**< number of scratched spots on the disc;
+                             they read back as noise every time */
+  int scratch_bytes;    /**< length of each scratch; 0 means 1100 */
+  const lsn_t *unreadable; /**< sectors that never read; copied */
+  int n_unreadable;     /**< number of entries in unreadable */
+  int max_sectors;      /**< most sectors one read returns; 0 is no
+                             limit beyond nsectors */
+  int short_percent;    /**< chance a read returns a sector short */
+  long latency_us;      /**< time each read from the disc takes */
+  long seek_us;         /**< extra time when a read doesn't continue
+                             where the last one stopped */
+  const lsn_t *slow;    /**< sectors that read, but slowly; copied */
+  int n_slow;           /**< number of entries in slow */
+  long slow_us;         /**< extra time a read from the disc takes for
+                             each slow sector in it */
+  int cache_sectors;    /**< sectors the drive reads ahead and caches;
+                             re-reads inside the cache return exactly
+                             what was cached, instantly */
+  int c2;               /**< nonzero to return C2 error pointers from
+                             cdio_cddap_read_c2(), flagging the bytes
+                             scratches hit; jitter and dropped samples
+                             go unflagged, as on a real drive */
+} cdda_sim_t;
+
+/*!
+  Fill in a simulated-drive model equivalent to the jitter,
+  fragmentation and underrun test flags of paranoia_jitter_t.
+
+  @param p_sim model to fill in; all other fields are cleared
+  @param i_test_flags CDDA_TEST_* flags, as for i_test_flags
+*/
+extern void cdio_cddap_sim_init(cdda_sim_t *p_sim, int i_test_flags);
+
+/*!
+  Get a simulated drive reading the disc image psz_image.  Reads
+  misbehave as p_sim describes; pass NULL for a perfect drive.  Open
+  and close it as any other drive.
+
+  When using CDDA_MESSAGE_LOGIT, free the message buffer with
+  cdio_cddap_free_messages() after use.
+
+  @return the drive, or NULL if the image can't be opened.
+*/
+extern cdrom_drive_t *cdio_cddap_identify_sim(const char *psz_image,
+                                              const cdda_sim_t *p_sim,
+                                              int messagedest,
+                                              char **ppsz_messages);
+
+/*!
+  Change how simulated drive d misbehaves from the next read on.  The
+  random generator is reseeded from p_sim->seed and the drive cache
+  is emptied.
+
+  @return 0, or -405 if d is not a simulated drive.
+*/
+extern int cdio_cddap_sim_set(cdrom_drive_t *d, const cdda_sim_t *p_sim);
+
+/*!
+  Use the drive profile database in the file psz_path for d, which
+  must not be open yet.  d's entry is read now, if there is one, and
+  when d is opened its endianness and read size are taken from it
+  rather than probed for; cdio_paranoia_init() likewise starts from
+  the cache size, overlap and drift it holds.  Whatever is then
+  measured is recorded in the entry (see cdio_cddap_profile()) and
+  written back by cdio_cddap_profile_save().
+
+  Drives that don't report a vendor and model are keyed by device
+  name instead.
+
+  @return 1 if d has an entry, 0 if it doesn't yet, or -1 if the
+  database exists but can't be read.
+*/
+extern int cdio_cddap_profile_use(cdrom_drive_t *d, const char *psz_path);
+
+/*!
+  Get d's entry in its profile database, for the application to read
+  or to fill in.  Fields nobody has measured are CDDA_PROFILE_UNKNOWN.
+
+  @return the entry, or NULL if cdio_cddap_profile_use() wasn't called.
+*/
+extern cdda_profile_t *cdio_cddap_profile(cdrom_drive_t *d);
+
+/*!
+  Write d's entry back to its profile database, replacing the one
+  there, if any.  Other drives' entries are kept as they are.
+
+  @return 0, or -1 with errno set if the database can't be written.
+*/
+extern int cdio_cddap_profile_save(cdrom_drive_t *d);
+
 /** informational functions */
 
 extern const char *cdio_cddap_version(void);
@@ -268,6 +481,62 @@ extern long    cdio_cddap_read(cdrom_drive_t *d, void *p_buffer,
 extern long    cdio_cddap_read_timed(cdrom_drive_t *d, void *p_buffer,
 				     lsn_t beginsector, long sectors, int *milliseconds);
 
+/*!
+  Read audio like cdio_cddap_read(), along with the C2 error pointers
+  the drive reports for it: for each sector read, CDDA_C2_SIZE bytes
+  in which a set bit marks a byte of audio the drive could not
+  correct.  Whether d returns them at all is found out on the first
+  call, with a one-sector read at beginsector.
+
+  @param d drive
+  @param p_buffer filled in with the audio
+  @param p_c2 filled in with CDDA_C2_SIZE bytes per sector read
+  @param beginsector first sector to read
+  @param sectors sectors wanted; as with cdio_cddap_read(), fewer may
+  be read
+  @return sectors read, -405 if d doesn't return C2 error pointers,
+  or another negative error code
+*/
+extern long    cdio_cddap_read_c2(cdrom_drive_t *d, void *p_buffer,
+				  unsigned char *p_c2, lsn_t beginsector,
+				  long sectors);
+
+/*!
+  Get how long d's read commands have taken since it was opened, as
+  a histogram for each of seeks, sequential reads and retries, along
+  with how many commands were retried and how many of those retries
+  shrank the read.  Like the other settings, don't call this while
+  another thread is reading from d.
+
+  @param d drive
+  @param p_latency filled in with the totals
+*/
+extern void    cdio_cddap_latency(const cdrom_drive_t *d,
+				  cdda_latency_t *p_latency);
+
+/*!
+  Get the stretches of disc d had trouble reading since it was opened.
+
+  Each read command asks for up to nsectors sectors.  A command that
+  fails is retried with half as many, and the stretch it covered is
+  remembered together with the size that then worked.  Later reads
+  there start at that size, and reads that would run into it stop
+  short of it, while elsewhere clean commands soon grow back to
+  nsectors.  Reads that succeed but take many times longer than
+  usual are remembered the same way, and a clean read at the start
+  of a stretch shortens it.  Up to 32 stretches are kept.  A sector
+  that still fails after its retries is one too, and a read asking
+  for it straight after fails at once.
+
+  @param d drive
+  @param p_ranges filled in with up to i_max stretches
+  @param i_max size of p_ranges
+  @return the number of stretches remembered, which may be more than
+  i_max
+*/
+extern int     cdio_cddap_trouble(const cdrom_drive_t *d,
+				  cdda_range_t *p_ranges, int i_max);
+
 /*! Return the lsn for the start of track i_track */
 extern lsn_t   cdio_cddap_track_firstsector(cdrom_drive_t *d,
 				      track_t i_track);
@@ -397,6 +666,12 @@ const char *strerror_tr[]={
 /** For compatibility with good ol' paranoia */
 #define cdda_find_a_cdrom       cdio_cddap_find_a_cdrom
 #define cdda_identify           cdio_cddap_identify
+#define cdda_identify_sim       cdio_cddap_identify_sim
+#define cdda_sim_init           cdio_cddap_sim_init
+#define cdda_sim_set            cdio_cddap_sim_set
+#define cdda_profile_use        cdio_cddap_profile_use
+#define cdda_profile            cdio_cddap_profile
+#define cdda_profile_save       cdio_cddap_profile_save
 #define cdda_version            cdio_cddap_version
 #define cdda_speed_set          cdio_cddap_speed_set
 #define cdda_verbose_set        cdio_cddap_verbose_set
@@ -406,6 +681,9 @@ const char *strerror_tr[]={
 #define cdda_open               cdio_cddap_open
 #define cdda_read               cdio_cddap_read
 #define cdda_read_timed         cdio_cddap_read_timed
+#define cdda_read_c2            cdio_cddap_read_c2
+#define cdda_latency            cdio_cddap_latency
+#define cdda_trouble            cdio_cddap_trouble
 #define cdda_track_firstsector  cdio_cddap_track_firstsector
 #define cdda_track_lastsector   cdio_cddap_track_lastsector
 #define cdda_tracks             cdio_cddap_tracks
@@ -87,6 +87,127 @@ typedef enum  {
   PARANOIA_CB_FINISHED        /**< Finished writing "*" */
 } paranoia_cb_mode_t;
 
+/**
+   Per-sector status flags reported by cdio_paranoia_read_batch().
+   A sector with none of these set was verified normally.
+*/
+typedef enum  {
+  PARANOIA_SECTOR_OK         = 0x00, /**< Verified */
+  PARANOIA_SECTOR_SKIPPED    = 0x01, /**< May contain data paranoia gave up
+                                          verifying (a 'V' in cd-paranoia) */
+  PARANOIA_SECTOR_UNVERIFIED = 0x02  /**< Read with verification and
+                                          overlap checking disabled */
+} paranoia_sector_status_t;
+
+/**
+   A run of verified sectors lent out by cdio_paranoia_borrow().  The
+   samples stay valid, and unchanged, until the span is given back with
+   cdio_paranoia_release().
+*/
+typedef struct paranoia_span_s {
+  int16_t *samples; /**< sectors * CD_FRAMEWORDS samples */
+  lsn_t    lsn;     /**< first sector of the span */
+  long     sectors; /**< number of sectors in the span */
+  void    *pin;     /**< private to libcdio_paranoia */
+} paranoia_span_t;
+
+/**
+   Sectors first through last, inclusive; see cdio_paranoia_recheck().
+*/
+typedef struct paranoia_range_s {
+  lsn_t first;
+  lsn_t last;
+} paranoia_range_t;
+
+/**
+   Checksums of a track, added up as it is written out; see
+   cdio_paranoia_checksum_init().
+*/
+typedef struct paranoia_checksum_s {
+  uint32_t crc32;    /**< CRC-32 of the bytes, as zlib computes it */
+  uint32_t ar_v1;    /**< AccurateRip v1 checksum */
+  uint32_t ar_v2;    /**< AccurateRip v2 checksum */
+  uint32_t samples;  /**< stereo samples added so far */
+  uint32_t ar_first; /**< first sample, counting from 1, that
+                          AccurateRip counts */
+  uint32_t ar_last;  /**< last sample that AccurateRip counts */
+  int bigendian;     /**< samples are big-endian */
+} paranoia_checksum_t;
+
+/**
+   Flags for cdio_paranoia_checksum_init().
+*/
+typedef enum  {
+  PARANOIA_CHECKSUM_FIRST     = 0x01, /**< the disc's first track, whose
+                                           first five sectors AccurateRip
+                                           leaves out */
+  PARANOIA_CHECKSUM_LAST      = 0x02, /**< the disc's last track, whose
+                                           last five it leaves out */
+  PARANOIA_CHECKSUM_BIGENDIAN = 0x04  /**< samples are big-endian */
+} paranoia_checksum_flags_t;
+
+/**
+   Kinds of sample index that can be passed to cdio_paranoia_sortindex().
+*/
+typedef enum  {
+  PARANOIA_SORTINDEX_BUCKETS = 0, /**< Per-value linked lists (default) */
+  PARANOIA_SORTINDEX_SORTED  = 1  /**< Compact (value, position) array,
+                                       searched by bisection */
+} paranoia_sortindex_t;
+
+/**
+   Running totals kept by every paranoia object, returned by
+   cdio_paranoia_get_stats().  They start at zero when the object is
+   created and are never reset; dynoverlap, dyndrift, cache_model,
+   fragments and retired_buffers describe its current state
+   instead.
+
+   The time_ fields are nanoseconds of wall time spent in each phase
+   of cdio_paranoia_read_limited(), which all the read functions use
+   to extend the verified data.  time_total covers the whole of every
+   call, and of cdio_paranoia_read_batch() and cdio_paranoia_borrow()
+   handing out what was already verified; time_read is spent getting data from the drive (with a reader
+   thread, waiting for it), and includes time_seek.  time_sort is
+   part of time_stage1 and time_stage2, and time_callback is also
+   part of whichever phase made the call.  Time outside time_total
+   is the application's own, writing the output for instance.
+*/
+typedef struct paranoia_stats_s {
+  long      sectors_returned; /**< verified sectors handed to the caller */
+  long      drive_reads;      /**< low-level read requests to the drive */
+  long      sectors_read;     /**< sectors those requests returned */
+  long      sectors_reread;   /**< ... of which the drive had been asked
+                                   for already */
+  long long bytes_read;       /**< bytes transferred from the drive */
+  long      read_errors;      /**< requests that returned short */
+  long      cache_seeks;      /**< seeks made to flush the drive's cache */
+  long      stage1_matches;   /**< runs verified by comparing two reads */
+  long      stage2_merges;    /**< verified runs merged into the output */
+  long      fixup_edge;       /**< jitter corrected at a read's edge */
+  long      fixup_atom;       /**< jitter corrected inside a read */
+  long      fixup_dropped;    /**< rifts of dropped samples repaired */
+  long      fixup_duped;      /**< rifts of duplicated samples repaired */
+  long      skips;            /**< times verification gave up on a spot */
+  long      c2_sectors;       /**< sectors read with C2 error pointers */
+  long      c2_flagged;       /**< ... of which the drive flagged errors
+                                   in */
+  long long time_total;       /**< in the read functions */
+  long long time_read;        /**< reading from the drive */
+  long long time_seek;        /**< seeking to flush the drive's cache */
+  long long time_stage1;      /**< verifying reads against each other */
+  long long time_stage2;      /**< merging verified runs into the output */
+  long long time_sort;        /**< building sample indexes for searches */
+  long long time_trim;        /**< dropping data behind the cursor */
+  long long time_callback;    /**< in the caller's callback */
+  long      dynoverlap;       /**< current search overlap, in samples */
+  long      dyndrift;         /**< current drift correction, in samples */
+  long      cache_model;      /**< current drive cache model, in sectors */
+  long      fragments;        /**< verified runs waiting to be merged */
+  long      peak_memory;      /**< most bytes ever held in sample buffers */
+  long      retired_buffers;  /**< buffers the root has moved off that
+                                   unreleased borrowed spans still hold */
+} paranoia_stats_t;
+
   extern const char *paranoia_cb_mode2str[];
 
 #ifdef __cplusplus
@@ -178,6 +299,77 @@ extern "C" {
 							   paranoia_cb_mode_t),
 					     int max_retries);
 
+  /*!
+    Reads the next sectors of audio data into a caller-supplied
+    buffer.  This is the same as calling cdio_paranoia_read_limited()
+    (sectors) times and copying out each result, except that sectors
+    already verified are copied out of paranoia's cache in one go.
+
+    @param p paranoia object.
+
+    @param buffer where to put the samples; room for at least
+    (sectors) * CDIO_CD_FRAMESIZE_RAW bytes.
+
+    @param sectors number of sectors to read.
+
+    @param status if not NULL, gets one paranoia_sector_status_t
+    bitmask per sector read.
+
+    @param callback callback routine which gets called with the status
+    on each read.
+
+    @param max_retries number of times to try re-reading a block before
+    failing.
+
+    @return the number of sectors read, which is less than (sectors)
+    only if cdio_paranoia_read_limited() would have failed on the next
+    one; or -1 (with errno set) if not even the first could be read.
+  */
+  extern long cdio_paranoia_read_batch(cdrom_paranoia_t *p, int16_t *buffer,
+                                       long sectors, unsigned char *status,
+                                       void(*callback)(long int,
+                                                       paranoia_cb_mode_t),
+                                       int max_retries);
+
+  /*!
+    Borrow up to (sectors) verified sectors straight out of paranoia's
+    internal buffer, without copying them.
+
+    The span must be handed back with cdio_paranoia_release(); several
+    spans may be outstanding at once, and reading carries on normally
+    meanwhile.  Until a span is released paranoia can't trim the data
+    it covers, so release spans promptly.
+
+    @param p paranoia object.
+
+    @param sectors the most sectors wanted.
+
+    @param span filled in with the borrowed samples.
+
+    @param callback callback routine which gets called with the status
+    on each read.
+
+    @param max_retries number of times to try re-reading a block before
+    failing.
+
+    @return the number of sectors borrowed (at least 1, never more than
+    sectors), 0 if (sectors) < 1, or -1 (with errno set) on failure.
+  */
+  extern long cdio_paranoia_borrow(cdrom_paranoia_t *p, long sectors,
+                                   paranoia_span_t *span,
+                                   void(*callback)(long int,
+                                                   paranoia_cb_mode_t),
+                                   int max_retries);
+
+  /*!
+    Give back a span obtained from cdio_paranoia_borrow().  Its samples
+    must not be used afterwards.  Releasing an empty span does nothing.
+
+    @param p    paranoia object the span was borrowed from.
+    @param span span to release; it is reset to empty.
+  */
+  extern void cdio_paranoia_release(cdrom_paranoia_t *p,
+                                    paranoia_span_t *span);
 
 /*! a temporary hack */
   extern void cdio_paranoia_overlapset(cdrom_paranoia_t *p,long overlap);
@@ -196,6 +388,234 @@ extern "C" {
    */
   extern int cdio_paranoia_cachemodel_size(cdrom_paranoia_t *p,int sectors);
 
+  /*!
+    Set or query whether the cache model follows the drive.  When on,
+    the seeks made to flush the drive's cache are timed: a seek that
+    should have missed the cache but was answered at once grows the
+    model, and re-reads the model expected to hit the cache but that
+    had to go to the disc shrink it.  The model stays between 188
+    sectors and the default of 1200, and reads and the sample index
+    used during verification shrink with it.
+
+    Only drives whose reads take measurable time, real drives and
+    simulated ones with latency, can be followed.
+
+    @param p     paranoia object
+    @param adapt 1 to follow the drive, 0 to keep the model at the size
+                 set with cdio_paranoia_cachemodel_size() (the default),
+                 -1 to query without changing it
+
+    @return      setting before the call
+   */
+  extern int cdio_paranoia_cachemodel_adapt(cdrom_paranoia_t *p, int adapt);
+
+  /*!
+    Set or query the kind of index used to find matching samples
+    during verification.
+
+    @param p    paranoia object
+    @param type PARANOIA_SORTINDEX_BUCKETS (the default) or
+                PARANOIA_SORTINDEX_SORTED (pass -1 to query the current
+                index without changing it)
+
+    @return     index type before the call
+   */
+  extern int cdio_paranoia_sortindex(cdrom_paranoia_t *p, int type);
+
+  /*!
+    Set or query whether verification trusts the drive's C2 error
+    pointers.  When on, and PARANOIA_MODE_VERIFY is set, sectors are
+    read together with the pointers, and samples the drive reports no
+    C2 error in are taken as verified from a single read.  Only the
+    samples it flags are read again and compared as usual, so a clean
+    disc is read about once instead of at least twice.
+
+    This trusts the drive to stream accurately as well: C2 errors say
+    nothing of samples dropped or jittered between read commands, so
+    those go unnoticed.  Whether the drive returns C2 error pointers
+    is found out here, with a one-sector read at the current position;
+    drives that don't are read as usual.
+
+    @param p   paranoia object
+    @param use 1 to trust C2 error pointers, 0 not to (the default),
+               -1 to query without changing it
+
+    @return    setting before the call
+   */
+  extern int cdio_paranoia_c2(cdrom_paranoia_t *p, int use);
+
+  /*!
+    Start or stop keeping a checksum of every sector the read functions
+    hand out, for cdio_paranoia_recheck().  Starting discards any kept
+    so far; sectors are counted from the first one handed out after
+    that, and any before it are ignored.
+
+    Together these make a fast two-pass rip: read the span once with
+    PARANOIA_MODE_DISABLE and checksums on, writing it out as usual;
+    have cdio_paranoia_recheck() read it again the same way; and rip
+    only the ranges where the two reads disagree with full paranoia,
+    using cdio_paranoia_reread(), writing them over what was written
+    the first time.  A drive that reads the same wrong samples twice,
+    or loses its place the same way twice, gets past this, so it suits
+    drives known to stream accurately.
+
+    @param p  paranoia object
+    @param on 1 to start, 0 to stop and discard the checksums
+
+    @return 0, or -1 if there is not enough memory
+   */
+  extern int cdio_paranoia_checksums(cdrom_paranoia_t *p, int on);
+
+  /*!
+    Read every sector checksummed since cdio_paranoia_checksums() again,
+    with verification off, and find where the two reads disagree.
+    Sectors skipped either time count as disagreeing.  Ranges closer
+    together than a re-read would be anyway are merged.  The mode,
+    range and position of p are left as they were, and the checksums
+    are kept, so the sectors re-read are not checksummed again.
+
+    @param p           paranoia object
+    @param p_ranges    filled in with up to i_max ranges
+    @param i_max       size of p_ranges
+    @param callback    as for cdio_paranoia_read_limited()
+    @param max_retries as for cdio_paranoia_read_limited()
+
+    @return number of ranges found, which may be more than i_max, or
+    -1 (with errno set) if reading failed
+   */
+  extern int cdio_paranoia_recheck(cdrom_paranoia_t *p,
+                                   paranoia_range_t *p_ranges, int i_max,
+                                   void (*callback)(long int,
+                                                    paranoia_cb_mode_t),
+                                   int max_retries);
+
+  /*!
+    Read a range again in p's current mode, usually full paranoia.
+    Reads reach no more than a few sectors beyond either end of it,
+    rather than the usual cache model's worth.  The range and position
+    of p are left as they were.
+
+    @param p           paranoia object
+    @param range       sectors to read
+    @param p_buffer    filled in with them, CDIO_CD_FRAMESIZE_RAW bytes
+                       each
+    @param p_status    as for cdio_paranoia_read_batch(); may be NULL
+    @param callback    as for cdio_paranoia_read_limited()
+    @param max_retries as for cdio_paranoia_read_limited()
+
+    @return sectors read, or -1 (with errno set) on error
+   */
+  extern long cdio_paranoia_reread(cdrom_paranoia_t *p,
+                                   const paranoia_range_t *range,
+                                   int16_t *p_buffer,
+                                   unsigned char *p_status,
+                                   void (*callback)(long int,
+                                                    paranoia_cb_mode_t),
+                                   int max_retries);
+
+  /*!
+    Set or query whether places that won't verify are put off until
+    later.  Usually cdio_paranoia_read_limited() keeps reading around
+    a place it can't verify, widening its search as it goes, until
+    it verifies or max_retries runs out, and the drive seeks back and
+    forth over it all that time.  With this on, it gives up after
+    (retries) reads that get it no further, fills in the sectors as
+    it would when skipping, flagging them PARANOIA_SECTOR_SKIPPED,
+    and queues them for cdio_paranoia_deferred().  Reading then goes
+    on past them.
+
+    Rip each queued range again with cdio_paranoia_reread(), which
+    never defers, and write it over what was handed out the first
+    time.  A scratch is then read over once on the way through, and
+    ripped properly in one go at the end, perhaps with the drive
+    slowed down, instead of being retried in place.
+
+    @param p       paranoia object
+    @param retries reads without progress before putting a place off,
+                   0 not to (the default), or -1 to query without
+                   changing it
+
+    @return setting before the call
+   */
+  extern int cdio_paranoia_defer(cdrom_paranoia_t *p, int retries);
+
+  /*!
+    Take ranges queued by cdio_paranoia_defer() off the queue, oldest
+    first.  Nearby ranges are merged as they are queued.
+
+    @param p        paranoia object
+    @param p_ranges filled in with up to i_max ranges
+    @param i_max    size of p_ranges
+
+    @return ranges taken, 0 once the queue is empty, or -1 (with errno
+    set) if a range was lost for lack of memory since the last call
+   */
+  extern int cdio_paranoia_deferred(cdrom_paranoia_t *p,
+                                    paranoia_range_t *p_ranges, int i_max);
+
+  /*!
+    Start the checksums of a track.
+
+    @param c       checksums to start
+    @param sectors length of the track
+    @param flags   paranoia_checksum_flags_t bits
+   */
+  extern void cdio_paranoia_checksum_init(paranoia_checksum_t *c,
+                                          long sectors, int flags);
+
+  /*!
+    Add the next samples of a track to its checksums.  Buffers can be
+    any size, but must hold whole stereo samples, 4 bytes each.  The
+    CRC-32 is of the bytes as given; the AccurateRip checksums are of
+    the samples, and so are the same whichever byte order they are in.
+
+    @param c     checksums from cdio_paranoia_checksum_init()
+    @param buf   samples
+    @param bytes size of buf
+   */
+  extern void cdio_paranoia_checksum_add(paranoia_checksum_t *c,
+                                         const void *buf, long bytes);
+
+  /*!
+    Turn the background reader thread on or off, or query it.
+
+    With the thread on, drive reads for the next few blocks are issued
+    while the sectors already read are being verified, so that the
+    drive and the CPU work at the same time.  Reads are planned exactly
+    as they would be otherwise; one that turns out not to fit what
+    verification needs next is discarded and made again synchronously.
+    Callbacks are still made from the calling thread.
+
+    A cdrom_paranoia object with the thread on must still only be used
+    from one thread at a time, and its cdrom_drive must not be read
+    from directly.
+
+    @param p     paranoia object
+    @param depth number of block reads to keep queued ahead; 0 turns the
+                 thread off (the default) and -1 queries the current
+                 depth without changing it.  Values above 8 are
+                 treated as 8.
+
+    @return depth before the call, or -1 (with errno set) if the thread
+    could not be started, for example because this build has no thread
+    support.
+   */
+  extern int cdio_paranoia_threaded(cdrom_paranoia_t *p, int depth);
+
+  /*!
+    Get the running totals kept by a paranoia object.  They are kept
+    whether or not a callback is installed, and may be read at any
+    time, though not while another thread is using the object.
+
+    Rereads per returned sector, for instance, is
+    (sectors_read - sectors_returned) / sectors_returned.
+
+    @param p     paranoia object
+    @param stats filled in with the current totals
+   */
+  extern void cdio_paranoia_get_stats(const cdrom_paranoia_t *p,
+                                      paranoia_stats_t *stats);
+
 #ifndef DO_NOT_WANT_PARANOIA_COMPATIBILITY
 /** For compatibility with good ol' paranoia */
 #define cdrom_paranoia           cdrom_paranoia_t
@@ -206,9 +626,24 @@ extern "C" {
 #define paranoia_seek            cdio_paranoia_seek
 #define paranoia_read            cdio_paranoia_read
 #define paranoia_read_limited    cdio_paranoia_read_limited
+#define paranoia_read_batch      cdio_paranoia_read_batch
+#define paranoia_borrow          cdio_paranoia_borrow
+#define paranoia_release         cdio_paranoia_release
 #define paranoia_overlapset      cdio_paranoia_overlapset
 #define paranoia_set_range       cdio_paranoia_set_range
 #define paranoia_cachemodel_size cdio_paranoia_cachemodel_size
+#define paranoia_cachemodel_adapt cdio_paranoia_cachemodel_adapt
+#define paranoia_sortindex       cdio_paranoia_sortindex
+#define paranoia_c2              cdio_paranoia_c2
+#define paranoia_checksums       cdio_paranoia_checksums
+#define paranoia_recheck         cdio_paranoia_recheck
+#define paranoia_reread          cdio_paranoia_reread
+#define paranoia_checksum_init   cdio_paranoia_checksum_init
+#define paranoia_checksum_add    cdio_paranoia_checksum_add
+#define paranoia_defer           cdio_paranoia_defer
+#define paranoia_deferred        cdio_paranoia_deferred
+#define paranoia_threaded        cdio_paranoia_threaded
+#define paranoia_get_stats       cdio_paranoia_get_stats
 #endif /*DO_NOT_WANT_PARANOIA_COMPATIBILITY*/
 
 #ifdef __cplusplus
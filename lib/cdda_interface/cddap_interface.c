@@ -18,6 +18,7 @@
 #include "common_interface.h"
 #include "low_interface.h"
 #include "utils.h"
+#include "cdio/mmc.h"
 
 /** The below variables are trickery to force the above enum symbol
     values to be recorded in debug symbol tables. They are used to
@@ -31,7 +32,7 @@ paranoia_cdda_enums_t debug_paranoia_cdda_enums;
 /*! reads TOC via libcdio and returns the number of tracks in the disc.
     0 is returned if there was an error.
 */
-static int
+int
 cddap_readtoc (cdrom_drive_t *d)
 {
   int i;
@@ -66,42 +67,91 @@ cddap_setspeed(cdrom_drive_t *d, int i_speed)
   return cdio_set_speed(d->p_cdio, i_speed);
 }
 
+/* A READ CD of audio, each sector followed by its C2 error pointers. */
+static driver_return_code_t
+read_c2_sectors (cdrom_drive_t *d, char *raw, lsn_t begin, long i_sectors)
+{
+  return mmc_read_cd(d->p_cdio, raw, begin, CDIO_MMC_READ_TYPE_CDDA,
+		     false, false, 0, true, false, 1, 0,
+		     CD_FRAMESIZE_RAW + CDDA_C2_SIZE, i_sectors);
+}
+
 /* read 'i_sector' adjacent audio sectors
- * into buffer '*p' beginning at sector 'begin'
+ * into buffer '*p' beginning at sector 'begin',
+ * and their C2 error pointers into 'c2' unless it is NULL
  */
 
 static long int
-read_blocks (cdrom_drive_t *d, void *p, lsn_t begin, long i_sectors)
+read_blocks (cdrom_drive_t *d, void *p, unsigned char *c2, lsn_t begin,
+	     long i_sectors)
 {
-  int retry_count = 0;
-  int err;
+  long done = 0;
   int ret = 0;
+  double ms = 0;  /* over every command, for d->last_milliseconds */
+  int timed = 1;
   char *buffer=(char *)p;
+  char *raw=NULL;
+
+  /* The sector the last read gave up on, asked for again straight
+     away: it has just had its retries. */
+  if (readsize_lost_again(d, begin)) {
+    char b[256];
+    snprintf(b, sizeof(b),
+	     "010: Unable to access sector %ld: skipping...\n",
+	     (long int) begin);
+    cderror(d, b);
+    d->last_milliseconds = 0;
+    return -10;
+  }
 
   if(p==NULL)buffer = malloc(i_sectors*CD_FRAMESIZE_RAW);
+  if(c2)raw = malloc(i_sectors*(CD_FRAMESIZE_RAW + CDDA_C2_SIZE));
+
+  /* One or more commands, as big as readsize.c thinks will work here. */
+  while (done < i_sectors) {
+    lsn_t at = begin + done;
+    long n = readsize_next(d, at, i_sectors - done);
+    int retry_count = 0;
+    int err;
+
+    do {
+      struct timespec tv1;
+      struct timespec tv2;
+      int ret1,ret2;
+      int sequential = (at == d->read_next);
+      long usec = -1;
+
+      ret1 = gettime(&tv1);
+      if (c2)
+	err = read_c2_sectors(d, raw, at, n);
+      else if (d->test_state)
+	err = test_read_command(d, buffer + done*CD_FRAMESIZE_RAW, at, n);
+      else
+	err = cdio_read_audio_sectors( d->p_cdio,
+				       buffer + done*CD_FRAMESIZE_RAW, at, n);
+      ret2 = gettime(&tv2);
+
+      if(ret1<0 || ret2<0) {
+	timed = 0;
+      } else {
+	ms += (tv2.tv_sec-tv1.tv_sec)*1000. + (tv2.tv_nsec-tv1.tv_nsec)/1000000.;
+	usec = (tv2.tv_sec-tv1.tv_sec)*1000000L +
+	  (tv2.tv_nsec-tv1.tv_nsec)/1000;
+	note_read_latency(d, at, DRIVER_OP_SUCCESS == err ? n : -1,
+			  usec, retry_count>0);
+      }
 
-  do {
-    struct timespec tv1;
-    struct timespec tv2;
-    int ret1,ret2;
-
-    ret1 = gettime(&tv1);
-    err  = cdio_read_audio_sectors( d->p_cdio, buffer, begin, i_sectors);
-    ret2 = gettime(&tv2);
-
-    if(ret1<0 || ret2<0) {
-      d->last_milliseconds=-1;
-    } else {
-      d->last_milliseconds = (tv2.tv_sec-tv1.tv_sec)*1000. + (tv2.tv_nsec-tv1.tv_nsec)/1000000.;
-    }
+      if ( DRIVER_OP_SUCCESS == err ) {
+	readsize_done(d, at, n, usec, retry_count, sequential);
+	break;
+      }
 
-    if ( DRIVER_OP_SUCCESS != err ) {
       if (!d->error_retry) {
 	ret=-7;
 	goto done;
       }
 
-      if (i_sectors==1) {
+      if (n==1) {
 	/* *Could* be I/O or media error.  I think.  If we're at
 	   30 retries, we better skip this unhappy little
 	   sector. */
@@ -109,30 +159,49 @@ read_blocks (cdrom_drive_t *d, void *p, lsn_t begin, long i_sectors)
 	  char b[256];
 	  snprintf(b, sizeof(b),
 		   "010: Unable to access sector %ld: skipping...\n",
-		   (long int) begin);
+		   (long int) at);
 	  cderror(d, b);
 	  ret=-10;
 	  goto done;
 	}
+      } else {
+	/* A big read that failed once will likely fail again. */
+	n = readsize_failed(d, at, n);
+	d->latency.reductions++;
       }
-
-      if(retry_count>4)
-	if(i_sectors>1)
-	  i_sectors=i_sectors*3/4;
       retry_count++;
+      d->latency.retries++;
       if (retry_count>MAX_RETRIES) {
 	cderror(d,"007: Unknown, unrecoverable error reading data\n");
 	ret=-7;
 	goto done;
       }
-    } else
-      break;
-  } while (err);
-
-  ret=i_sectors;
+    } while (err);
+
+    if (c2) {
+      long i;
+      for (i = 0; i < n; i++) {
+	const char *s = raw + i*(CD_FRAMESIZE_RAW + CDDA_C2_SIZE);
+	memcpy(buffer + (done+i)*CD_FRAMESIZE_RAW, s, CD_FRAMESIZE_RAW);
+	memcpy(c2 + (done+i)*CDDA_C2_SIZE, s + CD_FRAMESIZE_RAW,
+	       CDDA_C2_SIZE);
+      }
+    }
+    done += n;
+  }
 
  done:
+  d->last_milliseconds = timed ? ms : -1;
+  /* Whatever was read before a failure is still good.  The caller
+     will want the sector that failed next; don't spend the retries
+     on it again then. */
+  if (done > 0) {
+    if (ret < 0)
+      readsize_lost(d, begin + done);
+    ret=done;
+  }
   if(p==NULL && buffer)free(buffer);
+  free(raw);
   return ret;
 }
 
@@ -151,7 +220,7 @@ static long int
 jitter_read (cdrom_drive_t *d, void *p, lsn_t begin, long i_sectors,
 	     jitter_baddness_t jitter_badness)
 {
-  static int i_jitter=0;
+  int i_jitter=0;
   int jitter_flag;
   long i_sectors_orig = i_sectors;
   long i_jitter_offset = 0;
@@ -161,11 +230,7 @@ jitter_read (cdrom_drive_t *d, void *p, lsn_t begin, long i_sectors,
   if (d->i_test_flags & CDDA_TEST_ALWAYS_JITTER)
     jitter_flag = 1;
   else
-#ifdef HAVE_DRAND48
-    jitter_flag = (drand48() > .9) ? 1 : 0;
-#else
-    jitter_flag = (((float)rand()/RAND_MAX) > .9) ? 1 : 0;
-#endif
+    jitter_flag = (drive_random(d) > .9) ? 1 : 0;
 
   if (jitter_flag) {
     int i_coeff = 0;
@@ -177,11 +242,7 @@ jitter_read (cdrom_drive_t *d, void *p, lsn_t begin, long i_sectors,
     case JITTER_NONE   :
     default            : ;
     }
-#ifdef HAVE_DRAND48
-    i_jitter = i_coeff * (int)((drand48()-.5)*CDIO_CD_FRAMESIZE_RAW/8);
-#else
-    i_jitter = i_coeff * (int)((((float)rand()/RAND_MAX)-.5)*CDIO_CD_FRAMESIZE_RAW/8);
-#endif
+    i_jitter = i_coeff * (int)((drive_random(d)-.5)*CDIO_CD_FRAMESIZE_RAW/8);
 
     /* We may need to add another sector to compensate for the bytes that
        will be dropped off when jittering, and the begin location may
@@ -213,9 +274,12 @@ jitter_read (cdrom_drive_t *d, void *p, lsn_t begin, long i_sectors,
 
   }
 
-  i_sectors = read_blocks(d, p_buf, begin, i_sectors);
+  i_sectors = read_blocks(d, p_buf, NULL, begin, i_sectors);
 
-  if (i_sectors < 0) return i_sectors;
+  if (i_sectors < 0) {
+    free(p_buf);
+    return i_sectors;
+  }
 
   if (i_sectors < i_sectors_orig) {
     /* Had to reduce # of sectors due to read errors. So give full amount,
@@ -252,8 +316,46 @@ cddap_read (cdrom_drive_t *d, void *p, lsn_t begin, long i_sectors)
   if (jitter_badness) {
     return jitter_read(d, p, begin, i_sectors, jitter_badness);
   } else
-    return read_blocks(d, p, begin, i_sectors);
+    return read_blocks(d, p, NULL, begin, i_sectors);
+
+}
+
+/* read_blocks() for the simulated drive, whose commands are
+   test_read_command()s */
+long
+cddap_read_blocks (cdrom_drive_t *d, void *p, lsn_t begin, long i_sectors)
+{
+  return read_blocks(d, p, NULL, begin, i_sectors);
+}
+
+/* Like cddap_read(), but through READ CD with C2 error pointers and
+   without the simulated jitter.  The first call finds out whether
+   the drive returns them: if a one-sector read with them fails where
+   one without works, it doesn't. */
+long
+cddap_read_c2 (cdrom_drive_t *d, void *p, unsigned char *c2, lsn_t begin,
+	       long i_sectors)
+{
+  i_sectors = ( i_sectors > d->nsectors && d->nsectors > 0 )
+    ? d->nsectors : i_sectors;
+
+  if (d->c2 == 0) {
+    char *raw = malloc(CD_FRAMESIZE_RAW + CDDA_C2_SIZE);
 
+    if (DRIVER_OP_SUCCESS == read_c2_sectors(d, raw, begin, 1))
+      d->c2 = 1;
+    else if (DRIVER_OP_SUCCESS ==
+	     cdio_read_audio_sectors(d->p_cdio, raw, begin, 1)) {
+      d->c2 = -1;
+      cdmessage(d, "Drive does not return C2 error pointers.\n");
+    }
+    free(raw);
+    if (d->c2 < 0) {
+      cderror(d, "405: Option not supported by drive\n");
+      return -405;
+    }
+  }
+  return read_blocks(d, p, c2, begin, i_sectors);
 }
 
 static int
@@ -63,6 +63,9 @@ cdio_cddap_close_no_free_cdio(cdrom_drive_t *d)
       d->enable_cdda(d,0);
 
     _clean_messages(d);
+    free_drive_state(d);
+    profile_free(d);
+    readsize_free(d);
     if (d->cdda_device_name) free(d->cdda_device_name);
     if (d->drive_model)      free(d->drive_model);
     d->cdda_device_name = d->drive_model = NULL;
@@ -101,8 +104,9 @@ cdio_cddap_open(cdrom_drive_t *d)
   int ret;
   if(d->opened)return(0);
 
-  if ( (ret=cddap_init_drive(d)) )
+  if ( (ret = d->test_state ? test_init_drive(d) : cddap_init_drive(d)) )
     return(ret);
+  profile_open_drive(d);
 
   /* Check TOC, enable for CDDA */
 
@@ -126,6 +130,7 @@ cdio_cddap_open(cdrom_drive_t *d)
   if ( -1 == d->bigendianp ) {
     d->bigendianp = data_bigendianp(d);
   }
+  profile_note_drive(d);
 
 
   return(0);
@@ -141,6 +146,24 @@ cdio_cddap_speed_set(cdrom_drive_t *d, int speed)
   return -405;
 }
 
+/* Put the sectors just read into host byte order, if need be. */
+static void
+swap_read(cdrom_drive_t *d, void *buffer, long sectors)
+{
+  /* byteswap? */
+  if ( d->bigendianp == -1 ) /* not determined yet */
+    d->bigendianp = data_bigendianp(d);
+
+  if ( buffer && d->b_swap_bytes && d->bigendianp != bigendianp() ) {
+    int i;
+    uint16_t *p=(uint16_t *)buffer;
+    long els=sectors*CDIO_CD_FRAMESIZE_RAW/2;
+
+    for(i=0;i<els;i++)
+      p[i]=UINT16_SWAP_LE_BE_C(p[i]);
+  }
+}
+
 long
 cdio_cddap_read_timed(cdrom_drive_t *d, void *buffer, lsn_t beginsector,
 		long sectors, int *ms)
@@ -150,20 +173,8 @@ cdio_cddap_read_timed(cdrom_drive_t *d, void *buffer, lsn_t beginsector,
     if (sectors>0) {
       sectors=d->read_audio(d, buffer, beginsector, sectors);
 
-      if (sectors > 0) {
-	/* byteswap? */
-	if ( d->bigendianp == -1 ) /* not determined yet */
-	  d->bigendianp = data_bigendianp(d);
-
-	if ( buffer && d->b_swap_bytes && d->bigendianp != bigendianp() ) {
-	  int i;
-	  uint16_t *p=(uint16_t *)buffer;
-	  long els=sectors*CDIO_CD_FRAMESIZE_RAW/2;
-
-	  for(i=0;i<els;i++)
-	    p[i]=UINT16_SWAP_LE_BE_C(p[i]);
-	}
-      }
+      if (sectors > 0)
+	swap_read(d, buffer, sectors);
     }
     if(ms)*ms=d->last_milliseconds;
     return(sectors);
@@ -173,10 +184,41 @@ cdio_cddap_read_timed(cdrom_drive_t *d, void *buffer, lsn_t beginsector,
   return(-400);
 }
 
+long
+cdio_cddap_read_c2(cdrom_drive_t *d, void *buffer, unsigned char *c2,
+		   lsn_t beginsector, long sectors)
+{
+  if (!d->opened) {
+    cderror(d,"400: Device not open\n");
+    return(-400);
+  }
+  if (d->c2 < 0) {
+    cderror(d,"405: Option not supported by drive\n");
+    return(-405);
+  }
+  if (sectors>0) {
+    sectors = d->test_state
+      ? test_read_c2(d, buffer, c2, beginsector, sectors)
+      : cddap_read_c2(d, buffer, c2, beginsector, sectors);
+
+    /* Swapping moves bytes only within their samples, so the C2 bits
+       still mark the right samples. */
+    if (sectors > 0)
+      swap_read(d, buffer, sectors);
+  }
+  return(sectors);
+}
+
 long cdio_cddap_read(cdrom_drive_t *d, void *buffer, lsn_t beginsector, long sectors){
   return cdda_read_timed(d,buffer,beginsector,sectors,NULL);
 }
 
+void
+cdio_cddap_latency(const cdrom_drive_t *d, cdda_latency_t *p_latency)
+{
+  *p_latency=d->latency;
+}
+
 void
 cdio_cddap_verbose_set(cdrom_drive_t *d,int err_action, int mes_action)
 {
@@ -187,16 +229,22 @@ cdio_cddap_verbose_set(cdrom_drive_t *d,int err_action, int mes_action)
 extern char *
 cdio_cddap_messages(cdrom_drive_t *d)
 {
-  char *ret=d->messagebuf;
+  char *ret;
+  lock_messages(d);
+  ret=d->messagebuf;
   d->messagebuf=NULL;
+  unlock_messages(d);
   return(ret);
 }
 
 extern char *
 cdio_cddap_errors(cdrom_drive_t *d)
 {
-  char *ret=d->errorbuf;
+  char *ret;
+  lock_messages(d);
+  ret=d->errorbuf;
   d->errorbuf=NULL;
+  unlock_messages(d);
   return(ret);
 }
 
@@ -47,5 +47,33 @@
 #define SG_OFF sizeof(struct sg_header)
 
 extern int  cddap_init_drive (cdrom_drive_t *d);
+extern int  cddap_readtoc (cdrom_drive_t *d);
+extern long cddap_read_c2 (cdrom_drive_t *d, void *p, unsigned char *c2,
+                           lsn_t begin, long sectors);
+extern long cddap_read_blocks (cdrom_drive_t *d, void *p, lsn_t begin,
+                               long sectors);
+
+/* The simulated drive in test_interface.c */
+extern void test_attach (cdrom_drive_t *d, const cdda_sim_t *p_sim);
+extern int  test_init_drive (cdrom_drive_t *d);
+extern driver_return_code_t test_read_command (cdrom_drive_t *d, char *buf,
+                                                lsn_t begin, long sectors);
+extern long test_read_c2 (cdrom_drive_t *d, void *p, unsigned char *c2,
+                          lsn_t begin, long sectors);
+extern void test_free_drive (cdrom_drive_t *d);
+
+/* The drive profile database in profile.c */
+extern void profile_open_drive (cdrom_drive_t *d);
+extern void profile_note_drive (cdrom_drive_t *d);
+extern void profile_free (cdrom_drive_t *d);
+
+/* Read size control in readsize.c */
+extern long readsize_next (cdrom_drive_t *d, lsn_t begin, long sectors);
+extern void readsize_done (cdrom_drive_t *d, lsn_t begin, long sectors,
+                           long usec, int retries, int sequential);
+extern long readsize_failed (cdrom_drive_t *d, lsn_t begin, long sectors);
+extern void readsize_lost (cdrom_drive_t *d, lsn_t lsn);
+extern int readsize_lost_again (cdrom_drive_t *d, lsn_t begin);
+extern void readsize_free (cdrom_drive_t *d);
 #endif /*_CDDA_LOW_INTERFACE_*/
 
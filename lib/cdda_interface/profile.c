@@ -0,0 +1,287 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/******************************************************************
+ *
+ * Drive profile database.  What a drive model had to be probed for
+ * once (endianness, read size, cache behavior, read offset, and the
+ * overlap and drift paranoia settled on) is kept in a small text
+ * file, one section per model:
+ *
+ *   [PLEXTOR DVDR PX-716A 1.11]
+ *   bigendian=0
+ *   nsectors=25
+ *
+ * Saving rewrites only the drive's own section, and unknown keys are
+ * ignored when reading, so several programs can share one file.  The
+ * new file is written beside the old one and renamed over it.  Each
+ * value read is clamped to what a drive could plausibly have, so a
+ * damaged file can't make reads huge.
+ *
+ ******************************************************************/
+
+#include "config.h"
+#include "common_interface.h"
+#include "low_interface.h"
+#include "utils.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#define PROFILE_LINE 1024
+
+/* the most words of overlap or drift paranoia ever uses:
+   MAX_SECTOR_OVERLAP sectors of CD_FRAMEWORDS */
+#define PROFILE_MAX_WORDS (32 * 1176)
+
+static const struct {
+  const char *key;
+  size_t offset;
+  long min, max;
+} profile_keys[] = {
+  { "bigendian",         offsetof(cdda_profile_t, bigendianp), 0, 1 },
+  { "nsectors",          offsetof(cdda_profile_t, nsectors), 1,
+    MAX_BIG_BUFF_SIZE * 4 / CDIO_CD_FRAMESIZE_RAW },
+  { "cache_sectors",     offsetof(cdda_profile_t, cache_sectors), 0, 15000 },
+  { "cache_granularity", offsetof(cdda_profile_t, cache_granularity), 0,
+    15000 },
+  { "sample_offset",     offsetof(cdda_profile_t, sample_offset),
+    -75 * 588, 75 * 588 },
+  { "dynoverlap",        offsetof(cdda_profile_t, dynoverlap), 0,
+    PROFILE_MAX_WORDS },
+  { "dyndrift",          offsetof(cdda_profile_t, dyndrift),
+    -PROFILE_MAX_WORDS, PROFILE_MAX_WORDS },
+};
+
+#define NKEYS (sizeof(profile_keys) / sizeof(profile_keys[0]))
+#define FIELD(p, i) ((long *)((char *)(p) + profile_keys[i].offset))
+
+/* Strip the line ending (and any trailing blanks) in place. */
+static void
+chomp(char *line)
+{
+  size_t len = strlen(line);
+  while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r' ||
+                     line[len-1] == ' ' || line[len-1] == '\t'))
+    line[--len] = '\0';
+}
+
+/* If line is a section header, is it id's?  -1 if it isn't a header. */
+static int
+is_section(const char *line, const char *id)
+{
+  const char *end;
+
+  if (line[0] != '[' || !(end = strrchr(line, ']')))
+    return -1;
+  return ((size_t)(end - line - 1) == strlen(id) &&
+          !strncmp(line + 1, id, end - line - 1));
+}
+
+/* Fill in p from p->id's section of path.  1 if there is one, 0 if
+   not (or there is no database yet), -1 if it can't be read. */
+static int
+profile_read(const char *path, cdda_profile_t *p)
+{
+  char line[PROFILE_LINE];
+  int in = 0, found = 0;
+  FILE *f = fopen(path, "r");
+
+  if (!f)
+    return errno == ENOENT ? 0 : -1;
+
+  while (fgets(line, sizeof(line), f)) {
+    char *eq;
+    int sec;
+    size_t i;
+
+    chomp(line);
+    if ((sec = is_section(line, p->id)) >= 0) {
+      in = sec;
+      found |= sec;
+      continue;
+    }
+    if (!in || !(eq = strchr(line, '=')))
+      continue;
+    *eq = '\0';
+    for (i = 0; i < NKEYS; i++)
+      if (!strcmp(line, profile_keys[i].key)) {
+        char *end;
+        long v = strtol(eq + 1, &end, 10);
+        if (end == eq + 1)
+          continue;
+        if (v < profile_keys[i].min) v = profile_keys[i].min;
+        if (v > profile_keys[i].max) v = profile_keys[i].max;
+        *FIELD(p, i) = v;
+      }
+  }
+  fclose(f);
+  return found;
+}
+
+int
+cdio_cddap_profile_use(cdrom_drive_t *d, const char *psz_path)
+{
+  cdda_profile_t *p;
+  size_t i;
+
+  free(d->profile_path);
+  free(d->profile);
+  d->profile_path = strdup(psz_path);
+  d->profile = p = calloc(1, sizeof(cdda_profile_t));
+  if (!d->profile_path || !p)
+    return -1;
+
+  snprintf(p->id, sizeof(p->id), "%s",
+           d->drive_model ? d->drive_model :
+           d->cdda_device_name ? d->cdda_device_name : "unknown");
+  for (i = 0; i < NKEYS; i++)
+    *FIELD(p, i) = CDDA_PROFILE_UNKNOWN;
+
+  return profile_read(psz_path, p);
+}
+
+cdda_profile_t *
+cdio_cddap_profile(cdrom_drive_t *d)
+{
+  return d->profile;
+}
+
+/* Copy every section but d's from the old database to a new one, add
+   d's at the end, and move the new one into place. */
+int
+cdio_cddap_profile_save(cdrom_drive_t *d)
+{
+  const cdda_profile_t *p = d->profile;
+  char line[PROFILE_LINE];
+  char *tmp;
+  FILE *in, *out;
+  int skip = 0, err;
+  size_t i;
+
+  if (!p) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  tmp = malloc(strlen(d->profile_path) + 8);
+  if (!tmp)
+    return -1;
+#ifdef HAVE_MKSTEMP
+  /* A name of its own, so that programs saving at once don't write
+     into one another's new file. */
+  sprintf(tmp, "%s.XXXXXX", d->profile_path);
+  {
+    int fd = mkstemp(tmp);
+    struct stat st;
+
+    if (fd < 0) {
+      free(tmp);
+      return -1;
+    }
+    /* mkstemp() makes it private; keep the old file's mode */
+    fchmod(fd, stat(d->profile_path, &st) ? 0644 : st.st_mode & 0777);
+    if (!(out = fdopen(fd, "w"))) {
+      err = errno;
+      close(fd);
+      unlink(tmp);
+      free(tmp);
+      errno = err;
+      return -1;
+    }
+  }
+#else
+  sprintf(tmp, "%s.new", d->profile_path);
+  if (!(out = fopen(tmp, "w"))) {
+    free(tmp);
+    return -1;
+  }
+#endif
+
+  if ((in = fopen(d->profile_path, "r"))) {
+    while (fgets(line, sizeof(line), in)) {
+      char name[PROFILE_LINE];
+      int sec;
+
+      strcpy(name, line);
+      chomp(name);
+      if ((sec = is_section(name, p->id)) >= 0)
+        skip = sec;
+      if (!skip)
+        fputs(line, out);
+    }
+    fclose(in);
+  } else
+    fprintf(out, "# libcdio-paranoia drive profiles\n");
+
+  fprintf(out, "[%s]\n", p->id);
+  for (i = 0; i < NKEYS; i++)
+    if (*FIELD(p, i) != CDDA_PROFILE_UNKNOWN)
+      fprintf(out, "%s=%ld\n", profile_keys[i].key, *FIELD(p, i));
+
+  err = ferror(out);
+  if (fclose(out) || err || rename(tmp, d->profile_path)) {
+    err = errno;
+    unlink(tmp);
+    free(tmp);
+    errno = err;
+    return -1;
+  }
+  free(tmp);
+  return 0;
+}
+
+/* Take what d's profile knows about it; called by cdio_cddap_open()
+   once the drive's own setup has run, and before endianness is
+   probed. */
+void
+profile_open_drive(cdrom_drive_t *d)
+{
+  const cdda_profile_t *p = d->profile;
+
+  if (!p)
+    return;
+  if (p->nsectors > 0)
+    d->nsectors = p->nsectors;
+  if (d->bigendianp == -1 && (p->bigendianp == 0 || p->bigendianp == 1))
+    d->bigendianp = p->bigendianp;
+}
+
+/* Record what opening d found out. */
+void
+profile_note_drive(cdrom_drive_t *d)
+{
+  cdda_profile_t *p = d->profile;
+
+  if (!p)
+    return;
+  if (d->bigendianp == 0 || d->bigendianp == 1)
+    p->bigendianp = d->bigendianp;
+  if (d->nsectors > 0)
+    p->nsectors = d->nsectors;
+}
+
+void
+profile_free(cdrom_drive_t *d)
+{
+  free(d->profile_path);
+  free(d->profile);
+  d->profile_path = NULL;
+  d->profile = NULL;
+}
@@ -0,0 +1,252 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/******************************************************************
+ *
+ * Read size control.  read_blocks() asks here how many sectors each
+ * read command should cover, and reports back how it went.
+ *
+ * A failed command halves the size at once, rather than retrying a
+ * big read that is likely to fail again, and the stretch it covered
+ * is remembered as a trouble spot together with the size that then
+ * worked there.  Clean commands double the size again, up to
+ * nsectors, so one scratch doesn't leave the rest of the disc read in
+ * small pieces.  Reads of a trouble spot (paranoia reads every spot
+ * at least twice) start at the size that worked, and reads that would
+ * run into one stop short of it, so the good data before it still
+ * comes in large commands.
+ *
+ * A sequential read that succeeds but takes far longer per sector
+ * than usual means the drive is retrying internally; the spot is
+ * remembered as trouble, but the size isn't changed.
+ *
+ * When a request gives up on a sector part way through, the sectors
+ * before it are still returned, and the caller usually asks for the
+ * one that failed next.  That request fails at once rather than
+ * spending all the retries on it a second time.
+ *
+ ******************************************************************/
+
+#include "config.h"
+#include "common_interface.h"
+#include "low_interface.h"
+#include "utils.h"
+
+/* trouble spots remembered per drive; when full, slots are reused in turn */
+#define READ_RANGES 32
+
+/* a sequential read this many times slower per sector than usual,
+   and slower than SLOW_READ_MIN_US overall, is a struggling read */
+#define SLOW_READ_FACTOR 8
+#define SLOW_READ_MIN_US 50000
+
+typedef struct read_ctl {
+  long size;          /* sectors per command away from trouble */
+  int clean;          /* clean commands since size last changed */
+  long us_per_sector; /* running mean over clean sequential reads */
+  cdda_range_t range[READ_RANGES];
+  int nranges;
+  int next;           /* slot to reuse when full */
+  lsn_t lost;         /* sector the last request gave up on... */
+  int haslost;        /* ...if it returned what it read before it */
+} read_ctl_t;
+
+static read_ctl_t *
+read_ctl(cdrom_drive_t *d)
+{
+  read_ctl_t *c = d->read_ctl;
+
+  if (!c) {
+    c = d->read_ctl = calloc(1, sizeof(read_ctl_t));
+    if (!c)
+      return NULL;
+    c->size = d->nsectors;
+  }
+  if (c->size > d->nsectors || c->size < 1)
+    c->size = d->nsectors > 0 ? d->nsectors : 1;
+  return c;
+}
+
+/* Remember [begin, end) as trouble, where reads of at most size
+   sectors are to be used.  Overlapping or adjacent spots merge. */
+static void
+note_trouble(read_ctl_t *c, lsn_t begin, lsn_t end, long size)
+{
+  int i;
+
+  for (i = 0; i < c->nranges; i++) {
+    cdda_range_t *r = &c->range[i];
+    if (begin <= r->end && end >= r->begin) {
+      if (begin < r->begin) r->begin = begin;
+      if (end > r->end) r->end = end;
+      if (size < r->sectors) r->sectors = size;
+      return;
+    }
+  }
+
+  if (c->nranges < READ_RANGES)
+    i = c->nranges++;
+  else {
+    i = c->next;
+    c->next = (c->next + 1) % READ_RANGES;
+  }
+  c->range[i].begin = begin;
+  c->range[i].end = end;
+  c->range[i].sectors = size;
+}
+
+/* How many of the (sectors) sectors wanted at begin the next command
+   should ask for. */
+long
+readsize_next(cdrom_drive_t *d, lsn_t begin, long sectors)
+{
+  read_ctl_t *c = read_ctl(d);
+  long n = sectors;
+  int i;
+
+  if (!c)
+    return sectors;
+  if (n > c->size)
+    n = c->size;
+
+  for (i = 0; i < c->nranges; i++) {
+    const cdda_range_t *r = &c->range[i];
+    if (begin >= r->begin && begin < r->end) {
+      if (n > r->sectors)
+        n = r->sectors;
+    } else if (r->begin > begin && r->begin < begin + n)
+      n = r->begin - begin;
+  }
+  return n > 0 ? n : 1;
+}
+
+/* A command of (sectors) sectors at begin succeeded in usec
+   microseconds, after (retries) failures; (sequential) if it carried
+   on from the last read. */
+void
+readsize_done(cdrom_drive_t *d, lsn_t begin, long sectors, long usec,
+              int retries, int sequential)
+{
+  read_ctl_t *c = read_ctl(d);
+  long per_sector = usec / sectors;
+  int i;
+
+  if (!c)
+    return;
+
+  if (retries) {
+    note_trouble(c, begin, begin + sectors, sectors);
+    c->clean = 0;
+    return;
+  }
+
+  if (sequential && usec >= 0) {
+    if (c->us_per_sector > 0 && usec > SLOW_READ_MIN_US &&
+        per_sector > c->us_per_sector * SLOW_READ_FACTOR) {
+      note_trouble(c, begin, begin + sectors, sectors);
+      c->clean = 0;
+      return;
+    }
+    c->us_per_sector = c->us_per_sector > 0
+      ? c->us_per_sector + (per_sector - c->us_per_sector) / 8
+      : (per_sector > 0 ? per_sector : 1);
+  }
+
+  /* A clean read at the start of a trouble spot shows that much of it
+     is fine after all; elsewhere in one, the next read may be bigger. */
+  for (i = 0; i < c->nranges; i++) {
+    cdda_range_t *r = &c->range[i];
+    if (begin >= r->begin && begin < r->end) {
+      if (begin == r->begin)
+        r->begin = begin + sectors;
+      if (r->begin >= r->end)
+        c->range[i] = c->range[--c->nranges];
+      else if (sectors >= r->sectors)
+        r->sectors = r->sectors * 2 < c->size ? r->sectors * 2 : c->size;
+      return;
+    }
+  }
+
+  if (++c->clean >= 2 && c->size < d->nsectors) {
+    c->size = c->size * 2 < d->nsectors ? c->size * 2 : d->nsectors;
+    c->clean = 0;
+  }
+}
+
+/* A command of (sectors) sectors at begin failed.  Returns the size
+   to retry with. */
+long
+readsize_failed(cdrom_drive_t *d, lsn_t begin, long sectors)
+{
+  read_ctl_t *c = read_ctl(d);
+  long n = sectors > 1 ? sectors / 2 : 1;
+
+  if (!c)
+    return n;
+  note_trouble(c, begin, begin + sectors, n);
+  if (c->size > n)
+    c->size = n;
+  c->clean = 0;
+  return n;
+}
+
+/* Every try at sector lsn failed, after the sectors before it had
+   been read and returned. */
+void
+readsize_lost(cdrom_drive_t *d, lsn_t lsn)
+{
+  read_ctl_t *c = read_ctl(d);
+
+  if (!c)
+    return;
+  note_trouble(c, lsn, lsn + 1, 1);
+  c->lost = lsn;
+  c->haslost = 1;
+}
+
+/* Does a request at begin ask for the sector the last one gave up on?
+   Only the request straight after is answered yes. */
+int
+readsize_lost_again(cdrom_drive_t *d, lsn_t begin)
+{
+  read_ctl_t *c = d->read_ctl;
+
+  if (!c || !c->haslost)
+    return 0;
+  c->haslost = 0;
+  return begin == c->lost;
+}
+
+int
+cdio_cddap_trouble(const cdrom_drive_t *d, cdda_range_t *p_ranges,
+                   int i_max)
+{
+  const read_ctl_t *c = d->read_ctl;
+  int i;
+
+  if (!c)
+    return 0;
+  for (i = 0; i < c->nranges && i < i_max; i++)
+    p_ranges[i] = c->range[i];
+  return c->nranges;
+}
+
+void
+readsize_free(cdrom_drive_t *d)
+{
+  free(d->read_ctl);
+  d->read_ctl = NULL;
+}
@@ -204,6 +204,32 @@ cdio_cddap_identify_cdio(CdIo_t *p_cdio, int messagedest, char **ppsz_messages)
 
 }
 
+/** Returns a simulated drive reading the disc image psz_image, or
+    NULL if there was an error.  @see cdio_cddap_identify
+ */
+cdrom_drive_t *
+cdio_cddap_identify_sim(const char *psz_image, const cdda_sim_t *p_sim,
+			int messagedest, char **ppsz_messages)
+{
+  CdIo_t *p_cdio;
+  cdrom_drive_t *d;
+
+  if (!psz_image) return NULL;
+  idmessage(messagedest, ppsz_messages, "Checking %s for a disc image...",
+	    psz_image);
+  p_cdio = cdio_open(psz_image, DRIVER_UNKNOWN);
+  d = cdda_identify_device_cdio(p_cdio, psz_image, messagedest,
+				ppsz_messages);
+  if (!d) {
+    if (p_cdio) cdio_destroy(p_cdio);
+    return NULL;
+  }
+  test_attach(d, p_sim);
+  idmessage(messagedest, ppsz_messages, "\t\tSimulated drive over %s\n",
+	    psz_image);
+  return d;
+}
+
 static cdrom_drive_t *
 cdda_identify_device_cdio(CdIo_t *p_cdio, const char *psz_device,
 			  int messagedest, char **ppsz_messages)
@@ -294,6 +320,7 @@ cdda_identify_device_cdio(CdIo_t *p_cdio, const char *psz_device,
   d->nsectors         = -1; /* We don't know yet... */
   d->messagedest      = messagedest;
   d->b_swap_bytes     = true;
+  init_drive_state(d);
 
   {
     cdio_hwinfo_t hw_info = {
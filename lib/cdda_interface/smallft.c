@@ -29,8 +29,8 @@
 #include "smallft.h"
 
 static void drfti1(int n, float *wa, int *ifac){
-  static int ntryh[4] = { 4,2,3,5 };
-  static float tpi = 6.28318530717958647692528676655900577;
+  static const int ntryh[4] = { 4,2,3,5 };
+  static const float tpi = 6.28318530717958647692528676655900577;
   float arg,argh,argld,fi;
   int ntry=0,i,j=-1;
   int k1, l1, l2, ib;
@@ -161,7 +161,7 @@ static void dradf2(int ido,int l1,float *cc,float *ch,float *wa1){
 
 static void dradf4(int ido,int l1,float *cc,float *ch,float *wa1,
 	    float *wa2,float *wa3){
-  static float hsqt2 = .70710678118654752440084436210485;
+  static const float hsqt2 = .70710678118654752440084436210485;
   int i,k,t0,t1,t2,t3,t4,t5,t6;
   float ci2,ci3,ci4,cr2,cr3,cr4,ti1,ti2,ti3,ti4,tr1,tr2,tr3,tr4;
   t0=l1*ido;
@@ -371,7 +371,7 @@ L105:
 
 static void dradb4(int ido,int l1,float *cc,float *ch,float *wa1,
 			  float *wa2,float *wa3){
-  static float sqrt2=1.4142135623730950488016887242097;
+  static const float sqrt2=1.4142135623730950488016887242097;
   int i,k,t0,t1,t2,t3,t4,t5,t6,t7,t8;
   float ci2,ci3,ci4,cr2,cr3,cr4,ti1,ti2,ti3,ti4,tr1,tr2,tr3,tr4;
   t0=l1*ido;
@@ -2,7 +2,7 @@
   Copyright (C) 2004, 2008 Rocky Bernstein <rocky@gnu.org>
   Copyright (C) 2014 Robert Kausch <robert.kausch@freac.org>
   Copyright (C) 1998 Monty xiphmont@mit.edu
-  
+
   This program is free software: you can redistribute it and/or modify
   it under the terms of the GNU General Public License as published by
   the Free Software Foundation, either version 3 of the License, or
@@ -18,228 +18,438 @@
 */
 /******************************************************************
  *
- * Fake interface backend for testing paranoia layer
- * NOTE: THIS CODE HAVE BEEN FOLDED INTO THE MAINLINE CODE SO IT IS
- * NOT USED ANYMORE. (It's not clear that it had been used
- * for a while in the non-libcdio cdparaonoia either.)
+ * Simulated drive backend for testing and benchmarking the paranoia
+ * layer.  The disc is an image libcdio can read; the drive on top of
+ * it jitters, fragments, scratches, under-runs, stalls and caches as
+ * its cdda_sim_t says, drawing every random choice from the drive's
+ * own seeded generator so that runs are repeatable.
  *
  ******************************************************************/
 
-#ifdef CDDA_TEST
+#include "config.h"
+#include "common_interface.h"
 #include "low_interface.h"
 #include "utils.h"
 
-/* Build which test model? */
-#define  CDDA_TEST_OK
-#undef  CDDA_TEST_JITTER_SMALL
-#undef  CDDA_TEST_JITTER_LARGE
-#undef  CDDA_TEST_JITTER_MASSIVE
-#undef  CDDA_TEST_FRAG_SMALL
-#undef  CDDA_TEST_FRAG_LARGE
-#undef  CDDA_TEST_FRAG_MASSIVE
-#undef  CDDA_TEST_BOGUS_BYTES
-#undef  CDDA_TEST_DROPDUPE_BYTES
-#undef  CDDA_TEST_SCRATCH
-#undef  CDDA_TEST_UNDERRUN
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
-#undef  CDDA_TEST_ALLJITTER
-#undef  CDDA_TEST_SOMEJITTER
-#undef CDDA_TEST_SEEKJITTER
+#define DEFAULT_SCRATCH_BYTES 1100
 
-static int test_readtoc (cdrom_drive *d){
-  int tracks=0;
-  long bytes;
-  long sectors;
+/* What used to be statics in test_read(), kept per drive so that
+   several simulated drives can be read at once. */
+typedef struct test_state_s {
+  cdda_sim_t sim;
+  lsn_t *unreadable;  /* our copy of sim.unreadable */
+  lsn_t *slow;        /* our copy of sim.slow */
+  lsn_t lastread;     /* sector after the last read */
 
-  /* only one track, as many sectors as the file */
+  char *window;       /* image sectors around the current read */
+  long window_alloc;  /* in sectors */
 
-  bytes=lseek(d->cdda_fd,0,SEEK_END);
-  lseek(d->cdda_fd,0,SEEK_SET);
-  sectors=bytes/CDIO_CD_FRAMESIZE_RAW;
+  char *cache;        /* what the last disc read returned */
+  long cache_alloc;   /* in sectors */
+  lsn_t cache_begin;
+  long cached;        /* sectors valid in cache */
+} test_state_t;
 
-  d->disc_toc[0].bFlags = 0;
-  d->disc_toc[0].bTrack = 1;
-  d->disc_toc[0].dwStartSector = 37;
+static int
+roll(cdrom_drive_t *d, int percent)
+{
+  return percent > 0 && drive_random(d) * 100 < percent;
+}
 
-  d->disc_toc[1].bFlags = 0x4;
-  d->disc_toc[1].bTrack = CDROM_LEADOUT;
-  d->disc_toc[1].dwStartSector = sectors+37;
+/* Make sure *buf holds (sectors) sectors. */
+static void
+grow(char **buf, long *alloc, long sectors)
+{
+  if (sectors > *alloc) {
+    *buf = realloc(*buf, sectors * CDIO_CD_FRAMESIZE_RAW);
+    *alloc = sectors;
+  }
+}
 
-  tracks=2;
-  d->cd_extra=0;
-  return(--tracks);  /* without lead-out */
+/* A well-mixed 64-bit hash; places scratches from the seed without
+   disturbing the read-to-read random sequence. */
+static uint64_t
+splitmix(uint64_t x)
+{
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
 }
 
-/* we emulate jitter, scratches, atomic jitter and bogus bytes on
-   boundaries, etc */
+/* Read image sectors [begin, begin+sectors) into buf, with silence
+   for whatever lies off the disc. */
+static int
+image_read(cdrom_drive_t *d, char *buf, lsn_t begin, long sectors)
+{
+  lsn_t first = begin;
+  lsn_t end = begin + sectors;
+  lsn_t leadout = d->disc_toc[d->tracks].dwStartSector;
+
+  if (first < 0) first = 0;
+  if (end > leadout) end = leadout;
+
+  memset(buf, 0, sectors * CDIO_CD_FRAMESIZE_RAW);
+  if (first < end &&
+      DRIVER_OP_SUCCESS !=
+      cdio_read_audio_sectors(d->p_cdio,
+                              buf + (first - begin) * CDIO_CD_FRAMESIZE_RAW,
+                              first, end - first))
+    return -1;
+  return 0;
+}
 
-static long 
-test_read(cdrom_drive *d, void *p, long begin, long sectors)
+/* Where scratch i of the disc starts, as a byte offset from LSN 0;
+   -1 if the disc is empty. */
+static long long
+scratch_at(const cdrom_drive_t *d, const cdda_sim_t *sim, int i)
 {
+  long long first = (long long)d->disc_toc[0].dwStartSector
+    * CDIO_CD_FRAMESIZE_RAW;
+  long long disc = (long long)d->disc_toc[d->tracks].dwStartSector
+    * CDIO_CD_FRAMESIZE_RAW - first;
+
+  if (disc <= 0)
+    return -1;
+  return first + splitmix(sim->seed * 131 + i) % disc;
+}
 
-#if defined(CDDA_TEST_SEEKJITTER) \
-  || defined(CDDA_TEST_ALLJITTER) \
-  || defined(CDDA_TEST_SOMEJITTER)
-  int jitter_flag;
-#endif
+/* Overwrite whatever scratched spots of the disc fall inside the
+   sectors at begin with noise. */
+static void
+scratch(cdrom_drive_t *d, const test_state_t *ts, char *buf, lsn_t begin,
+        long sectors)
+{
+  const cdda_sim_t *sim = &ts->sim;
+  long len = sim->scratch_bytes > 0 ? sim->scratch_bytes
+    : DEFAULT_SCRATCH_BYTES;
+  long long from = (long long)begin * CDIO_CD_FRAMESIZE_RAW;
+  long long to = from + sectors * CDIO_CD_FRAMESIZE_RAW;
+  int i;
+
+  for (i = 0; i < sim->scratches; i++) {
+    long long at = scratch_at(d, sim, i);
+    long long j;
+
+    if (at < 0)
+      return;
+    for (j = at > from ? at : from; j < at + len && j < to; j++)
+      buf[j - from] = (char)(drive_random(d) * 256);
+  }
+}
 
-  int los_flag;
-  static int jitter=0;
-  int bytes_so_far=0;
-  long bytestotal;
-  static FILE *fd=NULL;
-  static long lastread=0;
+/* Read (sectors) sectors at begin from the disc itself.  Each fragment
+   may land a little off where it should; once off, the rest of the
+   read follows it. */
+static long
+disc_read(cdrom_drive_t *d, test_state_t *ts, char *buf, lsn_t begin,
+          long sectors)
+{
+  const cdda_sim_t *sim = &ts->sim;
+  long slack = sim->jitter_bytes / CDIO_CD_FRAMESIZE_RAW + 2;
+  long limit = (slack - 1) * CDIO_CD_FRAMESIZE_RAW;
+  long bytes = sectors * CDIO_CD_FRAMESIZE_RAW;
+  long pos = 0;
+  long jitter = 0;
+
+  grow(&ts->window, &ts->window_alloc, sectors + 2 * slack);
+  if (image_read(d, ts->window, begin - slack, sectors + 2 * slack)) {
+    cderror(d, "007: Unknown, unrecoverable error reading data\n");
+    return -7;
+  }
 
-  if(!fd)fd=fdopen(d->cdda_fd,"r");
+  while (pos < bytes) {
+    long len = bytes - pos;
 
-  if(begin<lastread)
-    d->last_milliseconds=20;
-  else
-    d->last_milliseconds=sectors;
+    if (sim->frag_bytes > 0) {
+      long frag = 4 + 4 * (long)(drive_random(d) * (sim->frag_bytes / 4));
+      if (frag < len)
+        len = frag;
+    }
+    if (sim->jitter_bytes > 0 && roll(d, sim->jitter_percent))
+      jitter = 4 * (long)((drive_random(d) * 2 - 1) *
+                          (sim->jitter_bytes / 4));
+    if (roll(d, sim->dropdupe_percent))
+      jitter += drive_random(d) < .5 ? -2 : 2;
+
+    if (jitter > limit) jitter = limit;
+    if (jitter < -limit) jitter = -limit;
+    /* Like jitter_read(), never land in the first sector: with no
+       straight reads there, nothing would anchor the rip. */
+    if ((long long)begin * CDIO_CD_FRAMESIZE_RAW + pos + jitter
+        < CDIO_CD_FRAMESIZE_RAW)
+      jitter = 0;
+    memcpy(buf + pos,
+           ts->window + slack * CDIO_CD_FRAMESIZE_RAW + pos + jitter, len);
+    pos += len;
+  }
 
-#ifdef CDDA_TEST_UNDERRUN
-  sectors-=1;
-#endif
+  if (sim->scratches > 0)
+    scratch(d, ts, buf, begin, sectors);
+  return sectors;
+}
 
-#ifdef CDDA_TEST_SEEKJITTER
-  if(lastread!=begin)jitter_flag=1;
-#else
-#ifdef CDDA_TEST_ALLJITTER
-  jitter_flag=1;
-#else
-#ifdef CDDA_TEST_SOMEJITTER
-  jitter_flag=(drand48()>.9?1:0);
-  los_flag=(drand48()>.9?1:0);
-#else
-  los_flag=1;
-#endif
-#endif
+static void
+stall(long usec)
+{
+#ifdef HAVE_USLEEP
+  while (usec > 0) {
+    long now = usec < 500000 ? usec : 500000;
+    usleep(now);
+    usec -= now;
+  }
 #endif
+}
 
-  lastread=begin+sectors;
-  bytestotal=sectors*CDIO_CD_FRAMESIZE_RAW;
-
-  begin*=CDIO_CD_FRAMESIZE_RAW;
-
-  while(bytes_so_far<bytestotal){
-    int inner_bytes=bytestotal-bytes_so_far;
-    char *inner_buf=(char *)(p ? p + bytes_so_far : NULL);
-    long seeki;
-    long rbytes;
-    long this_bytes=inner_bytes;
-
-#ifdef CDDA_TEST_OK
-    
-#else
-#ifdef CDDA_TEST_JITTER_SMALL
-    if(jitter_flag)jitter=4*(int)((drand48()-.5)*CDIO_CD_FRAMESIZE_RAW/8);
-
-#else
-#ifdef CDDA_TEST_JITTER_LARGE
-    if(jitter_flag)jitter=32*(int)((drand48()-.5)*CDIO_CD_FRAMESIZE_RAW/8);
-
-#else
-#ifdef CDDA_TEST_JITTER_MASSIVE
-    if(jitter_flag)jitter=128*(int)((drand48()-.5)*CDIO_CD_FRAMESIZE_RAW/8);
-
-#else
-#ifdef CDDA_TEST_FRAG_SMALL
-    if(los_flag)this_bytes=256*(int)(drand48()*CDIO_CD_FRAMESIZE_RAW/8);
-    if(jitter_flag)jitter=4*(int)((drand48()-.5)*CDIO_CD_FRAMESIZE_RAW/8);
-
-#else
-#ifdef CDDA_TEST_FRAG_LARGE
-    if(los_flag)this_bytes=16*(int)(drand48()*CDIO_CD_FRAMESIZE_RAW/8);
-    if(jitter_flag)jitter=4*(int)((drand48()-.5)*CDIO_CD_FRAMESIZE_RAW/8);
-
-#else
-#ifdef CDDA_TEST_FRAG_MASSIVE
-    if(los_flag)this_bytes=8*(int)(drand48()*CDIO_CD_FRAMESIZE_RAW/8);
-    if(jitter_flag)jitter=32*(int)((drand48()-.5)*CDIO_CD_FRAMESIZE_RAW/8);
-
-#else
-#ifdef CDDA_TEST_DROPDUPE_BYTES
-    if(los_flag)this_bytes=CDIO_CD_FRAMESIZE_RAW;
-    if(jitter_flag)
-      if (drand48()>.8)
-	this_jitter=32;
-      else
-	this_jitter=0;
+/* One read command of the simulated drive: all (sectors) sectors at
+   begin into buf, or a failure, as a real drive's READ CD. */
+driver_return_code_t
+test_read_command(cdrom_drive_t *d, char *buf, lsn_t begin, long sectors)
+{
+  test_state_t *ts = d->test_state;
+  const cdda_sim_t *sim = &ts->sim;
+  long usec = 0;
+  long want;
+  int i;
+
+  if (begin >= ts->cache_begin &&
+      begin + sectors <= ts->cache_begin + ts->cached) {
+    /* Served from the drive cache: no disc access, no new errors. */
+    memcpy(buf, ts->cache + (begin - ts->cache_begin)
+           * CDIO_CD_FRAMESIZE_RAW, sectors * CDIO_CD_FRAMESIZE_RAW);
+    ts->lastread = begin + sectors;
+    return DRIVER_OP_SUCCESS;
+  }
 
-#endif
-#endif
-#endif
-#endif
-#endif
-#endif
-#endif
-#endif
+  /* The drive reads ahead to fill its cache, but stops short of a
+     sector it can't read. */
+  want = sectors > sim->cache_sectors ? sectors : sim->cache_sectors;
+  for (i = 0; i < sim->n_unreadable; i++)
+    if (ts->unreadable[i] >= begin && ts->unreadable[i] < begin + want)
+      want = ts->unreadable[i] - begin;
+
+  usec = sim->latency_us;
+  if (begin != ts->lastread)
+    usec += sim->seek_us;
+  for (i = 0; i < sim->n_slow; i++)
+    if (ts->slow[i] >= begin && ts->slow[i] < begin + want)
+      usec += sim->slow_us;
+  stall(usec);
+  ts->cached = 0;
+
+  if (sectors > want) {
+    ts->lastread = -1;
+    return DRIVER_OP_ERROR;
+  }
+  ts->lastread = begin + sectors;
+
+  if (sim->cache_sectors > 0) {
+    grow(&ts->cache, &ts->cache_alloc, want);
+    if (disc_read(d, ts, ts->cache, begin, want) < 0)
+      return DRIVER_OP_ERROR;
+    ts->cache_begin = begin;
+    ts->cached = want;
+    memcpy(buf, ts->cache, sectors * CDIO_CD_FRAMESIZE_RAW);
+    return DRIVER_OP_SUCCESS;
+  }
+  if (disc_read(d, ts, buf, begin, sectors) < 0)
+    return DRIVER_OP_ERROR;
+  return DRIVER_OP_SUCCESS;
+}
 
+/* read 'sectors' adjacent audio sectors
+ * into buffer '*p' beginning at sector 'begin'
+ */
+static long
+test_read(cdrom_drive_t *d, void *p, lsn_t begin, long sectors)
+{
+  test_state_t *ts = d->test_state;
+  const cdda_sim_t *sim = &ts->sim;
+
+  /* read d->nsectors at a time, max. */
+  if (sectors > d->nsectors && d->nsectors > 0)
+    sectors = d->nsectors;
+  if (sectors > sim->max_sectors && sim->max_sectors > 0)
+    sectors = sim->max_sectors;
+  if (sectors > 1 && roll(d, sim->short_percent))
+    sectors--;
+
+  /* Through the same read size control, retries and timing as a
+     real drive. */
+  return cddap_read_blocks(d, p, begin, sectors);
+}
 
-    if(begin+jitter+bytes_so_far<0)jitter=0;    
-    seeki=begin+bytes_so_far+jitter;
+/* Like test_read(), with C2 error pointers flagging exactly the
+   scratched bytes; the simulated drive never misses one, nor flags
+   a good byte. */
+long
+test_read_c2(cdrom_drive_t *d, void *p, unsigned char *c2, lsn_t begin,
+             long sectors)
+{
+  test_state_t *ts = d->test_state;
+  const cdda_sim_t *sim = &ts->sim;
+  long len = sim->scratch_bytes > 0 ? sim->scratch_bytes
+    : DEFAULT_SCRATCH_BYTES;
+  long long from = (long long)begin * CDIO_CD_FRAMESIZE_RAW;
+  long long to;
+  long n;
+  int i;
+
+  if (!sim->c2) {
+    cderror(d, "405: Option not supported by drive\n");
+    return -405;
+  }
 
-    if(fseek(fd,seeki,SEEK_SET)<0){
-      return(0);
-    }
-    if(!inner_buf){
-      char *temp = malloc(this_bytes);
-      rbytes=fread(temp,1,this_bytes,fd);
-      free(temp);
-    }else
-      rbytes=fread(inner_buf,1,this_bytes,fd);
-
-
-    bytes_so_far+=rbytes;
-    if(rbytes==0)break;
-
-#ifdef CDDA_TEST_SEEKJITTER
-    jitter_flag=0;
-    los_flag=0;
-#else
-#ifdef CDDA_TEST_ALLJITTER
-    jitter_flag=1;
-    los_flag=0;
-#else
-#ifdef CDDA_TEST_SOMEJITTER
-    jitter_flag=(drand48()>.9?1:0);
-    los_flag=(drand48()>.9?1:0);
-#else
-    los_flag=1;
-#endif
-#endif
-#endif
+  n = test_read(d, p, begin, sectors);
+  if (n <= 0)
+    return n;
+
+  memset(c2, 0, n * CDDA_C2_SIZE);
+  to = from + n * CDIO_CD_FRAMESIZE_RAW;
+  for (i = 0; i < sim->scratches; i++) {
+    long long at = scratch_at(d, sim, i);
+    long long j;
 
+    if (at < 0)
+      break;
+    for (j = at > from ? at : from; j < at + len && j < to; j++)
+      c2[(j - from) >> 3] |= 0x80 >> ((j - from) & 7);
   }
+  return n;
+}
 
-#ifdef CDDA_TEST_SCRATCH
-  {
-    long location=300*CDIO_CD_FRAMESIZE_RAW+(drand48()*56)+512;
+static int
+test_enable_cdda(cdrom_drive_t *d, int onoff)
+{
+  return 0;
+}
 
-    if(begin<=location && begin+bytestotal>location){
-      if(p)memset(p+location-begin,(int)(drand48()*256),1100);
-    }
+static int
+test_setspeed(cdrom_drive_t *d, int speed)
+{
+  return 0;
+}
+
+/* Attach a simulated drive to d; used before it is opened. */
+void
+test_attach(cdrom_drive_t *d, const cdda_sim_t *p_sim)
+{
+  cdda_sim_t perfect;
+
+  if (!p_sim) {
+    memset(&perfect, 0, sizeof(perfect));
+    p_sim = &perfect;
   }
-#endif
+  d->test_state = calloc(1, sizeof(test_state_t));
+  cdio_cddap_sim_set(d, p_sim);
+}
 
-  return(sectors);
+/* set function pointers to use the simulated drive */
+int
+test_init_drive(cdrom_drive_t *d)
+{
+  int ret;
+
+  d->nsectors    = 13;
+  d->enable_cdda = test_enable_cdda;
+  d->set_speed   = test_setspeed;
+  d->read_toc    = cddap_readtoc;
+  d->read_audio  = test_read;
+
+  ret = d->tracks = d->read_toc(d);
+  if (d->tracks < 1)
+    return(ret);
+
+  d->opened      = 1;
+  d->error_retry = 1;
+
+  /* Settle the byte order on the image itself, before any faults
+     (or draws from the random sequence) come into play. */
+  if (-1 == d->bigendianp) {
+    test_state_t *ts = d->test_state;
+    cdda_sim_t sim = ts->sim;
+
+    memset(&ts->sim, 0, sizeof(ts->sim));
+    d->bigendianp = data_bigendianp(d);
+    ts->sim = sim;
+    ts->lastread = -1;
+    ts->cached = 0;
+  }
+  return(0);
 }
 
-/* set function pointers to use the ioctl routines */
-int test_init_drive (cdrom_drive *d){
+void
+test_free_drive(cdrom_drive_t *d)
+{
+  test_state_t *ts = d->test_state;
+
+  if (ts) {
+    free(ts->unreadable);
+    free(ts->slow);
+    free(ts->window);
+    free(ts->cache);
+    free(ts);
+    d->test_state = NULL;
+  }
+}
 
-  d->nsectors=13;
-  d->enable_cdda = dummy_exception;
-  d->read_audio = test_read;
-  d->read_toc = test_readtoc;
-  d->set_speed = dummy_exception;
-  d->tracks=d->read_toc(d);
-  if(d->tracks==-1)
-    return(d->tracks);
-  d->opened=1;
-  srand48(0);
-  return(0);
+void
+cdio_cddap_sim_init(cdda_sim_t *p_sim, int i_test_flags)
+{
+  static const int jitter_coeff[] = { 0, 4, 32, 128 };
+  static const int frag_coeff[]   = { 0, 256, 16, 8 };
+  int jitter = i_test_flags & 0x3;
+  int frag   = (i_test_flags >> 3) & 0x3;
+
+  memset(p_sim, 0, sizeof(*p_sim));
+
+  /* The distances jitter_read() and the old compile-time test models
+     use: coeff * [-1/2, 1/2) * CDIO_CD_FRAMESIZE_RAW/8 bytes. */
+  if (!jitter && frag)
+    jitter = frag == 3 ? 2 : 1;
+  p_sim->jitter_bytes = jitter_coeff[jitter] * CDIO_CD_FRAMESIZE_RAW / 16;
+  p_sim->jitter_percent = (i_test_flags & CDDA_TEST_ALWAYS_JITTER) ? 100 : 10;
+  p_sim->frag_bytes = frag_coeff[frag] * CDIO_CD_FRAMESIZE_RAW / 8;
+  if (i_test_flags & CDDA_TEST_UNDERRUN)
+    p_sim->short_percent = 100;
 }
 
-#endif
+int
+cdio_cddap_sim_set(cdrom_drive_t *d, const cdda_sim_t *p_sim)
+{
+  test_state_t *ts = d->test_state;
+
+  if (!ts) {
+    cderror(d, "405: Option not supported by drive\n");
+    return -405;
+  }
 
+  free(ts->unreadable);
+  free(ts->slow);
+  ts->sim = *p_sim;
+  ts->unreadable = NULL;
+  if (p_sim->n_unreadable > 0) {
+    ts->unreadable = malloc(p_sim->n_unreadable * sizeof(lsn_t));
+    memcpy(ts->unreadable, p_sim->unreadable,
+           p_sim->n_unreadable * sizeof(lsn_t));
+  } else
+    ts->sim.n_unreadable = 0;
+  ts->sim.unreadable = ts->unreadable;
+  ts->slow = NULL;
+  if (p_sim->n_slow > 0) {
+    ts->slow = malloc(p_sim->n_slow * sizeof(lsn_t));
+    memcpy(ts->slow, p_sim->slow, p_sim->n_slow * sizeof(lsn_t));
+  } else
+    ts->sim.n_slow = 0;
+  ts->sim.slow = ts->slow;
+  ts->lastread = -1;
+  ts->cached = 0;
+  d->c2 = p_sim->c2 ? 1 : -1;
+
+  seed_drive_random(d, p_sim->seed);
+  return 0;
+}
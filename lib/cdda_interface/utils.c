@@ -28,6 +28,105 @@
 
 #include "common_interface.h"
 #include "utils.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+/* The same 48-bit generator drand48() uses, and its default seed, but
+   kept per drive so concurrent drives don't share (or race on) it. */
+#define DRIVE_RAND_A    0x5DEECE66DULL
+#define DRIVE_RAND_C    0xBULL
+#define DRIVE_RAND_MASK ((1ULL << 48) - 1)
+#define DRIVE_RAND_SEED 0x1234ABCD330EULL
+
+void
+init_drive_state(cdrom_drive_t *d)
+{
+  d->rand_state=DRIVE_RAND_SEED;
+  d->read_next=-1;
+#ifdef HAVE_PTHREAD
+  {
+    pthread_mutex_t *lock=malloc(sizeof(*lock));
+    if(lock && pthread_mutex_init(lock,NULL)){
+      free(lock);
+      lock=NULL;
+    }
+    d->msg_lock=lock;
+  }
+#endif
+}
+
+void
+free_drive_state(cdrom_drive_t *d)
+{
+#ifdef HAVE_PTHREAD
+  if(d->msg_lock){
+    pthread_mutex_destroy(d->msg_lock);
+    free(d->msg_lock);
+  }
+#endif
+  d->msg_lock=NULL;
+  test_free_drive(d);
+}
+
+void
+lock_messages(cdrom_drive_t *d)
+{
+#ifdef HAVE_PTHREAD
+  if(d->msg_lock)pthread_mutex_lock(d->msg_lock);
+#endif
+}
+
+void
+unlock_messages(cdrom_drive_t *d)
+{
+#ifdef HAVE_PTHREAD
+  if(d->msg_lock)pthread_mutex_unlock(d->msg_lock);
+#endif
+}
+
+/* Restart the sequence, as srand48(seed) would. */
+void
+seed_drive_random(cdrom_drive_t *d, unsigned long seed)
+{
+  d->rand_state=(((uint64_t)seed<<16)|0x330E)&DRIVE_RAND_MASK;
+}
+
+/* Uniform in [0,1), like drand48(). */
+double
+drive_random(cdrom_drive_t *d)
+{
+  d->rand_state=(d->rand_state*DRIVE_RAND_A+DRIVE_RAND_C)&DRIVE_RAND_MASK;
+  return((double)d->rand_state/(double)(DRIVE_RAND_MASK+1));
+}
+
+void
+note_read_latency(cdrom_drive_t *d, lsn_t begin, long sectors, long usec,
+		  int retried)
+{
+  cdda_latency_t *l=&d->latency;
+  int series, bucket=0;
+
+  if(retried)
+    series=CDDA_LATENCY_RETRY;
+  else if(begin==d->read_next)
+    series=CDDA_LATENCY_SEQUENTIAL;
+  else
+    series=CDDA_LATENCY_SEEK;
+
+  if(usec<0)usec=0;
+  while(bucket<CDDA_LATENCY_BUCKETS-1 && usec>=(1L<<bucket))
+    bucket++;
+
+  l->count[series][bucket]++;
+  l->total_us[series]+=usec;
+  if(usec>l->max_us[series])
+    l->max_us[series]=usec;
+
+  /* After a failure we can't tell where the head is. */
+  d->read_next=(sectors>0 ? begin+sectors : -1);
+}
 void
 cderror(cdrom_drive_t *d,const char *s)
 {
@@ -40,7 +139,9 @@ cderror(cdrom_drive_t *d,const char *s)
 
       break;
     case CDDA_MESSAGE_LOGIT:
+      lock_messages(d);
       d->errorbuf=catstring(d->errorbuf,s);
+      unlock_messages(d);
       break;
     case CDDA_MESSAGE_FORGETIT:
     default:
@@ -59,7 +160,9 @@ cdmessage(cdrom_drive_t *d, const char *s)
       bytes_ret = write(STDERR_FILENO, s, strlen(s));
       break;
     case CDDA_MESSAGE_LOGIT:
+      lock_messages(d);
       d->messagebuf=catstring(d->messagebuf,s);
+      unlock_messages(d);
       break;
     case CDDA_MESSAGE_FORGETIT:
     default:
@@ -177,10 +280,10 @@ gettime(struct timespec *ts) {
 
 #if defined(HAVE_CLOCK_GETTIME)
   /* Use clock_gettime if available, preferably using the monotonic clock.
+     Nothing is cached, so concurrent callers don't race.
    */
-  static clockid_t clock = (clockid_t)-1;
-  if ((int)clock == -1) clock = (clock_gettime(CLOCK_MONOTONIC, ts) < 0 ? CLOCK_REALTIME : CLOCK_MONOTONIC);
-  ret = clock_gettime(clock, ts);
+  ret = clock_gettime(CLOCK_MONOTONIC, ts);
+  if (ret < 0) ret = clock_gettime(CLOCK_REALTIME, ts);
 #elif defined(WIN32)
   /* clock() returns wall time (not CPU time) on Windows, so we can use it here.
    */
@@ -79,3 +79,18 @@ void idperror(int messagedest, char **messages, const char *f, const char *s);
 
 void idmessage(int messagedest, char **messages, const char *f, const char *s);
 
+/* Per-drive state that must not be shared between drives: the
+   message lock and the simulated-jitter random generator. */
+void init_drive_state(cdrom_drive_t *d);
+void free_drive_state(cdrom_drive_t *d);
+void lock_messages(cdrom_drive_t *d);
+void unlock_messages(cdrom_drive_t *d);
+double drive_random(cdrom_drive_t *d);
+void seed_drive_random(cdrom_drive_t *d, unsigned long seed);
+
+/* Add a read command of usec microseconds to d->latency.  begin and
+   sectors are what it returned (sectors <= 0 on failure); retried is
+   nonzero for a command reissued after an error. */
+void note_read_latency(cdrom_drive_t *d, lsn_t begin, long sectors,
+                       long usec, int retried);
+
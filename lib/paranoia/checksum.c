@@ -0,0 +1,87 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* ===========================================================================
+ * Track checksums.
+ *
+ * A CRC-32 and the two AccurateRip checksums of a track, added up a
+ * buffer at a time as the track is written, so that no second pass over
+ * the written file is needed.  AccurateRip weighs each stereo sample,
+ * taken as one 32-bit little-endian word with the left channel in the
+ * low half, by its position in the track counting from 1: v1 is the sum
+ * of the products, v2 the sum of the high and low words of each 64-bit
+ * product.  The first five sectors of a disc's first track, less one
+ * sample, and the last five of its last track are left out, since
+ * drives with different read offsets can't all read them.
+ * ===========================================================================
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+# define __CDIO_CONFIG_H__ 1
+#endif
+
+#include <cdio/paranoia/cdda.h>
+#include <cdio/paranoia/paranoia.h>
+#include "crc32.h"
+
+/* samples AccurateRip leaves out at each end of a disc */
+#define AR_SKIP (5 * CD_FRAMESAMPLES)
+
+void cdio_paranoia_checksum_init(paranoia_checksum_t *c, long sectors,
+                                 int flags) {
+  c->crc32 = 0;
+  c->ar_v1 = 0;
+  c->ar_v2 = 0;
+  c->samples = 0;
+  c->ar_first = (flags & PARANOIA_CHECKSUM_FIRST) ? AR_SKIP : 1;
+  c->ar_last = sectors * CD_FRAMESAMPLES;
+  if (flags & PARANOIA_CHECKSUM_LAST)
+    c->ar_last = c->ar_last > AR_SKIP ? c->ar_last - AR_SKIP : 0;
+  c->bigendian = (flags & PARANOIA_CHECKSUM_BIGENDIAN) != 0;
+}
+
+void cdio_paranoia_checksum_add(paranoia_checksum_t *c, const void *buf,
+                                long bytes) {
+  const unsigned char *b = buf;
+  uint32_t n = bytes / 4;
+  uint32_t from = c->samples + 1; /* AccurateRip's weight for b[0..3] */
+  uint32_t first = from, last = from + n - 1;
+  uint32_t v1 = c->ar_v1, v2 = c->ar_v2;
+  uint32_t i;
+
+  c->crc32 = i_crc32(c->crc32, buf, bytes);
+  c->samples += n;
+
+  if (first < c->ar_first)
+    first = c->ar_first;
+  if (last > c->ar_last)
+    last = c->ar_last;
+
+  for (i = first; n && i <= last; i++) {
+    const unsigned char *s = b + (i - from) * 4;
+    uint32_t w = c->bigendian
+                     ? (s[1] | s[0] << 8 | s[3] << 16 | (uint32_t)s[2] << 24)
+                     : (s[0] | s[1] << 8 | s[2] << 16 | (uint32_t)s[3] << 24);
+    uint64_t p = (uint64_t)w * i;
+
+    v1 += (uint32_t)p;
+    v2 += (uint32_t)p + (uint32_t)(p >> 32);
+  }
+  c->ar_v1 = v1;
+  c->ar_v2 = v2;
+}
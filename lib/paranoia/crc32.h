@@ -0,0 +1,27 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _CRC32_H_
+#define _CRC32_H_
+
+#include <stddef.h>
+
+/* The CRC-32 of zlib, PNG and Ethernet: continue (crc), 0 to start,
+   over (len) bytes at (buf). */
+extern uint32_t i_crc32(uint32_t crc, const void *buf, size_t len);
+
+#endif /*_CRC32_H_*/
@@ -29,6 +29,12 @@
  * Collisions aren't due to hash collisions, as the table has one bucket
  * for each possible sample value.  Instead, the "collisions" represent
  * multiple occurrences of a given value.
+ *
+ * SORT_INDEX_SORTED is the alternative: a single array of vector
+ * positions ordered by (sample value, position), searched by binary
+ * search.  It needs no per-value heads at all and walks matches
+ * sequentially through memory instead of chasing pointers, at the cost
+ * of an O(log n) lookup per sort_getmatch().
  */
 
 #ifdef HAVE_CONFIG_H
@@ -53,16 +59,40 @@
  */
 
 sort_info_t *sort_alloc(long size) {
+  return sort_alloc_type(size, SORT_INDEX_BUCKETS);
+}
+
+/* ===========================================================================
+ * sort_alloc_type()
+ *
+ * Like sort_alloc(), but lets the caller pick the kind of index to build.
+ *
+ * The sorted index keeps two arrays of 32-bit positions (the result and
+ * a scratch copy for the radix sort) in the revindex allocation, which
+ * on LP64 hosts is exactly what the bucket index uses for its links.
+ * revindex is still what ipos() measures from, so match handles look
+ * the same to callers either way.
+ */
+
+sort_info_t *sort_alloc_type(long size, sort_index_t type) {
   sort_info_t *ret = calloc(1, sizeof(sort_info_t));
 
   ret->vector = NULL;
   ret->sortbegin = -1;
+  ret->key = -1;
   ret->size = -1;
   ret->maxsize = size;
+  ret->type = type;
 
-  ret->head = calloc(65536, sizeof(sort_link_t *));
-  ret->bucketusage = calloc(1, 65536 * sizeof(long));
-  ret->revindex = calloc(size, sizeof(sort_link_t));
+  if (type == SORT_INDEX_SORTED) {
+    ret->revindex =
+        calloc(size, max(sizeof(sort_link_t), 2 * sizeof(uint32_t)));
+    ret->sorted = (uint32_t *)ret->revindex;
+  } else {
+    ret->revindex = calloc(size, sizeof(sort_link_t));
+    ret->head = calloc(65536, sizeof(sort_link_t *));
+    ret->bucketusage = calloc(1, 65536 * sizeof(long));
+  }
   ret->lastbucket = 0;
 
   return (ret);
@@ -76,6 +106,13 @@ sort_info_t *sort_alloc(long size) {
  */
 
 void sort_unsortall(sort_info_t *i) {
+  if (i->type == SORT_INDEX_SORTED) {
+    i->nsorted = 0;
+    i->sortbegin = -1;
+    i->stale = 1;
+    return;
+  }
+
   /* If there were few enough different samples encountered (and hence few
    * enough buckets used), we can just zero out those buckets.  If there
    * were many (2000 is picked somewhat arbitrarily), it's faster simply to
@@ -92,6 +129,7 @@ void sort_unsortall(sort_info_t *i) {
 
   i->lastbucket = 0;
   i->sortbegin = -1;
+  i->stale = 1;
 
   /* Curiously, this function preserves the vector association created
    * by sort_setup(), but it is used only internally by sort_setup, so
@@ -112,6 +150,67 @@ void sort_free(sort_info_t *i) {
   free(i);
 }
 
+/* ===========================================================================
+ * Bucket lists (internal)
+ *
+ * Each bucket is a circular singly-linked list kept in order of position,
+ * and head[] points at its *last* node, so head[v]->next is the first
+ * occurrence of v.  That makes appending a later position, prepending an
+ * earlier one and dropping the first one all O(1), which is what lets
+ * sort_setup() grow or shrink an existing index at either end instead of
+ * rebuilding it.
+ */
+
+static inline void sort_link_add(sort_info_t *i, long j, int at_tail) {
+  /* i->vector[j] = the signed 16-bit sample to index.
+   * hv           = pointer to the last node of the list of occurences
+   *                of this sample
+   * l            = the node to associate with this sample
+   *
+   * We add 32768 to convert the signed 16-bit integer to an unsigned
+   * range from 0 to 65535.
+   *
+   * Note that l is located within i->revindex at a position
+   * corresponding to the sample's position in the vector.  This allows
+   * ipos() to determine the sample position from a returned sort_link.
+   */
+  sort_link_t **hv = i->head + i->vector[j] + 32768;
+  sort_link_t *l = i->revindex + j;
+
+  /* If this is the first time we've encountered this sample, add its
+   * bucket to the list of buckets used.  This list is used only for
+   * resetting the index quickly.
+   */
+  if (*hv == NULL) {
+    /* A bucket emptied by sort_link_drop_first() and refilled later is
+     * recorded twice; past 65536 entries sort_unsortall() just clears
+     * everything anyway.
+     */
+    if (i->lastbucket < 65536)
+      i->bucketusage[i->lastbucket] = i->vector[j] + 32768;
+    i->lastbucket++;
+    l->next = l;
+    *hv = l;
+    return;
+  }
+
+  l->next = (*hv)->next;
+  (*hv)->next = l;
+  if (at_tail)
+    *hv = l;
+}
+
+static inline void sort_link_drop_first(sort_info_t *i, long j) {
+  sort_link_t **hv = i->head + i->vector[j] + 32768;
+  sort_link_t *first = (*hv)->next;
+
+  /* Position j is the lowest one indexed, so it must be first in its list */
+  if (first == *hv)
+    *hv = NULL;
+  else
+    (*hv)->next = first->next;
+}
+
 /* ===========================================================================
  * sort_sort() (internal)
  *
@@ -123,45 +222,174 @@ void sort_free(sort_info_t *i) {
 static void sort_sort(sort_info_t *i, long sortlo, long sorthi) {
   long j;
 
-  /* We walk backward through the range to index because we insert new
-   * samples at the head of each bucket's list.  At the end, they'll be
-   * sorted from first to last occurrence.
+  for (j = sortlo; j < sorthi; j++)
+    sort_link_add(i, j, 1);
+
+  /* Mark the index as initialized.
    */
-  for (j = sorthi - 1; j >= sortlo; j--) {
-    /* i->vector[j] = the signed 16-bit sample to index.
-     * hv           = pointer to the head of the sorted list of occurences
-     *                of this sample
-     * l            = the node to associate with this sample
-     *
-     * We add 32768 to convert the signed 16-bit integer to an unsigned
-     * range from 0 to 65535.
-     *
-     * Note that l is located within i->revindex at a position
-     * corresponding to the sample's position in the vector.  This allows
-     * ipos() to determine the sample position from a returned sort_link.
-     */
-    sort_link_t **hv = i->head + i->vector[j] + 32768;
-    sort_link_t *l = i->revindex + j;
+  i->sortbegin = 0;
+  i->sortlo = sortlo;
+  i->sorthi = sorthi;
+}
 
-    /* If this is the first time we've encountered this sample, add its
-     * bucket to the list of buckets used.  This list is used only for
-     * resetting the index quickly.
-     */
-    if (*hv == NULL) {
-      i->bucketusage[i->lastbucket] = i->vector[j] + 32768;
-      i->lastbucket++;
+/* ===========================================================================
+ * sort_sorted_add() (internal)
+ *
+ * SORT_INDEX_SORTED counterpart of sort_sort(): adds the positions
+ * (sortlo - sorthi), none of which may already be indexed, to the sorted
+ * array.
+ *
+ * Two stable counting passes (low byte, then high byte of the biased
+ * sample value) order the new positions by value.  Since positions are
+ * fed in ascending order and both passes are stable, positions sharing a
+ * value stay in ascending order, just like the bucket lists.  The result
+ * is then merged into the existing entries from the back, so growing an
+ * index costs one sequential pass rather than a full re-sort.
+ */
+
+static inline int sort_sorted_before(const sort_info_t *i, uint32_t a,
+                                     uint32_t b) {
+  int va = i->vector[a], vb = i->vector[b];
+  return (va < vb || (va == vb && a < b));
+}
+
+static void sort_sorted_add(sort_info_t *i, long sortlo, long sorthi) {
+  long n = i->nsorted;
+  long m = sorthi - sortlo;
+  uint32_t *out = i->sorted;
+  uint32_t *stage = i->sorted + n; /* unused tail of the sorted array */
+  uint32_t *tmp = i->sorted + i->maxsize;
+  long count[256];
+  long j, sum;
+
+  if (m <= 0)
+    return;
+
+  /* Pass 1: scatter positions into stage by the low byte of the value. */
+  memset(count, 0, sizeof(count));
+  for (j = sortlo; j < sorthi; j++)
+    count[(i->vector[j] + 32768) & 0xff]++;
+  for (sum = 0, j = 0; j < 256; j++) {
+    long c = count[j];
+    count[j] = sum;
+    sum += c;
+  }
+  for (j = sortlo; j < sorthi; j++)
+    stage[count[(i->vector[j] + 32768) & 0xff]++] = (uint32_t)j;
+
+  /* Pass 2: scatter stage into tmp by the high byte. */
+  memset(count, 0, sizeof(count));
+  for (j = 0; j < m; j++)
+    count[(i->vector[stage[j]] + 32768) >> 8]++;
+  for (sum = 0, j = 0; j < 256; j++) {
+    long c = count[j];
+    count[j] = sum;
+    sum += c;
+  }
+  for (j = 0; j < m; j++)
+    tmp[count[(i->vector[stage[j]] + 32768) >> 8]++] = stage[j];
+
+  /* Merge tmp into the existing entries, largest first. */
+  {
+    long a = n - 1, b = m - 1, k = n + m - 1;
+    while (b >= 0) {
+      if (a >= 0 && sort_sorted_before(i, tmp[b], out[a]))
+        out[k--] = out[a--];
+      else
+        out[k--] = tmp[b--];
     }
+  }
 
-    /* Point the new node at the old head, then assign the new node as
-     * the new head.
-     */
-    l->next = *hv;
-    *hv = l;
+  i->nsorted = n + m;
+}
+
+/* ===========================================================================
+ * sort_find_sorted() (internal)
+ *
+ * Returns the slot of the first entry in the sorted index whose value is
+ * (val) (already biased by 32768) and whose position is at least (pos),
+ * or -1 if there is none before the current search limit i->hi.
+ */
+
+static long sort_find_sorted(sort_info_t *i, int val, long pos) {
+  long lo = 0, hi = i->nsorted;
+
+  while (lo < hi) {
+    long mid = lo + ((hi - lo) >> 1);
+    long p = i->sorted[mid];
+    int v = i->vector[p] + 32768;
+
+    if (v < val || (v == val && p < pos))
+      lo = mid + 1;
+    else
+      hi = mid;
   }
 
-  /* Mark the index as initialized.
-   */
-  i->sortbegin = 0;
+  if (lo < i->nsorted && i->vector[i->sorted[lo]] + 32768 == val &&
+      (long)i->sorted[lo] < i->hi)
+    return (lo);
+  return (-1);
+}
+
+/* ===========================================================================
+ * sort_update() (internal)
+ *
+ * Brings the index in line with the range (i->ilo - i->ihi) last passed
+ * to sort_setup(), building it from scratch if there is nothing to reuse.
+ *
+ * When the index already covers part of the range, only the difference
+ * is touched: samples now below the range are dropped, samples newly
+ * inside it are added.  Samples above the range are left in place; the
+ * searches never look past i->ihi, so they are simply invisible until a
+ * later range takes them back in.  The sorted index likewise leaves
+ * samples below the range in place, since its searches start at i->ilo.
+ */
+
+static void sort_update(sort_info_t *i) {
+  long j;
+
+  if (i->sortbegin != -1 &&
+      (i->ilo >= i->sorthi || i->ihi <= i->sortlo || i->ilo >= i->ihi))
+    sort_unsortall(i);
+
+  if (i->sortbegin == -1) {
+    if (i->type == SORT_INDEX_SORTED) {
+      sort_sorted_add(i, i->ilo, i->ihi);
+      i->sortbegin = 0;
+      i->sortlo = i->ilo;
+      i->sorthi = i->ihi;
+    } else {
+      sort_sort(i, i->ilo, i->ihi);
+    }
+    return;
+  }
+
+  if (i->type == SORT_INDEX_SORTED) {
+    if (i->ilo < i->sortlo) {
+      sort_sorted_add(i, i->ilo, i->sortlo);
+      i->sortlo = i->ilo;
+    }
+    if (i->ihi > i->sorthi) {
+      sort_sorted_add(i, i->sorthi, i->ihi);
+      i->sorthi = i->ihi;
+    }
+    return;
+  }
+
+  /* Drop leading samples that fell out of the range... */
+  for (j = i->sortlo; j < i->ilo; j++)
+    sort_link_drop_first(i, j);
+  /* ...add the ones that came into it at the front, last first so that
+   * each lands ahead of everything already in its list... */
+  for (j = i->sortlo - 1; j >= i->ilo; j--)
+    sort_link_add(i, j, 0);
+  /* ...and the ones that came into it at the back. */
+  for (j = i->sorthi; j < i->ihi; j++)
+    sort_link_add(i, j, 1);
+
+  i->sortlo = i->ilo;
+  if (i->ihi > i->sorthi)
+    i->sorthi = i->ihi;
 }
 
 /* ===========================================================================
@@ -182,21 +410,43 @@ static void sort_sort(sort_info_t *i, long sortlo, long sorthi) {
 
 void sort_setup(sort_info_t *i, int16_t *vector, long int *abspos,
                 long int size, long int sortlo, long int sorthi) {
-  /* Reset the index if it has already been built.
+  sort_setup_keyed(i, -1, vector, abspos, size, sortlo, sorthi);
+}
+
+/* ===========================================================================
+ * sort_setup_keyed()
+ *
+ * Like sort_setup(), but (key) names the contents of (vector): a caller
+ * promises that two calls with the same non-negative key, vector, abspos
+ * and size see identical samples.  In that case whatever part of the
+ * previous index still falls within (sortlo, sorthi) is kept and only
+ * the difference is indexed.  A negative key always starts over.
+ */
+
+void sort_setup_keyed(sort_info_t *i, long key, int16_t *vector,
+                      long int *abspos, long int size, long int sortlo,
+                      long int sorthi) {
+  /* Reset the index if it has already been built for something else.
    */
-  if (i->sortbegin != -1)
+  if (i->sortbegin != -1 &&
+      (key < 0 || key != i->key || vector != i->vector ||
+       abspos != i->abspos || *abspos != i->keypos || size != i->size))
     sort_unsortall(i);
 
+  i->key = key;
+  i->keypos = *abspos;
   i->vector = vector;
   i->size = size;
   i->abspos = abspos;
 
   /* Convert the absolute (sortlo, sorthi) to offsets within the vector.
-   * Note that the index will not be built until sort_getmatch() is called.
-   * Here we're simply hanging on to the range to index until then.
+   * Note that the index will not be built (or brought up to date) until
+   * sort_getmatch() is called.  Here we're simply hanging on to the range
+   * to index until then.
    */
-  i->lo = min(size, max(sortlo - *abspos, 0));
-  i->hi = max(0, min(sorthi - *abspos, size));
+  i->ilo = min(size, max(sortlo - *abspos, 0));
+  i->ihi = max(0, min(sorthi - *abspos, size));
+  i->stale = 1;
 }
 
 /* ===========================================================================
@@ -213,45 +463,53 @@ void sort_setup(sort_info_t *i, int16_t *vector, long int *abspos,
 
 sort_link_t *sort_getmatch(sort_info_t *i, long post, long overlap, int value) {
   sort_link_t *ret;
+  sort_link_t *last;
 
-  /* If the vector hasn't been indexed yet, index it now.
+  /* If the vector hasn't been indexed yet (or the range to index has
+   * moved since), index it now.
    */
-  if (i->sortbegin == -1)
-    sort_sort(i, i->lo, i->hi);
-  /* Now we reuse lo and hi */
+  if (i->stale) {
+    long long start = i_clock();
+    sort_update(i);
+    i->stale = 0;
+    i->buildtime += i_clock() - start;
+  }
 
   /* We'll only return samples within (overlap) samples of (post).
-   * Clamp the boundaries to search to the boundaries of the array,
-   * convert the signed sample to an unsigned offset, and store the
-   * state so that future calls to sort_nextmatch do the right thing.
-   *
-   * Reusing lo and hi this way is awful.
+   * Clamp the boundaries to search to the range that was asked to be
+   * indexed, convert the signed sample to an unsigned offset, and store
+   * the state so that future calls to sort_nextmatch do the right thing.
    */
   post = max(0, min(i->size, post));
   i->val = value + 32768;
-  i->lo = max(0, post - overlap);       /* absolute position */
-  i->hi = min(i->size, post + overlap); /* absolute position */
+  i->lo = max(i->ilo, post - overlap); /* absolute position */
+  i->hi = min(i->ihi, post + overlap); /* absolute position */
+
+  if (i->type == SORT_INDEX_SORTED) {
+    i->cursor = sort_find_sorted(i, i->val, i->lo);
+    return (i->cursor < 0 ? NULL : i->revindex + i->sorted[i->cursor]);
+  }
 
   /* Walk through the linked list of samples with this value, until
    * we find the first one within the bounds specified.  If there
    * aren't any, return NULL.
    */
-  ret = i->head[i->val];
-
-  while (ret) {
-    /* ipos() calculates the offset (in terms of the original vector)
-     * of this hit.
-     */
+  last = i->head[i->val];
+  if (!last)
+    return (NULL);
+  ret = last->next;
 
-    if (ipos(i, ret) < i->lo) {
-      ret = ret->next;
-    } else {
-      if (ipos(i, ret) >= i->hi)
-        ret = NULL;
-      break;
-    }
+  /* ipos() calculates the offset (in terms of the original vector)
+   * of this hit.
+   */
+  while (ipos(i, ret) < i->lo) {
+    if (ret == last)
+      return (NULL);
+    ret = ret->next;
   }
-  /*i->head[i->val]=ret;*/
+  if (ipos(i, ret) >= i->hi)
+    return (NULL);
+
   return (ret);
 }
 
@@ -266,12 +524,36 @@ sort_link_t *sort_getmatch(sort_info_t *i, long post, long overlap, int value) {
  */
 
 sort_link_t *sort_nextmatch(sort_info_t *i, sort_link_t *prev) {
-  sort_link_t *ret = prev->next;
+  sort_link_t *ret;
+
+  if (i->type == SORT_INDEX_SORTED) {
+    long c = i->cursor;
+
+    /* The common case is that (prev) is the match we handed out last,
+     * so the next one is simply the following slot.  Otherwise find
+     * our way back with a fresh search.
+     */
+    if (c >= 0 && i->revindex + i->sorted[c] == prev) {
+      c++;
+      if (c >= i->nsorted || i->vector[i->sorted[c]] + 32768 != i->val ||
+          (long)i->sorted[c] >= i->hi)
+        c = -1;
+    } else {
+      c = sort_find_sorted(i, i->val, ipos(i, prev) + 1);
+    }
+    i->cursor = c;
+    return (c < 0 ? NULL : i->revindex + i->sorted[c]);
+  }
+
+  /* The last node of the (circular) list links back to the first. */
+  if (prev == i->head[i->val])
+    return (NULL);
+  ret = prev->next;
 
-  /* If there aren't any more hits, or we've passed the boundary requested
-   * of sort_getmatch(), we're done.
+  /* If we've passed the boundary requested of sort_getmatch(), we're
+   * done.
    */
-  if (!ret || ipos(i, ret) >= i->hi)
+  if (ipos(i, ret) >= i->hi)
     return (NULL);
 
   return (ret);
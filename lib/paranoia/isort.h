@@ -25,6 +25,13 @@ typedef struct sort_link {
   struct sort_link *next;
 } sort_link_t;
 
+/* The two ways a sort_info_t can index its vector.  Both answer the
+   same sort_getmatch()/sort_nextmatch() queries. */
+typedef enum {
+  SORT_INDEX_BUCKETS = 0,  /* one linked list per sample value */
+  SORT_INDEX_SORTED  = 1   /* positions sorted by (value, position) */
+} sort_index_t;
+
 typedef struct sort_info {
   int16_t *vector;               /* vector (storage doesn't belong to us) */
 
@@ -37,6 +44,15 @@ typedef struct sort_info {
   long lo,hi;                    /* current post, overlap range */
   int  val;                      /* ...and val */
 
+  long ilo,ihi;                  /* range sort_setup() asked to index */
+  long sortlo,sorthi;            /* range actually indexed */
+  int  stale;                    /* index not yet brought up to ilo,ihi */
+  long key;                      /* sort_setup_keyed() key, or -1 */
+  long keypos;                   /* *abspos when the key was set */
+  long long buildtime;           /* ns spent building the index */
+
+  sort_index_t type;            /* which index is built below */
+
   /* sort structs */
   sort_link_t **head;           /* sort buckets (65536) */
 
@@ -44,6 +60,13 @@ typedef struct sort_info {
   long lastbucket;
   sort_link_t *revindex;
 
+  /* SORT_INDEX_SORTED only: the (value, position)-ordered positions
+     and the slot of the last match handed out.  Both live inside the
+     revindex allocation, which that index uses only for ipos(). */
+  uint32_t *sorted;
+  long nsorted;
+  long cursor;
+
 } sort_info_t;
 
 /*! ========================================================================
@@ -54,6 +77,14 @@ typedef struct sort_info {
  */
 extern sort_info_t *sort_alloc(long int size);
 
+/*! ========================================================================
+ * sort_alloc_type()
+ *
+ * Like sort_alloc(), but lets the caller pick the kind of index to
+ * build.  sort_alloc() builds SORT_INDEX_BUCKETS.
+ */
+extern sort_info_t *sort_alloc_type(long int size, sort_index_t type);
+
 /*! ========================================================================
  * sort_unsortall() (internal)
  *
@@ -80,6 +111,19 @@ extern void sort_unsortall(sort_info_t *i);
 extern void sort_setup(sort_info_t *i, int16_t *vector, long int *abspos,
                        long int size, long int sortlo, long int sorthi);
 
+/*! ========================================================================
+ * sort_setup_keyed()
+ *
+ * Like sort_setup(), but (key) names the contents of (vector): a caller
+ * promises that two calls with the same non-negative key, vector, abspos
+ * and size see identical samples.  In that case whatever part of the
+ * previous index still falls within (sortlo, sorthi) is kept and only
+ * the difference is indexed.  A negative key always starts over.
+ */
+extern void sort_setup_keyed(sort_info_t *i, long key, int16_t *vector,
+                             long int *abspos, long int size,
+                             long int sortlo, long int sorthi);
+
 /* =========================================================================
  * sort_free()
  *
@@ -0,0 +1,446 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/***
+ * Match-extension kernels for paranoia
+ *
+ * i_paranoia_overlap() and i_paranoia_overlap2() spend nearly all of
+ * their time walking two sample buffers in lock step looking for the
+ * first mismatch.  The kernels here do that walk several samples at a
+ * time with whatever vector unit the CPU has, and fall back to a plain
+ * loop everywhere else.
+ ***/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+# define __CDIO_CONFIG_H__ 1
+#endif
+
+#ifdef HAVE_STDINT_H
+# include <stdint.h>
+#endif
+#include <stddef.h>
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+
+#include "match.h"
+
+#if defined(__GNUC__) && defined(HAVE_IMMINTRIN_H) \
+  && (defined(__x86_64__) || defined(__i386__))
+# define MATCH_X86 1
+# include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(HAVE_ARM_NEON_H) \
+  && (defined(__ARM_NEON) || defined(__ARM_NEON__)) \
+  && !defined(__ARM_BIG_ENDIAN)
+# define MATCH_NEON 1
+# include <arm_neon.h>
+#endif
+
+#define MATCH_STOP(fa, fb)                          \
+  (((fa) & (fb) & MATCH_FLAG_EDGE) ||               \
+   (((fa) | (fb)) & MATCH_FLAG_UNREAD))
+
+/**** Scalar kernels ******************************************************/
+
+static long
+match_fwd_scalar(const int16_t *a, const int16_t *b, long n)
+{
+  long i;
+  for (i = 0; i < n; i++)
+    if (a[i] != b[i])
+      break;
+  return i;
+}
+
+static long
+match_back_scalar(const int16_t *a, const int16_t *b, long n)
+{
+  long i;
+  for (i = 0; i < n; i++)
+    if (a[-i] != b[-i])
+      break;
+  return i;
+}
+
+static long
+match_fwd_flags_scalar(const int16_t *a, const int16_t *b,
+                       const unsigned char *fa, const unsigned char *fb,
+                       long n)
+{
+  long i;
+  for (i = 0; i < n; i++)
+    if (a[i] != b[i] || MATCH_STOP(fa[i], fb[i]))
+      break;
+  return i;
+}
+
+static long
+match_back_flags_scalar(const int16_t *a, const int16_t *b,
+                        const unsigned char *fa, const unsigned char *fb,
+                        long n)
+{
+  long i;
+  for (i = 0; i < n; i++)
+    if (a[-i] != b[-i] || MATCH_STOP(fa[-i], fb[-i]))
+      break;
+  return i;
+}
+
+static const match_kernel_t match_scalar = {
+  "scalar",
+  match_fwd_scalar, match_back_scalar,
+  match_fwd_flags_scalar, match_back_flags_scalar
+};
+
+#ifdef MATCH_X86
+/**** SSE2 kernels (8 samples per step) ***********************************/
+
+/* ===========================================================================
+ * sse2_clean_mask()
+ *
+ * Returns a byte mask, one byte per sample in the low 8 lanes, that is
+ * 0xff where the flags allow the match to continue and 0 where
+ * MATCH_STOP() would end it.
+ */
+__attribute__((target("sse2"))) static inline __m128i
+sse2_clean_mask(const unsigned char *fa, const unsigned char *fb)
+{
+  const __m128i ga = _mm_loadl_epi64((const __m128i *)fa);
+  const __m128i gb = _mm_loadl_epi64((const __m128i *)fb);
+  const __m128i stop =
+    _mm_or_si128(_mm_and_si128(_mm_and_si128(ga, gb),
+                               _mm_set1_epi8(MATCH_FLAG_EDGE)),
+                 _mm_and_si128(_mm_or_si128(ga, gb),
+                               _mm_set1_epi8(MATCH_FLAG_UNREAD)));
+  return _mm_cmpeq_epi8(stop, _mm_setzero_si128());
+}
+
+__attribute__((target("sse2"))) static long
+match_fwd_sse2(const int16_t *a, const int16_t *b, long n)
+{
+  long i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    const __m128i eq =
+      _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a + i)),
+                      _mm_loadu_si128((const __m128i *)(b + i)));
+    const unsigned int m = (unsigned int)_mm_movemask_epi8(eq);
+    if (m != 0xffff)
+      return i + __builtin_ctz(~m) / 2;
+  }
+  return i + match_fwd_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("sse2"))) static long
+match_back_sse2(const int16_t *a, const int16_t *b, long n)
+{
+  long i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    const __m128i eq =
+      _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a - i - 7)),
+                      _mm_loadu_si128((const __m128i *)(b - i - 7)));
+    const unsigned int m = (unsigned int)_mm_movemask_epi8(eq);
+    if (m != 0xffff)
+      return i + (__builtin_clz(~m & 0xffff) - 16) / 2;
+  }
+  return i + match_back_scalar(a - i, b - i, n - i);
+}
+
+__attribute__((target("sse2"))) static long
+match_fwd_flags_sse2(const int16_t *a, const int16_t *b,
+                     const unsigned char *fa, const unsigned char *fb, long n)
+{
+  long i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    const __m128i eq =
+      _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a + i)),
+                      _mm_loadu_si128((const __m128i *)(b + i)));
+    const __m128i ok =
+      _mm_and_si128(_mm_packs_epi16(eq, eq), sse2_clean_mask(fa + i, fb + i));
+    const unsigned int m = (unsigned int)_mm_movemask_epi8(ok) & 0xff;
+    if (m != 0xff)
+      return i + __builtin_ctz(~m);
+  }
+  return i + match_fwd_flags_scalar(a + i, b + i, fa + i, fb + i, n - i);
+}
+
+__attribute__((target("sse2"))) static long
+match_back_flags_sse2(const int16_t *a, const int16_t *b,
+                      const unsigned char *fa, const unsigned char *fb,
+                      long n)
+{
+  long i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    const __m128i eq =
+      _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a - i - 7)),
+                      _mm_loadu_si128((const __m128i *)(b - i - 7)));
+    const __m128i ok =
+      _mm_and_si128(_mm_packs_epi16(eq, eq),
+                    sse2_clean_mask(fa - i - 7, fb - i - 7));
+    const unsigned int m = (unsigned int)_mm_movemask_epi8(ok) & 0xff;
+    if (m != 0xff)
+      return i + (__builtin_clz(~m & 0xff) - 24);
+  }
+  return i + match_back_flags_scalar(a - i, b - i, fa - i, fb - i, n - i);
+}
+
+static const match_kernel_t match_sse2 = {
+  "sse2",
+  match_fwd_sse2, match_back_sse2,
+  match_fwd_flags_sse2, match_back_flags_sse2
+};
+
+/**** AVX2 kernels (16 samples per step) **********************************/
+
+__attribute__((target("avx2"))) static inline unsigned int
+avx2_ok_mask(const int16_t *a, const int16_t *b,
+             const unsigned char *fa, const unsigned char *fb)
+{
+  const __m256i eq =
+    _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)a),
+                       _mm256_loadu_si256((const __m256i *)b));
+  const __m128i eq8 = _mm_packs_epi16(_mm256_castsi256_si128(eq),
+                                      _mm256_extracti128_si256(eq, 1));
+  const __m128i ga = _mm_loadu_si128((const __m128i *)fa);
+  const __m128i gb = _mm_loadu_si128((const __m128i *)fb);
+  const __m128i stop =
+    _mm_or_si128(_mm_and_si128(_mm_and_si128(ga, gb),
+                               _mm_set1_epi8(MATCH_FLAG_EDGE)),
+                 _mm_and_si128(_mm_or_si128(ga, gb),
+                               _mm_set1_epi8(MATCH_FLAG_UNREAD)));
+  const __m128i ok =
+    _mm_and_si128(eq8, _mm_cmpeq_epi8(stop, _mm_setzero_si128()));
+  return (unsigned int)_mm_movemask_epi8(ok);
+}
+
+__attribute__((target("avx2"))) static long
+match_fwd_avx2(const int16_t *a, const int16_t *b, long n)
+{
+  long i;
+  for (i = 0; i + 16 <= n; i += 16) {
+    const __m256i eq =
+      _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(a + i)),
+                         _mm256_loadu_si256((const __m256i *)(b + i)));
+    const unsigned int m = (unsigned int)_mm256_movemask_epi8(eq);
+    if (m != 0xffffffffU)
+      return i + __builtin_ctz(~m) / 2;
+  }
+  return i + match_fwd_sse2(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) static long
+match_back_avx2(const int16_t *a, const int16_t *b, long n)
+{
+  long i;
+  for (i = 0; i + 16 <= n; i += 16) {
+    const __m256i eq =
+      _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(a - i - 15)),
+                         _mm256_loadu_si256((const __m256i *)(b - i - 15)));
+    const unsigned int m = (unsigned int)_mm256_movemask_epi8(eq);
+    if (m != 0xffffffffU)
+      return i + __builtin_clz(~m) / 2;
+  }
+  return i + match_back_sse2(a - i, b - i, n - i);
+}
+
+__attribute__((target("avx2"))) static long
+match_fwd_flags_avx2(const int16_t *a, const int16_t *b,
+                     const unsigned char *fa, const unsigned char *fb, long n)
+{
+  long i;
+  for (i = 0; i + 16 <= n; i += 16) {
+    const unsigned int m = avx2_ok_mask(a + i, b + i, fa + i, fb + i);
+    if (m != 0xffff)
+      return i + __builtin_ctz(~m);
+  }
+  return i + match_fwd_flags_sse2(a + i, b + i, fa + i, fb + i, n - i);
+}
+
+__attribute__((target("avx2"))) static long
+match_back_flags_avx2(const int16_t *a, const int16_t *b,
+                      const unsigned char *fa, const unsigned char *fb,
+                      long n)
+{
+  long i;
+  for (i = 0; i + 16 <= n; i += 16) {
+    const unsigned int m =
+      avx2_ok_mask(a - i - 15, b - i - 15, fa - i - 15, fb - i - 15);
+    if (m != 0xffff)
+      return i + (__builtin_clz(~m & 0xffff) - 16);
+  }
+  return i + match_back_flags_sse2(a - i, b - i, fa - i, fb - i, n - i);
+}
+
+static const match_kernel_t match_avx2 = {
+  "avx2",
+  match_fwd_avx2, match_back_avx2,
+  match_fwd_flags_avx2, match_back_flags_avx2
+};
+#endif /* MATCH_X86 */
+
+#ifdef MATCH_NEON
+/**** NEON kernels (8 samples per step) ***********************************/
+
+/* Lane i of the 64-bit view is byte i, so on little-endian ARM the
+   first failing lane is found with ctz and the last with clz. */
+static inline uint64_t
+neon_eq_mask(const int16_t *a, const int16_t *b)
+{
+  const uint8x8_t eq = vmovn_u16(vceqq_s16(vld1q_s16(a), vld1q_s16(b)));
+  return vget_lane_u64(vreinterpret_u64_u8(eq), 0);
+}
+
+static inline uint64_t
+neon_ok_mask(const int16_t *a, const int16_t *b,
+             const unsigned char *fa, const unsigned char *fb)
+{
+  const uint8x8_t eq = vmovn_u16(vceqq_s16(vld1q_s16(a), vld1q_s16(b)));
+  const uint8x8_t ga = vld1_u8(fa);
+  const uint8x8_t gb = vld1_u8(fb);
+  const uint8x8_t stop =
+    vorr_u8(vand_u8(vand_u8(ga, gb), vdup_n_u8(MATCH_FLAG_EDGE)),
+            vand_u8(vorr_u8(ga, gb), vdup_n_u8(MATCH_FLAG_UNREAD)));
+  const uint8x8_t ok = vand_u8(eq, vceq_u8(stop, vdup_n_u8(0)));
+  return vget_lane_u64(vreinterpret_u64_u8(ok), 0);
+}
+
+static long
+match_fwd_neon(const int16_t *a, const int16_t *b, long n)
+{
+  long i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    const uint64_t m = neon_eq_mask(a + i, b + i);
+    if (m != ~(uint64_t)0)
+      return i + __builtin_ctzll(~m) / 8;
+  }
+  return i + match_fwd_scalar(a + i, b + i, n - i);
+}
+
+static long
+match_back_neon(const int16_t *a, const int16_t *b, long n)
+{
+  long i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    const uint64_t m = neon_eq_mask(a - i - 7, b - i - 7);
+    if (m != ~(uint64_t)0)
+      return i + __builtin_clzll(~m) / 8;
+  }
+  return i + match_back_scalar(a - i, b - i, n - i);
+}
+
+static long
+match_fwd_flags_neon(const int16_t *a, const int16_t *b,
+                     const unsigned char *fa, const unsigned char *fb, long n)
+{
+  long i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    const uint64_t m = neon_ok_mask(a + i, b + i, fa + i, fb + i);
+    if (m != ~(uint64_t)0)
+      return i + __builtin_ctzll(~m) / 8;
+  }
+  return i + match_fwd_flags_scalar(a + i, b + i, fa + i, fb + i, n - i);
+}
+
+static long
+match_back_flags_neon(const int16_t *a, const int16_t *b,
+                      const unsigned char *fa, const unsigned char *fb,
+                      long n)
+{
+  long i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    const uint64_t m =
+      neon_ok_mask(a - i - 7, b - i - 7, fa - i - 7, fb - i - 7);
+    if (m != ~(uint64_t)0)
+      return i + __builtin_clzll(~m) / 8;
+  }
+  return i + match_back_flags_scalar(a - i, b - i, fa - i, fb - i, n - i);
+}
+
+static const match_kernel_t match_neon = {
+  "neon",
+  match_fwd_neon, match_back_neon,
+  match_fwd_flags_neon, match_back_flags_neon
+};
+#endif /* MATCH_NEON */
+
+/**** Dispatch ************************************************************/
+
+const match_kernel_t *i_match = &match_scalar;
+
+static const match_kernel_t *match_list[4];
+
+/* ===========================================================================
+ * match_probe()
+ *
+ * Probes the CPU, fills in every kernel set it can run, from slowest
+ * to fastest, and makes the fastest the one in use.  Runs once.
+ */
+static void
+match_probe(void)
+{
+  int n = 0;
+  const match_kernel_t *list[4] = {NULL, NULL, NULL, NULL};
+
+  list[n++] = &match_scalar;
+#ifdef MATCH_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2"))
+    list[n++] = &match_sse2;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse2"))
+    list[n++] = &match_avx2;
+#endif
+#ifdef MATCH_NEON
+  list[n++] = &match_neon;
+#endif
+  i_match = list[n - 1];
+  for (n--; n >= 0; n--)
+    match_list[n] = list[n];
+}
+
+#ifdef HAVE_PTHREAD
+static pthread_once_t match_once = PTHREAD_ONCE_INIT;
+#endif
+
+/* ===========================================================================
+ * i_match_available()
+ *
+ * Returns every kernel set this CPU can run, from slowest to fastest.
+ */
+const match_kernel_t *const *
+i_match_available(void)
+{
+#ifdef HAVE_PTHREAD
+  pthread_once(&match_once, match_probe);
+#else
+  if (!match_list[0])
+    match_probe();
+#endif
+  return match_list;
+}
+
+/* ===========================================================================
+ * i_match_init()
+ *
+ * Selects the fastest kernel set for this CPU.  Called from
+ * paranoia_init(); safe to call more than once, from any thread.
+ */
+void
+i_match_init(void)
+{
+  i_match_available();
+}
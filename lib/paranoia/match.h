@@ -0,0 +1,60 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _MATCH_H_
+#define _MATCH_H_
+
+#include <stdint.h>
+
+/* Per-sample read flag bits the flag-aware kernels stop on.  These
+   must agree with FLAGS_EDGE and FLAGS_UNREAD in paranoia.c. */
+#define MATCH_FLAG_EDGE   0x1
+#define MATCH_FLAG_UNREAD 0x2
+
+/* A set of match-extension kernels.  Each returns the number of
+   consecutive samples, starting at a[0]/b[0], for which a[i] == b[i].
+
+   The forward kernels walk a[0], a[1], ... a[n-1]; the backward
+   kernels walk a[0], a[-1], ... a[-(n-1)].
+
+   The _flags variants additionally stop at the first sample where
+   both flag bytes have MATCH_FLAG_EDGE set, or either has
+   MATCH_FLAG_UNREAD set.  The caller decides what to do with the
+   sample that stopped the scan. */
+typedef struct match_kernel_s {
+  const char *name;
+  long (*fwd)(const int16_t *a, const int16_t *b, long n);
+  long (*back)(const int16_t *a, const int16_t *b, long n);
+  long (*fwd_flags)(const int16_t *a, const int16_t *b,
+                    const unsigned char *fa, const unsigned char *fb, long n);
+  long (*back_flags)(const int16_t *a, const int16_t *b,
+                     const unsigned char *fa, const unsigned char *fb,
+                     long n);
+} match_kernel_t;
+
+/* The kernel set used by the matching code.  Starts out as the
+   portable scalar set; i_match_init() picks the best one the CPU
+   supports. */
+extern const match_kernel_t *i_match;
+
+extern void i_match_init(void);
+
+/* NULL-terminated list of every kernel set usable on this CPU, best
+   last.  The scalar set is always first. */
+extern const match_kernel_t *const *i_match_available(void);
+
+#endif /*_MATCH_H_*/
@@ -62,6 +62,7 @@ void paranoia_resetall(cdrom_paranoia_t *p) {
   p->root.returnedlimit = 0;
   p->dyndrift = 0;
   p->root.lastsector = 0;
+  p->skipbegin = p->skipend = 0;
 
   if (p->root.vector) {
     i_cblock_destructor(p->root.vector);
@@ -101,6 +102,10 @@ void i_paranoia_trim(cdrom_paranoia_t *p, long int beginword,
         c = next;
       }
     }
+
+    /* Fragments that end before the root now begins can't be merged
+       into it any more. */
+    v_index_evict(p, target);
   }
   return;
 
@@ -139,8 +144,7 @@ void offset_adjust_settings(cdrom_paranoia_t *p,
     if (labs(av) > p->dynoverlap / 4) {
       av = (av / MIN_SECTOR_EPSILON) * MIN_SECTOR_EPSILON;
 
-      if (callback)
-        (*callback)(ce(p->root.vector), PARANOIA_CB_DRIFT);
+      i_callback(p, callback, ce(p->root.vector), PARANOIA_CB_DRIFT);
       p->dyndrift += av;
 
       /* Adjust all the values in the cache otherwise we get a
@@ -149,9 +153,13 @@ void offset_adjust_settings(cdrom_paranoia_t *p,
         c_block_t *c = c_first(p);
         v_fragment_t *v = v_first(p);
 
-        while (v && v->one) {
+        /* every fragment, so that each stays inside its block, where
+           free_c_block() looks for it */
+        while (v) {
           /* safeguard beginning bounds case with a hammer */
-          if (fb(v) < av || cb(v->one) < av) {
+          if (!v->one) {
+            ;
+          } else if (fb(v) < av || cb(v->one) < av) {
             v->one = NULL;
           } else {
             fb(v) -= av;
@@ -163,6 +171,7 @@ void offset_adjust_settings(cdrom_paranoia_t *p,
           c_set(c, cb(c) - adj);
           c = c_next(c);
         }
+        v_index_resort(p);
       }
 
       p->stage2.offaccum = 0;
@@ -193,8 +202,7 @@ void offset_adjust_settings(cdrom_paranoia_t *p,
     if (p->dynoverlap > MAX_SECTOR_OVERLAP * CD_FRAMEWORDS)
       p->dynoverlap = MAX_SECTOR_OVERLAP * CD_FRAMEWORDS;
 
-    if (callback)
-      (*callback)(p->dynoverlap, PARANOIA_CB_OVERLAP);
+    i_callback(p, callback, p->dynoverlap, PARANOIA_CB_OVERLAP);
 
     if (p->stage1.offpoints > 600) { /* bit of a bug; this routine is
                                         called too often due to the overlap
@@ -19,10 +19,17 @@
 # include <string.h>
 #endif
 
+#include <time.h>
+#ifdef HAVE_SYS_TIME_H
+# include <sys/time.h>
+#endif
+
 #include <cdio/paranoia/cdda.h>
 #include <cdio/paranoia/paranoia.h>
 #include <limits.h>
 #include "p_block.h"
+#include "match.h"
+#include "reader.h"
 
 linked_list_t *new_list(void *(*newp)(void), void (*freep)(void *)) {
   linked_list_t *ret = calloc(1, sizeof(linked_list_t));
@@ -31,9 +38,17 @@ linked_list_t *new_list(void *(*newp)(void), void (*freep)(void *)) {
   return (ret);
 }
 
+/* The most freed elements a list keeps around for reuse. */
+#define MAX_SPARE_ELEMS 64
+
 linked_element *add_elem(linked_list_t *l, void *elem) {
 
-  linked_element *ret = calloc(1, sizeof(linked_element));
+  linked_element *ret = l->spare;
+  if (ret) {
+    l->spare = ret->next;
+    l->nspare--;
+  } else
+    ret = calloc(1, sizeof(linked_element));
   ret->stamp = l->current++;
   ret->ptr = elem;
   ret->list = l;
@@ -71,12 +86,22 @@ void free_elem(linked_element *e, int free_ptr) {
     e->next->prev = e->prev;
 
   l->active--;
-  free(e);
+  if (l->nspare < MAX_SPARE_ELEMS) {
+    e->next = l->spare;
+    l->spare = e;
+    l->nspare++;
+  } else
+    free(e);
 }
 
 void free_list(linked_list_t *list, int free_ptr) {
   while (list->head)
     free_elem(list->head, free_ptr);
+  while (list->spare) {
+    linked_element *e = list->spare;
+    list->spare = e->next;
+    free(e);
+  }
   free(list);
 }
 
@@ -100,17 +125,59 @@ static c_block_t *i_cblock_constructor(cdrom_paranoia_t *p) {
   return (ret);
 }
 
+/* The start of v's allocations.  The root is trimmed from the front
+   by advancing vector and flags past (head) dead samples; they are
+   reclaimed when the buffer next needs room. */
+#define c_base(v) ((v)->vector ? (v)->vector - (v)->head : NULL)
+#define c_flags_base(v) ((v)->flags ? (v)->flags - (v)->head : NULL)
+
+/* Detach v from its pinned buffer; the pin now owns it. */
+static void c_retire(c_block_t *v) {
+  v->pin->owner = NULL;
+  v->pin = NULL;
+}
+
 void i_cblock_destructor(c_block_t *c) {
   if (c) {
-    if (c->vector)
-      free(c->vector);
-    if (c->flags)
-      free(c->flags);
+    if (c->pin)
+      c_retire(c);
+    else if (c->p)
+      c_pool_release(c->p, c_base(c), NULL, c->alloc);
+    else if (c->vector)
+      free(c_base(c));
+    if (c->p)
+      c_pool_release(c->p, NULL, c_flags_base(c), c->alloc);
+    else if (c->flags)
+      free(c_flags_base(c));
     c->e = NULL;
     free(c);
   }
 }
 
+/* Give v's buffers back, as i_cblock_destructor() would, and have it
+   hold (size) samples from (begin) in (vector) instead: a buffer of
+   (alloc) samples from the pool, without flags. */
+void c_replace(c_block_t *v, int16_t *vector, long begin, long size,
+               long alloc) {
+  if (v->pin)
+    c_retire(v);
+  else if (v->p)
+    c_pool_release(v->p, c_base(v), NULL, v->alloc);
+  else
+    free(c_base(v));
+  if (v->p)
+    c_pool_release(v->p, NULL, c_flags_base(v), v->alloc);
+  else
+    free(c_flags_base(v));
+
+  v->vector = vector;
+  v->flags = NULL;
+  v->head = 0;
+  v->begin = begin;
+  v->size = size;
+  v->alloc = alloc;
+}
+
 c_block_t *new_c_block(cdrom_paranoia_t *p) {
   linked_element *e = new_elem(p->cache);
   c_block_t *c = e->ptr;
@@ -120,15 +187,16 @@ c_block_t *new_c_block(cdrom_paranoia_t *p) {
 }
 
 void free_c_block(c_block_t *c) {
-  /* also rid ourselves of v_fragments that reference this block */
-  v_fragment_t *v = v_first(c->p);
+  /* also rid ourselves of v_fragments that reference this block, all
+     of which lie within it */
+  v_fragment_t *v;
+  long pos = -1;
 
-  while (v) {
-    v_fragment_t *next = v_next(v);
-    if (v->one == c)
+  while ((v = v_overlap_next(c->p, cb(c), ce(c), &pos)) != NULL)
+    if (v->one == c) {
       free_v_fragment(v);
-    v = next;
-  }
+      pos--;
+    }
 
   free_elem(c->e, 1);
 }
@@ -140,6 +208,151 @@ static v_fragment_t *i_vfragment_constructor(void) {
 
 static void i_v_fragment_destructor(v_fragment_t *v) { free(v); }
 
+/**** Fragment index ****************************************************/
+
+/* Position of the first item in ix beginning after (begin). */
+static long v_index_after(v_index_t *ix, long begin) {
+  long lo = 0, hi = ix->count;
+  while (lo < hi) {
+    long mid = (lo + hi) >> 1;
+    if (ix->items[mid]->begin <= begin)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return (lo);
+}
+
+static void v_index_add(v_index_t *ix, v_fragment_t *v) {
+  long pos;
+
+  if (ix->count == ix->alloc) {
+    ix->alloc = ix->alloc ? ix->alloc * 2 : 64;
+    ix->items = realloc(ix->items, ix->alloc * sizeof(v_fragment_t *));
+  }
+  if (v->size > ix->maxsize)
+    ix->maxsize = v->size;
+  v->snapslot = -1; /* not in the snapshot being worked through */
+  /* after any others with the same begin, as the age order would be */
+  pos = v_index_after(ix, v->begin);
+  memmove(ix->items + pos + 1, ix->items + pos,
+          (ix->count - pos) * sizeof(v_fragment_t *));
+  ix->items[pos] = v;
+  ix->count++;
+}
+
+/* Clear v's entry in the snapshot, if it has one. */
+static void v_snap_clear(v_index_t *ix, v_fragment_t *v) {
+  if (v->snapslot >= 0 && v->snapslot < ix->nsnap &&
+      ix->snap[v->snapslot] == v)
+    ix->snap[v->snapslot] = NULL;
+  v->snapslot = -1;
+}
+
+static void v_index_remove(v_index_t *ix, v_fragment_t *v) {
+  long pos = v_index_after(ix, v->begin - 1);
+
+  while (pos < ix->count && ix->items[pos] != v &&
+         ix->items[pos]->begin == v->begin)
+    pos++;
+  if (pos >= ix->count || ix->items[pos] != v)
+    /* out of order (shouldn't happen); look everywhere */
+    for (pos = 0; pos < ix->count && ix->items[pos] != v; pos++)
+      ;
+  if (pos < ix->count) {
+    ix->count--;
+    memmove(ix->items + pos, ix->items + pos + 1,
+            (ix->count - pos) * sizeof(v_fragment_t *));
+  }
+  if (ix->count == 0)
+    ix->maxsize = 0;
+  v_snap_clear(ix, v);
+}
+
+/* Take a snapshot of the fragments in order of position, for a pass
+   that may free some of them.  Entries for fragments freed since are
+   NULL.  The snapshot lasts until the next call. */
+long v_snapshot(cdrom_paranoia_t *p, v_fragment_t ***list) {
+  v_index_t *ix = &p->fragindex;
+  long i;
+
+  if (ix->snapalloc < ix->count) {
+    ix->snapalloc = ix->alloc;
+    ix->snap = realloc(ix->snap, ix->snapalloc * sizeof(v_fragment_t *));
+  }
+  for (i = 0; i < ix->count; i++) {
+    ix->snap[i] = ix->items[i];
+    ix->snap[i]->snapslot = i;
+  }
+  ix->nsnap = ix->count;
+  *list = ix->snap;
+  return (ix->nsnap);
+}
+
+/* Restore the order after fragment positions have been adjusted in
+   place.  They nearly always move together, so this is close to
+   linear. */
+void v_index_resort(cdrom_paranoia_t *p) {
+  v_index_t *ix = &p->fragindex;
+  long i, j;
+
+  for (i = 1; i < ix->count; i++) {
+    v_fragment_t *v = ix->items[i];
+    for (j = i; j > 0 && ix->items[j - 1]->begin > v->begin; j--)
+      ix->items[j] = ix->items[j - 1];
+    ix->items[j] = v;
+  }
+}
+
+/* The fragments overlapping [begin, end), in order of position: start
+   with *pos at -1, and call again for the next until it returns NULL.
+   Freeing the fragment just returned is allowed if *pos is then
+   decremented. */
+v_fragment_t *v_overlap_next(cdrom_paranoia_t *p, long begin, long end,
+                             long *pos) {
+  v_index_t *ix = &p->fragindex;
+
+  /* nothing beginning maxsize or more before begin reaches it */
+  if (*pos < 0)
+    *pos = v_index_after(ix, begin - ix->maxsize);
+  while (*pos < ix->count && ix->items[*pos]->begin < end) {
+    v_fragment_t *v = ix->items[(*pos)++];
+    if (fe(v) > begin)
+      return (v);
+  }
+  return (NULL);
+}
+
+/* Free every fragment that ends at or before (end), with a single pass
+   over the index rather than a removal for each. */
+void v_index_evict(cdrom_paranoia_t *p, long end) {
+  v_index_t *ix = &p->fragindex;
+  long limit = v_index_after(ix, end - 1);
+  long i, kept = 0;
+
+  for (i = 0; i < limit; i++) {
+    v_fragment_t *v = ix->items[i];
+    if (fe(v) <= end) {
+      v_snap_clear(ix, v);
+      free_elem(v->e, 1);
+    } else
+      ix->items[kept++] = v;
+  }
+  memmove(ix->items + kept, ix->items + limit,
+          (ix->count - limit) * sizeof(v_fragment_t *));
+  ix->count -= limit - kept;
+  if (ix->count == 0)
+    ix->maxsize = 0;
+}
+
+void v_index_free(cdrom_paranoia_t *p) {
+  free(p->fragindex.items);
+  free(p->fragindex.snap);
+  memset(&p->fragindex, 0, sizeof(v_index_t));
+}
+
+/**** V_fragment stuff **************************************************/
+
 v_fragment_t *new_v_fragment(cdrom_paranoia_t *p, c_block_t *one,
                              long int begin, long int end, int last) {
   linked_element *e = new_elem(p->fragments);
@@ -153,6 +366,7 @@ v_fragment_t *new_v_fragment(cdrom_paranoia_t *p, c_block_t *one,
   b->vector = one->vector + begin - one->begin;
   b->size = end - begin;
   b->lastsector = last;
+  v_index_add(&p->fragindex, b);
 
 #if TRACE_PARANOIA
   fprintf(stderr, "- Verified [%ld-%ld] (0x%04X...0x%04X)%s\n", begin, end,
@@ -163,7 +377,10 @@ v_fragment_t *new_v_fragment(cdrom_paranoia_t *p, c_block_t *one,
   return (b);
 }
 
-void free_v_fragment(v_fragment_t *v) { free_elem(v->e, 1); }
+void free_v_fragment(v_fragment_t *v) {
+  v_index_remove(&v->p->fragindex, v);
+  free_elem(v->e, 1);
+}
 
 c_block_t *c_first(cdrom_paranoia_t *p) {
   if (p->cache->head)
@@ -237,26 +454,99 @@ c_block_t *c_alloc(int16_t *vector, long begin, long size) {
   c->vector = vector;
   c->begin = begin;
   c->size = size;
+  c->alloc = size;
   return (c);
 }
 
 void c_set(c_block_t *v, long begin) { v->begin = begin; }
 
+/* Slide v's samples (and flags) down over its dead head. */
+static void c_compact(c_block_t *v) {
+  if (!v->head)
+    return;
+  memmove(v->vector - v->head, v->vector, sizeof(int16_t) * cs(v));
+  v->vector -= v->head;
+  if (v->flags) {
+    memmove(v->flags - v->head, v->flags, cs(v));
+    v->flags -= v->head;
+  }
+  v->head = 0;
+}
+
+/* Make sure v->vector has room for (size) samples.  The root grows a
+   fragment at a time, so grow geometrically rather than realloc on
+   every append.  Space trimmed off the front is reused first, but only
+   when that leaves a third of the buffer free, so every slide is paid
+   for by at least size/2 samples appended since the last one.  A
+   borrowed vector is never touched; v moves to a new one instead. */
+static void c_reserve(c_block_t *v, long size) {
+  long alloc;
+
+  if (v->head + size <= v->alloc && !v->pin)
+    return;
+
+  if (!v->pin && size + size / 2 <= v->alloc) {
+    c_compact(v);
+    return;
+  }
+
+  alloc = v->alloc;
+  if (size + size / 2 > alloc)
+    alloc = max(size, alloc + alloc / 2);
+  if (v->pin || v->head) {
+    int16_t *moved;
+    /* A recycled read buffer will do if it is big enough. */
+    if (v->p && alloc <= v->p->pool.words) {
+      alloc = v->p->pool.words;
+      moved = c_pool_vector(v->p, alloc);
+    } else
+      moved = malloc(sizeof(int16_t) * alloc);
+    memcpy(moved, v->vector, sizeof(int16_t) * cs(v));
+    if (v->pin)
+      c_retire(v);
+    else if (v->p)
+      c_pool_release(v->p, c_base(v), NULL, v->alloc);
+    else
+      free(c_base(v));
+    v->vector = moved;
+  } else if (v->vector)
+    v->vector = realloc(v->vector, sizeof(int16_t) * alloc);
+  else
+    v->vector = calloc(1, sizeof(int16_t) * alloc);
+  if (v->flags) {
+    if (v->head) {
+      memmove(v->flags - v->head, v->flags, cs(v));
+      v->flags -= v->head;
+    }
+    v->flags = realloc(v->flags, alloc);
+  }
+  v->head = 0;
+  v->alloc = alloc;
+}
+
 /* pos here is vector position from zero */
 void c_insert(c_block_t *v, long pos, int16_t *b, long size) {
   int vs = cs(v);
   if (pos < 0 || pos > vs)
     return;
 
-  if (v->vector) {
-    v->vector = realloc(v->vector, sizeof(int16_t) * (size + vs));
+  if (!v->pin && size <= v->head && pos < vs - pos) {
+    /* Rifts near the front open into the dead head instead of
+       pushing the whole tail along. */
+    memmove(v->vector - size, v->vector, pos * sizeof(int16_t));
+    v->vector -= size;
+    if (v->flags) {
+      memmove(v->flags - size, v->flags, pos);
+      v->flags -= size;
+    }
+    v->head -= size;
   } else {
-    v->vector = calloc(1, sizeof(int16_t) * size);
-  }
+    c_reserve(v, size + vs);
 
-  if (pos < vs)
-    memmove(v->vector + pos + size, v->vector + pos,
-            (vs - pos) * sizeof(int16_t));
+    if (pos < vs)
+      memmove(v->vector + pos + size, v->vector + pos,
+              (vs - pos) * sizeof(int16_t));
+  }
   memcpy(v->vector + pos, b, size * sizeof(int16_t));
 
   v->size += size;
@@ -273,8 +563,19 @@ void c_remove(c_block_t *v, long cutpos, long cutsize) {
   if (cutsize < 1)
     return;
 
-  memmove(v->vector + cutpos, v->vector + cutpos + cutsize,
-          (vs - cutpos - cutsize) * sizeof(int16_t));
+  if (!v->pin && cutpos < vs - cutpos - cutsize) {
+    /* Closing the gap from the front moves fewer samples; borrowed
+       ones (which all precede a cut) must stay put, though. */
+    memmove(v->vector + cutsize, v->vector, cutpos * sizeof(int16_t));
+    v->vector += cutsize;
+    if (v->flags) {
+      memmove(v->flags + cutsize, v->flags, cutpos);
+      v->flags += cutsize;
+    }
+    v->head += cutsize;
+  } else
+    memmove(v->vector + cutpos, v->vector + cutpos + cutsize,
+            (vs - cutpos - cutsize) * sizeof(int16_t));
 
   v->size -= cutsize;
 }
@@ -294,21 +595,185 @@ void c_append(c_block_t *v, int16_t *vector, long size) {
   int vs = cs(v);
 
   /* update the vector */
-  if (v->vector)
-    v->vector = realloc(v->vector, sizeof(int16_t) * (size + vs));
-  else {
-    v->vector = calloc(1, sizeof(int16_t) * size);
-  }
+  c_reserve(v, size + vs);
   memcpy(v->vector + vs, vector, sizeof(int16_t) * size);
 
   v->size += size;
 }
 
+/* Drop (cut) samples off the front in constant time.  Nothing moves,
+   so this is safe even while v is borrowed from. */
 void c_removef(c_block_t *v, long cut) {
-  c_remove(v, 0, cut);
+  if (cut > 0 && cut <= cs(v)) {
+    v->vector += cut;
+    if (v->flags)
+      v->flags += cut;
+    v->head += cut;
+    v->size -= cut;
+  } else
+    c_remove(v, 0, cut);
   v->begin += cut;
 }
 
+/**** Buffer pool ********************************************************/
+
+/* The most buffers of each kind the pool holds on to. */
+#define MAX_POOL_SPARE 4
+
+/* Forget buffers of any other size. */
+static void c_pool_resize(c_pool_t *pool, long words) {
+  if (pool->words == words)
+    return;
+  while (pool->vectors) {
+    void *next = *(void **)pool->vectors;
+    free(pool->vectors);
+    pool->vectors = next;
+  }
+  while (pool->flags) {
+    void *next = *(void **)pool->flags;
+    free(pool->flags);
+    pool->flags = next;
+  }
+  pool->nvectors = pool->nflags = 0;
+  pool->words = words;
+}
+
+/* A sample buffer of (words) samples.  Unlike calloc(), a recycled
+   buffer is not cleared; i_read_c_block() writes every sample it
+   keeps. */
+int16_t *c_pool_vector(cdrom_paranoia_t *p, long words) {
+  c_pool_t *pool = &p->pool;
+  void *ret;
+
+  c_pool_resize(pool, words);
+  if (!pool->vectors)
+    return (malloc(sizeof(int16_t) * words));
+  ret = pool->vectors;
+  pool->vectors = *(void **)ret;
+  pool->nvectors--;
+  return (ret);
+}
+
+/* A cleared flag array of (words) entries. */
+unsigned char *c_pool_flags(cdrom_paranoia_t *p, long words) {
+  c_pool_t *pool = &p->pool;
+  void *ret;
+
+  c_pool_resize(pool, words);
+  if (!pool->flags)
+    return (calloc(words, 1));
+  ret = pool->flags;
+  pool->flags = *(void **)ret;
+  pool->nflags--;
+  memset(ret, 0, words);
+  return (ret);
+}
+
+/* Give back (vector) and (flags), either of which may be NULL, each
+   (words) entries long.  Buffers that don't fit the pool are freed. */
+void c_pool_release(cdrom_paranoia_t *p, int16_t *vector,
+                    unsigned char *flags, long words) {
+  c_pool_t *pool = &p->pool;
+
+  if (vector) {
+    if (words == pool->words && words >= (long)sizeof(void *) &&
+        pool->nvectors < MAX_POOL_SPARE) {
+      *(void **)vector = pool->vectors;
+      pool->vectors = vector;
+      pool->nvectors++;
+    } else
+      free(vector);
+  }
+  if (flags) {
+    if (words == pool->words && words >= (long)sizeof(void *) &&
+        pool->nflags < MAX_POOL_SPARE) {
+      *(void **)flags = pool->flags;
+      pool->flags = flags;
+      pool->nflags++;
+    } else
+      free(flags);
+  }
+}
+
+void c_pool_free(cdrom_paranoia_t *p) { c_pool_resize(&p->pool, 0); }
+
+/**** Borrowed spans *****************************************************/
+
+/* Pin v's current buffer on behalf of a borrower. */
+c_pin_t *c_pin(cdrom_paranoia_t *p, c_block_t *v) {
+  if (!v->pin) {
+    c_pin_t *pin = calloc(1, sizeof(c_pin_t));
+    pin->buffer = c_base(v);
+    pin->words = v->alloc;
+    pin->owner = v;
+    pin->next = p->pins;
+    p->pins = pin;
+    v->pin = pin;
+  }
+  v->pin->refs++;
+  return (v->pin);
+}
+
+/* Drop one borrow.  The last one hands the buffer back to its c_block,
+   or to the pool if the c_block has moved on in the meantime. */
+void c_unpin(cdrom_paranoia_t *p, c_pin_t *pin) {
+  c_pin_t **pp;
+
+  if (--pin->refs > 0)
+    return;
+
+  if (pin->owner)
+    pin->owner->pin = NULL;
+  else
+    c_pool_release(p, pin->buffer, NULL, pin->words);
+
+  for (pp = &p->pins; *pp; pp = &(*pp)->next)
+    if (*pp == pin) {
+      *pp = pin->next;
+      break;
+    }
+  free(pin);
+}
+
+/* Forget every outstanding borrow; used when p itself goes away. */
+void c_free_pins(cdrom_paranoia_t *p) {
+  while (p->pins) {
+    p->pins->refs = 1;
+    c_unpin(p, p->pins);
+  }
+}
+
+/**** Timers *********************************************************/
+
+/* Nanoseconds on a monotonic clock where there is one, for the phase
+   timers in cdio_paranoia_get_stats().  Only differences matter. */
+long long i_clock(void) {
+#if defined(HAVE_CLOCK_GETTIME)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  return 0;
+#elif defined(WIN32)
+  return (long long)clock() * (1000000000 / CLOCKS_PER_SEC);
+#else
+  struct timeval tv;
+  if (gettimeofday(&tv, NULL) == 0)
+    return (long long)tv.tv_sec * 1000000000 + tv.tv_usec * 1000LL;
+  return 0;
+#endif
+}
+
+/* Make a callback, and count the time it takes. */
+void i_callback(cdrom_paranoia_t *p,
+                void (*callback)(long int, paranoia_cb_mode_t), long pos,
+                paranoia_cb_mode_t mode) {
+  if (callback) {
+    long long start = i_clock();
+    (*callback)(pos, mode);
+    p->stats.time_callback += i_clock() - start;
+  }
+}
+
 /**** Initialization *************************************************/
 
 /*!  Get the beginning and ending sector bounds given cursor position.
@@ -375,8 +840,30 @@ cdrom_paranoia_t *paranoia_init(cdrom_drive_t *d) {
   p->d = d;
   p->dynoverlap = MAX_SECTOR_OVERLAP * CD_FRAMEWORDS;
   p->cache_limit = JIGGLE_MODULO;
+  p->readsecond = 1; /* the next read is the first of its spot */
   p->enable = (paranoia_cb_mode_t)PARANOIA_MODE_FULL;
   p->cursor = cdda_disc_firstsector(d);
+  i_match_init();
+
+  /* Start from where the last disc in this drive model left off, if
+     the application keeps a profile database (see cdda.h).  A cache
+     bigger than the default model is still only modelled as big as
+     the default. */
+  {
+    const cdda_profile_t *prof = cdda_profile(d);
+    if (prof) {
+      if (prof->cache_sectors > 0)
+        i_cachemodel_set(p, min(prof->cache_sectors, CACHEMODEL_SECTORS));
+      if (prof->dynoverlap != CDDA_PROFILE_UNKNOWN)
+        p->dynoverlap = max(MIN_SECTOR_EPSILON,
+                            min(prof->dynoverlap,
+                                MAX_SECTOR_OVERLAP * CD_FRAMEWORDS));
+      if (prof->dyndrift != CDDA_PROFILE_UNKNOWN)
+        p->dyndrift = max(-MAX_SECTOR_OVERLAP * CD_FRAMEWORDS,
+                          min(prof->dyndrift,
+                              MAX_SECTOR_OVERLAP * CD_FRAMEWORDS));
+    }
+  }
 
   /* One last one... in case data and audio tracks are mixed... */
   i_paranoia_firstlast(p);
@@ -385,16 +872,95 @@ cdrom_paranoia_t *paranoia_init(cdrom_drive_t *d) {
 }
 
 void paranoia_set_range(cdrom_paranoia_t *p, long start, long end) {
+  i_reader_flush(p);
   p->cursor = start;
   p->current_firstsector = start;
   p->current_lastsector = end;
 }
 
+/* The sortcache is always set up afresh before it is searched, so it
+   can simply be replaced. */
+static void i_sortcache_replace(cdrom_paranoia_t *p, long words,
+                                sort_index_t type) {
+  p->stats.time_sort += p->sortcache->buildtime;
+  sort_free(p->sortcache);
+  p->sortcache = sort_alloc_type(words, type);
+}
+
+/* ===========================================================================
+ * i_cachemodel_set() (internal)
+ *
+ * Models a drive cache of (sectors) sectors.  Each read is as long as
+ * the model, so the sortcache, which indexes a read at a time, is made
+ * to fit it: a small model doesn't keep a 1200 sector index around.
+ * The caller makes sure the reader thread is idle.
+ */
+void i_cachemodel_set(cdrom_paranoia_t *p, int sectors) {
+  long words = max(sectors, 1) * CD_FRAMEWORDS;
+
+  p->cdcache_size = sectors;
+  if (p->sortcache->maxsize != words)
+    i_sortcache_replace(p, words, p->sortcache->type);
+}
+
+/* ===========================================================================
+ * i_sortcache_fit() (internal)
+ *
+ * Grows the sortcache to index (words) samples, if it can't already.
+ * Blocks read before the cache model shrank are longer than the model
+ * for as long as they are kept.
+ */
+void i_sortcache_fit(cdrom_paranoia_t *p, long words) {
+  if (words > p->sortcache->maxsize)
+    i_sortcache_replace(p, words, p->sortcache->type);
+}
+
 /* sectors < 0 indicates a query.  Returns the number of sectors before the call
  */
 int paranoia_cachemodel_size(cdrom_paranoia_t *p, int sectors) {
   int ret = p->cdcache_size;
-  if (sectors >= 0)
-    p->cdcache_size = sectors;
+  if (sectors >= 0) {
+    i_reader_flush(p); /* the reader thread uses the cache model */
+    i_cachemodel_set(p, sectors);
+  }
+  return ret;
+}
+
+/* adapt < 0 indicates a query.  Returns the setting before the call. */
+int paranoia_cachemodel_adapt(cdrom_paranoia_t *p, int adapt) {
+  int ret = p->cdcache_adapt;
+  if (adapt >= 0) {
+    i_reader_flush(p); /* queued jobs use and add to the model */
+    p->cdcache_adapt = (adapt != 0);
+    p->cdcache_hits = p->cdcache_hitdist = p->cdcache_missdist = 0;
+  }
+  return ret;
+}
+
+/* type < 0 indicates a query.  Returns the index type before the call. */
+int paranoia_sortindex(cdrom_paranoia_t *p, int type) {
+  int ret = p->sortcache->type;
+  if (type >= 0 && type != ret)
+    i_sortcache_replace(p, p->sortcache->maxsize,
+                        type == PARANOIA_SORTINDEX_SORTED ? SORT_INDEX_SORTED
+                                                          : SORT_INDEX_BUCKETS);
+  return ret;
+}
+
+/* use < 0 indicates a query.  Returns the setting before the call. */
+int paranoia_c2(cdrom_paranoia_t *p, int use) {
+  int ret = p->c2;
+  if (use >= 0 && (use != 0) != ret) {
+    i_reader_flush(p); /* its reads were planned the other way */
+    p->c2 = (use != 0);
+  }
+  if (p->c2 && p->d->c2 == 0) {
+    /* Find out whether the drive returns them now, on this thread:
+       the reader thread only ever looks at d->c2, never sets it. */
+    int16_t buf[CD_FRAMEWORDS];
+    unsigned char c2[CDDA_C2_SIZE];
+    i_reader_flush(p);
+    cdio_cddap_read_c2(p->d, buf, c2, p->cursor, 1);
+  }
   return ret;
 }
@@ -32,6 +32,12 @@
 #define JIGGLE_MODULO 15          /* sectors */
 #define MIN_SILENCE_BOUNDARY 1024 /* 16 bit words */
 #define CACHEMODEL_SECTORS 1200
+/* smallest model the adaptive cache model shrinks to; reads shorter
+   than a few search overlaps and jiggles make too little progress */
+#define CACHEMODEL_MIN_SECTORS (4 * (MAX_SECTOR_OVERLAP + JIGGLE_MODULO))
+/* read commands per block when nothing is verified; enough to keep
+   the drive streaming without holding much of the disc in memory */
+#define STREAM_READS 8
 
 #define min(x, y) ((x) > (y) ? (y) : (x))
 #define max(x, y) ((x) < (y) ? (y) : (x))
@@ -48,6 +54,10 @@ typedef struct {
   long current;
   long active;
 
+  /* freed elements kept for reuse, chained through next */
+  struct linked_element *spare;
+  long nspare;
+
 } linked_list_t;
 
 typedef struct linked_element {
@@ -69,17 +79,34 @@ extern void *get_elem(linked_element *e);
 /* This is a shallow copy; it doesn't copy contained structures */
 extern linked_list_t *copy_list(linked_list_t *p_list);
 
+/* A sample buffer that the caller of cdio_paranoia_borrow() still holds
+   spans of.  While it is pinned, the c_block it belongs to never
+   reallocates, shifts or frees it; instead such operations move the
+   c_block to a fresh buffer and leave the pinned one "retired" until
+   the last borrow is released.  Trimming samples off the front only
+   advances the c_block's vector, so it is allowed. */
+typedef struct c_pin {
+  int16_t *buffer;
+  long words;            /* samples allocated in buffer */
+  long refs;             /* outstanding borrows */
+  struct c_block *owner; /* c_block using buffer, NULL once retired */
+  struct c_pin *next;    /* all pins of a paranoia object */
+} c_pin_t;
+
 typedef struct c_block {
   /* The buffer */
   int16_t *vector;
   long begin;
   long size;
+  long alloc;   /* samples allocated, counted from vector - head */
+  long head;    /* free samples before vector (and flags, if any) */
+  c_pin_t *pin; /* non-NULL while vector is borrowed from */
 
   /* auxiliary support structures */
   unsigned char *flags; /* 1    known boundaries in read data
                            2    known blanked data
                            4    matched sample
-                           8    reserved
+                           8    drive reported a C2 error
                            16   reserved
                            32   reserved
                            64   reserved
@@ -111,6 +138,8 @@ typedef struct v_fragment_s {
   cdrom_paranoia_t *p;
   struct linked_element *e;
 
+  long snapslot; /* entry in the fragment index's snapshot, or -1 */
+
 } v_fragment_t;
 
 extern void free_v_fragment(v_fragment_t *c);
@@ -129,6 +158,31 @@ extern v_fragment_t *v_last(cdrom_paranoia_t *p);
 extern v_fragment_t *v_next(v_fragment_t *v);
 extern v_fragment_t *v_prev(v_fragment_t *v);
 
+/* The v_fragments again, but ordered by first sample rather than by
+   age, so that stage 2 can take them in that order without sorting
+   the fragment list on every pass.  A pass works from a snapshot
+   (v_snapshot()); fragments freed during the pass are cleared from it
+   rather than left dangling.  v_overlap_next() finds the fragments
+   overlapping a span without looking at the rest, and v_index_evict()
+   frees every fragment before a point at once. */
+typedef struct v_index {
+  v_fragment_t **items;
+  long count;
+  long alloc;
+  long maxsize; /* no fragment in items is longer */
+
+  v_fragment_t **snap;
+  long nsnap;
+  long snapalloc;
+} v_index_t;
+
+extern long v_snapshot(cdrom_paranoia_t *p, v_fragment_t ***list);
+extern void v_index_resort(cdrom_paranoia_t *p);
+extern v_fragment_t *v_overlap_next(cdrom_paranoia_t *p, long begin, long end,
+                                    long *pos);
+extern void v_index_evict(cdrom_paranoia_t *p, long end);
+extern void v_index_free(cdrom_paranoia_t *p);
+
 typedef struct root_block {
   long returnedlimit;
   long lastsector;
@@ -139,6 +193,18 @@ typedef struct root_block {
   long silencebegin;
 } root_block;
 
+/* Sample buffers and flag arrays of the size i_read_c_block() uses,
+   kept when their c_block is freed so that the next read can have them
+   back without going through malloc (and without faulting in fresh
+   pages).  The free lists are chained through the buffers themselves. */
+typedef struct c_pool {
+  long words; /* entries in each buffer; 0 until first use */
+  void *vectors;
+  void *flags;
+  int nvectors;
+  int nflags;
+} c_pool_t;
+
 typedef struct offsets {
 
   long offpoints;
@@ -157,6 +223,7 @@ struct cdrom_paranoia_s {
   linked_list_t *cache; /* our data as read from the cdrom */
   long int cache_limit;
   linked_list_t *fragments; /* fragments of blocks that have been 'verified' */
+  v_index_t fragindex;      /* the same fragments, by position */
   sort_info_t *sortcache;
 
   /* cache tracking */
@@ -165,6 +232,14 @@ struct cdrom_paranoia_s {
   int cdcache_end;
   int jitter;
 
+  /* adaptive cache model, see cdio_paranoia_cachemodel_adapt() */
+  int cdcache_adapt;
+  long cdcache_hits;     /* seeks the model said would miss but hit */
+  long cdcache_hitdist;  /* furthest behind the reads a re-read hit */
+  long cdcache_missdist; /* nearest behind the reads a re-read missed */
+
+  int c2; /* trust C2 error pointers, see cdio_paranoia_c2() */
+
   paranoia_cb_mode_t enable;
   long int cursor;
   long int current_lastsector;
@@ -177,7 +252,34 @@ struct cdrom_paranoia_s {
   long dynoverlap;
   long dyndrift;
 
-  /* statistics for verification */
+  /* words of the root filled in by verify_skip_case() that have not
+     been returned yet (begin == end when there are none) */
+  long skipbegin;
+  long skipend;
+
+  /* buffers with outstanding cdio_paranoia_borrow() spans */
+  c_pin_t *pins;
+
+  c_pool_t pool; /* recycled read buffers */
+
+  /* reader thread, when cdio_paranoia_threaded() is on (see reader.c) */
+  struct paranoia_reader *reader;
+  long readtarget; /* target of the last block read */
+  int readsecond;  /* was it the second read of its spot? */
+
+  /* statistics for verification, see cdio_paranoia_get_stats() */
+  paranoia_stats_t stats;
+  long readhigh; /* one past the last sector the drive has been asked for */
+
+  /* sector checksums, see cdio_paranoia_checksums() (twopass.c) */
+  struct paranoia_sums *sums;
+
+  /* ranges put off for later, see cdio_paranoia_defer() (twopass.c) */
+  int deferretries;
+  int deferlost; /* a range couldn't be queued for lack of memory */
+  paranoia_range_t *deferred;
+  int ndeferred;
+  int deferalloc;
 };
 
 extern c_block_t *c_alloc(int16_t *vector, long begin, long size);
@@ -187,6 +289,26 @@ extern void c_remove(c_block_t *v, long cutpos, long cutsize);
 extern void c_overwrite(c_block_t *v, long pos, int16_t *b, long size);
 extern void c_append(c_block_t *v, int16_t *vector, long size);
 extern void c_removef(c_block_t *v, long cut);
+extern void c_replace(c_block_t *v, int16_t *vector, long begin, long size,
+                      long alloc);
+
+extern int16_t *c_pool_vector(cdrom_paranoia_t *p, long words);
+extern unsigned char *c_pool_flags(cdrom_paranoia_t *p, long words);
+extern void c_pool_release(cdrom_paranoia_t *p, int16_t *vector,
+                           unsigned char *flags, long words);
+extern void c_pool_free(cdrom_paranoia_t *p);
+
+extern void i_cachemodel_set(cdrom_paranoia_t *p, int sectors);
+extern void i_sortcache_fit(cdrom_paranoia_t *p, long words);
+
+extern long long i_clock(void);
+extern void i_callback(cdrom_paranoia_t *p,
+                       void (*callback)(long int, paranoia_cb_mode_t),
+                       long pos, paranoia_cb_mode_t mode);
+
+extern c_pin_t *c_pin(cdrom_paranoia_t *p, c_block_t *v);
+extern void c_unpin(cdrom_paranoia_t *p, c_pin_t *pin);
+extern void c_free_pins(cdrom_paranoia_t *p);
 
 #define ce(v) (v->begin + v->size)
 #define cb(v) (v->begin)
@@ -102,9 +102,12 @@
 #include "../cdda_interface/smallft.h"
 #include "gap.h"
 #include "isort.h"
+#include "match.h"
 /* p_block.h has to come before overlap.h */
 #include "p_block.h"
 #include "overlap.h"
+#include "reader.h"
+#include "twopass.h"
 #include <cdio/paranoia/cdda.h>
 #include <cdio/paranoia/paranoia.h>
 #include <cdio/paranoia/version.h>
@@ -174,9 +177,11 @@ static inline int16_t *rv(root_block *root) {
     and in debugger expressions.
 */
 enum {
-  FLAGS_EDGE = 0x1,    /**< first/last N words of frame */
-  FLAGS_UNREAD = 0x2,  /**< unread, hence missing and unmatchable */
-  FLAGS_VERIFIED = 0x4 /**< block read and verified */
+  FLAGS_EDGE = MATCH_FLAG_EDGE,     /**< first/last N words of frame */
+  FLAGS_UNREAD = MATCH_FLAG_UNREAD, /**< unread, hence missing and
+                                         unmatchable */
+  FLAGS_VERIFIED = 0x4, /**< block read and verified */
+  FLAGS_C2 = 0x8 /**< drive reported a C2 error */
 } paranoia_read_flags;
 
 /**** matching and analysis code *****************************************/
@@ -201,8 +206,17 @@ static inline long i_paranoia_overlap(int16_t *buffA, int16_t *buffB,
                                       long *ret_end) {
   long beginA = offsetA, endA = offsetA;
   long beginB = offsetB, endB = offsetB;
-
-  /* Scan backward to extend the matching run in that direction. */
+  long run;
+
+  /* Scan backward to extend the matching run in that direction.  The
+     match kernel covers the bulk of the run several samples at a time;
+     the loop below only has to look at the sample that stopped it. */
+  if (beginA >= 0 && beginB >= 0) {
+    run = i_match->back(buffA + beginA, buffB + beginB,
+                        min(beginA, beginB) + 1);
+    beginA -= run;
+    beginB -= run;
+  }
   for (; beginA >= 0 && beginB >= 0; beginA--, beginB--)
     if (buffA[beginA] != buffB[beginB])
       break;
@@ -210,6 +224,12 @@ static inline long i_paranoia_overlap(int16_t *buffA, int16_t *buffB,
   beginB++;
 
   /* Scan forward to extend the matching run in that direction. */
+  if (endA < sizeA && endB < sizeB) {
+    run = i_match->fwd(buffA + endA, buffB + endB,
+                       min(sizeA - endA, sizeB - endB));
+    endA += run;
+    endB += run;
+  }
   for (; endA < sizeA && endB < sizeB; endA++, endB++)
     if (buffA[endA] != buffB[endB])
       break;
@@ -245,8 +265,19 @@ static inline long i_paranoia_overlap2(int16_t *buffA, int16_t *buffB,
                                        long *ret_begin, long *ret_end) {
   long beginA = offsetA, endA = offsetA;
   long beginB = offsetB, endB = offsetB;
-
-  /* Scan backward to extend the matching run in that direction. */
+  long run;
+
+  /* Scan backward to extend the matching run in that direction.  The
+     match kernel skips over samples that match and carry neither an
+     edge on both sides nor an unread flag; the loop below then applies
+     the exact edge/unread rules to the sample that stopped it. */
+  if (beginA >= 0 && beginB >= 0) {
+    run = i_match->back_flags(buffA + beginA, buffB + beginB,
+                              flagsA + beginA, flagsB + beginB,
+                              min(beginA, beginB) + 1);
+    beginA -= run;
+    beginB -= run;
+  }
   for (; beginA >= 0 && beginB >= 0; beginA--, beginB--) {
     if (buffA[beginA] != buffB[beginB])
       break;
@@ -275,6 +306,12 @@ static inline long i_paranoia_overlap2(int16_t *buffA, int16_t *buffB,
   beginB++;
 
   /* Scan forward to extend the matching run in that direction. */
+  if (endA < sizeA && endB < sizeB) {
+    run = i_match->fwd_flags(buffA + endA, buffB + endB, flagsA + endA,
+                             flagsB + endB, min(sizeA - endA, sizeB - endB));
+    endA += run;
+    endB += run;
+  }
   for (; endA < sizeA && endB < sizeB; endA++, endB++) {
     if (buffA[endA] != buffB[endB])
       break;
@@ -502,6 +539,34 @@ afterward. */
 
 #define OVERLAP_ADJ (MIN_WORDS_OVERLAP / 2 - 1)
 
+/* ===========================================================================
+ * i_fixup() (internal)
+ *
+ * Counts a repair of kind (mode) in p->stats and reports it at (pos)
+ * to the callback, if there is one.
+ */
+static inline void i_fixup(cdrom_paranoia_t *p, long pos,
+                           paranoia_cb_mode_t mode,
+                           void (*callback)(long int, paranoia_cb_mode_t)) {
+  switch (mode) {
+  case PARANOIA_CB_FIXUP_EDGE:
+    p->stats.fixup_edge++;
+    break;
+  case PARANOIA_CB_FIXUP_ATOM:
+    p->stats.fixup_atom++;
+    break;
+  case PARANOIA_CB_FIXUP_DROPPED:
+    p->stats.fixup_dropped++;
+    break;
+  case PARANOIA_CB_FIXUP_DUPED:
+    p->stats.fixup_duped++;
+    break;
+  default:
+    break;
+  }
+  i_callback(p, callback, pos, mode);
+}
+
 /* ===========================================================================
  * stage1_matched() (internal)
  *
@@ -546,18 +611,18 @@ stage1_matched(c_block_t *old, c_block_t *new, long matchbegin, long matchend,
   if (matchbegin - matchoffset <= cb(new) || matchbegin <= cb(old) ||
       (new->flags[newadjbegin] & FLAGS_EDGE) ||
       (old->flags[oldadjbegin] & FLAGS_EDGE)) {
-    if (matchoffset && callback)
-      (*callback)(matchbegin, PARANOIA_CB_FIXUP_EDGE);
-  } else if (callback)
-    (*callback)(matchbegin, PARANOIA_CB_FIXUP_ATOM);
+    if (matchoffset)
+      i_fixup(new->p, matchbegin, PARANOIA_CB_FIXUP_EDGE, callback);
+  } else
+    i_fixup(new->p, matchbegin, PARANOIA_CB_FIXUP_ATOM, callback);
 
   if (matchend - matchoffset >= ce(new) ||
       (new->flags[newadjend] & FLAGS_EDGE) || matchend >= ce(old) ||
       (old->flags[oldadjend] & FLAGS_EDGE)) {
-    if (matchoffset && callback)
-      (*callback)(matchend, PARANOIA_CB_FIXUP_EDGE);
-  } else if (callback)
-    (*callback)(matchend, PARANOIA_CB_FIXUP_ATOM);
+    if (matchoffset)
+      i_fixup(new->p, matchend, PARANOIA_CB_FIXUP_EDGE, callback);
+  } else
+    i_fixup(new->p, matchend, PARANOIA_CB_FIXUP_ATOM, callback);
 
 #if TRACE_PARANOIA & 1
   fprintf(stderr, "-   Matched [%ld-%ld] against [%ld-%ld]\n",
@@ -805,9 +870,11 @@ static long int i_stage1(cdrom_paranoia_t *p, c_block_t *p_new,
    * for fast searching through the new c_block.  (The index will
    * actually be built the first time we search.)
    */
-  if (ptr)
+  if (ptr) {
+    i_sortcache_fit(p, cs(p_new));
     sort_setup(p->sortcache, cv(p_new), &cb(p_new), cs(p_new), cb(p_new),
                ce(p_new));
+  }
 
   /* Iterate from oldest to newest c_block, comparing the new c_block
    * to each, looking for a sufficiently long run of identical samples
@@ -824,8 +891,7 @@ static long int i_stage1(cdrom_paranoia_t *p, c_block_t *p_new,
             block_count, cb(ptr), ce(ptr), p->dynoverlap);
 #endif
 
-    if (callback)
-      (*callback)(cb(p_new), PARANOIA_CB_VERIFY);
+    i_callback(p, callback, cb(p_new), PARANOIA_CB_VERIFY);
     i_iterate_stage1(p, ptr, p_new, callback);
 
     ptr = c_prev(ptr);
@@ -858,6 +924,7 @@ static long int i_stage1(cdrom_paranoia_t *p, c_block_t *p_new,
      * hence belong in the verified fragment.  See stage1_matched()
      * for an explanation of the trimming.
      */
+    p->stats.stage1_matches++;
     new_v_fragment(p, p_new, cb(p_new) + max(0, begin - OVERLAP_ADJ),
                    cb(p_new) + min(size, end + OVERLAP_ADJ),
                    (end + OVERLAP_ADJ >= size && p_new->lastsector));
@@ -946,8 +1013,7 @@ i_iterate_stage2(cdrom_paranoia_t *p, v_fragment_t *v, sync_result_t *r,
       0)
     return (0);
 
-  if (callback)
-    (*callback)(fb(v), PARANOIA_CB_VERIFY);
+  i_callback(p, callback, fb(v), PARANOIA_CB_VERIFY);
 
   /* We're going to try to match the fragment to the root while allowing
    * for p->dynoverlap jitter, so we'll actually be looking at samples
@@ -989,7 +1055,7 @@ i_iterate_stage2(cdrom_paranoia_t *p, v_fragment_t *v, sync_result_t *r,
      */
     long searchend = min(fev + p->dynoverlap, re(root));
     long searchbegin = max(fbv - p->dynoverlap, rb(root));
-    sort_info_t *i = p->sortcache;
+    sort_info_t *i;
     long j;
     long min_matchbegin = -1;
     long min_matchend = -1;
@@ -998,8 +1064,16 @@ i_iterate_stage2(cdrom_paranoia_t *p, v_fragment_t *v, sync_result_t *r,
     /* Initialize the "sort cache" index to allow for fast searching
      * through the verified fragment between (fbv,fev).  (The index will
      * actually be built the first time we search.)
+     *
+     * i_stage2() offers the same fragments again on every pass while the
+     * root grows underneath them, so (fbv,fev) tends to slide forward
+     * over the same samples.  A fragment's samples never change while it
+     * exists, so its list stamp lets the sort cache keep what it already
+     * indexed and only add or drop the samples at the ends.
      */
-    sort_setup(i, fv(v), &fb(v), fs(v), fbv, fev);
+    i_sortcache_fit(p, fs(v));
+    i = p->sortcache;
+    sort_setup_keyed(i, v->e->stamp, fv(v), &fb(v), fs(v), fbv, fev);
 
     /* ??? Why 23? */
     for (j = searchbegin; j < searchend; j += 23) {
@@ -1064,8 +1138,7 @@ i_iterate_stage2(cdrom_paranoia_t *p, v_fragment_t *v, sync_result_t *r,
       r->end = min_matchend;
       r->offset = -min_offset;
       if (min_offset)
-        if (callback)
-          (*callback)(r->begin, PARANOIA_CB_FIXUP_EDGE);
+        i_fixup(p, r->begin, PARANOIA_CB_FIXUP_EDGE, callback);
       return (1);
     }
   }
@@ -1165,6 +1238,12 @@ static long int i_silence_match(root_block *root, v_fragment_t *v,
           fb(v), fe(v), rb(root), re(root), root->silencebegin);
 #endif
 
+  /* The root may have been trimmed past where its silence began; what
+   * is left of it all lies within the root.
+   */
+  if (root->silencebegin < rb(root))
+    root->silencebegin = rb(root);
+
   /* See how much leading silence this fragment has.  If there are fewer than
    * MIN_SILENCE_BOUNDARY leading silent samples, we don't do this special
    * silence matching.
@@ -1518,8 +1597,8 @@ static long int i_stage2_each(root_block *root, v_fragment_t *v,
             /* There were (matchA) samples dropped from the root.  We'll add
              * them back from the fixed up fragment.
              */
-            if (callback)
-              (*callback)(begin + rb(root) - 1, PARANOIA_CB_FIXUP_DROPPED);
+            i_fixup(p, begin + rb(root) - 1, PARANOIA_CB_FIXUP_DROPPED,
+                    callback);
             if (rb(root) + begin < p->root.returnedlimit)
               break;
             else {
@@ -1545,8 +1624,8 @@ static long int i_stage2_each(root_block *root, v_fragment_t *v,
             /* There were (-matchA) duplicate samples (stuttering) in the
              * root.  We'll drop them.
              */
-            if (callback)
-              (*callback)(begin + rb(root) - 1, PARANOIA_CB_FIXUP_DUPED);
+            i_fixup(p, begin + rb(root) - 1, PARANOIA_CB_FIXUP_DUPED,
+                    callback);
             if (rb(root) + begin + matchA < p->root.returnedlimit)
               break;
             else {
@@ -1573,8 +1652,8 @@ static long int i_stage2_each(root_block *root, v_fragment_t *v,
             /* There were (matchB) samples dropped from the fragment.  We'll
              * add them back from the root.
              */
-            if (callback)
-              (*callback)(begin + rb(root) - 1, PARANOIA_CB_FIXUP_DROPPED);
+            i_fixup(p, begin + rb(root) - 1, PARANOIA_CB_FIXUP_DROPPED,
+                    callback);
 
             /* At the edge of the rift in the fragment, insert the missing
              * samples from the root.  They're the (matchB) samples
@@ -1593,8 +1672,8 @@ static long int i_stage2_each(root_block *root, v_fragment_t *v,
             /* There were (-matchB) duplicate samples (stuttering) in the
              * fixed up fragment.  We'll drop them.
              */
-            if (callback)
-              (*callback)(begin + rb(root) - 1, PARANOIA_CB_FIXUP_DUPED);
+            i_fixup(p, begin + rb(root) - 1, PARANOIA_CB_FIXUP_DUPED,
+                    callback);
 
             /* Remove the (-matchB) samples immediately preceding the edge
              * of the rift in the fixed up fragment.
@@ -1766,8 +1845,7 @@ static long int i_stage2_each(root_block *root, v_fragment_t *v,
             /* There were (matchA) samples dropped from the root.  We'll add
              * them back from the fixed up fragment.
              */
-            if (callback)
-              (*callback)(end + rb(root), PARANOIA_CB_FIXUP_DROPPED);
+            i_fixup(p, end + rb(root), PARANOIA_CB_FIXUP_DROPPED, callback);
             if (end + rb(root) < p->root.returnedlimit)
               break;
 
@@ -1786,8 +1864,7 @@ static long int i_stage2_each(root_block *root, v_fragment_t *v,
             /* There were (-matchA) duplicate samples (stuttering) in the
              * root.  We'll drop them.
              */
-            if (callback)
-              (*callback)(end + rb(root), PARANOIA_CB_FIXUP_DUPED);
+            i_fixup(p, end + rb(root), PARANOIA_CB_FIXUP_DUPED, callback);
             if (end + rb(root) < p->root.returnedlimit)
               break;
 
@@ -1807,8 +1884,7 @@ static long int i_stage2_each(root_block *root, v_fragment_t *v,
             /* There were (matchB) samples dropped from the fragment.  We'll
              * add them back from the root.
              */
-            if (callback)
-              (*callback)(end + rb(root), PARANOIA_CB_FIXUP_DROPPED);
+            i_fixup(p, end + rb(root), PARANOIA_CB_FIXUP_DROPPED, callback);
 
             /* At the edge of the rift in the fragment, insert the missing
              * samples from the root.  They're the (matchB) samples
@@ -1825,8 +1901,7 @@ static long int i_stage2_each(root_block *root, v_fragment_t *v,
             /* There were (-matchB) duplicate samples (stuttering) in the
              * fixed up fragment.  We'll drop them.
              */
-            if (callback)
-              (*callback)(end + rb(root), PARANOIA_CB_FIXUP_DUPED);
+            i_fixup(p, end + rb(root), PARANOIA_CB_FIXUP_DUPED, callback);
 
             /* Remove the (-matchB) samples immediately following the edge
              * of the rift in the fixed up fragment.
@@ -2117,10 +2192,6 @@ static int i_init_root(root_block *root, v_fragment_t *v, long int begin,
     return (0);
 }
 
-static int vsort(const void *a, const void *b) {
-  return ((*(v_fragment_t **)a)->begin - (*(v_fragment_t **)b)->begin);
-}
-
 /* ===========================================================================
  * i_stage2 (internal)
  *
@@ -2168,18 +2239,13 @@ static int i_stage2(cdrom_paranoia_t *p, long int beginword, long int endword,
    */
   while (flag) {
 
-    /* Convert the linked list of verified fragments into an array,
-     * to be sorted in order of beginning sample position
+    /* Get the verified fragments in order of beginning sample
+     * position.  The fragment index keeps them in that order; we take
+     * a snapshot since merging frees fragments as we go.
      */
-    v_fragment_t *first = v_first(p);
-    long active = p->fragments->active, count = 0;
-    v_fragment_t **list = calloc(active, sizeof(v_fragment_t *));
-
-    while (first) {
-      v_fragment_t *next = v_next(first);
-      list[count++] = first;
-      first = next;
-    }
+    v_fragment_t *first;
+    v_fragment_t **list;
+    long active = v_snapshot(p, &list), count = active;
 
     /* Reset the flag so that if we don't match any fragments, we
      * stop looping.  Then, proceed only if there are any fragments
@@ -2188,11 +2254,6 @@ static int i_stage2(cdrom_paranoia_t *p, long int beginword, long int endword,
     flag = 0;
     if (count) {
 
-      /* Sort the array of verified fragments in order of beginning
-       * sample position.
-       */
-      qsort(list, active, sizeof(v_fragment_t *), &vsort);
-
       /* We don't check for the silence flag yet, because even if the
        * verified root ends in silence (and thus the silence flag is set),
        * there may be a non-silent region at the beginning of the verified
@@ -2207,7 +2268,7 @@ static int i_stage2(cdrom_paranoia_t *p, long int beginword, long int endword,
 
         /* Make sure this fragment hasn't already been merged (and
          * thus freed). */
-        if (first->one) {
+        if (first && first->one) {
 
           /* If we don't have a verified root yet, just promote the first
            * fragment (with lowest beginning sample) to be the verified
@@ -2234,6 +2295,8 @@ static int i_stage2(cdrom_paranoia_t *p, long int beginword, long int endword,
            * early positioning. --Monty */
           if (rv(root) == NULL) {
             if (i_init_root(&(p->root), first, beginword, callback)) {
+              /* the root may move into a pool buffer as it grows */
+              rc(root)->p = p;
               free_v_fragment(first);
 
               /* Consider this a merged fragment, so set the flag
@@ -2269,7 +2332,7 @@ static int i_stage2(cdrom_paranoia_t *p, long int beginword, long int endword,
 
           /* Make sure this fragment hasn't already been merged (and
            * thus freed). */
-          if (first->one) {
+          if (first && first->one) {
             if (rv(root) != NULL) {
 
               /* Try to merge the fragment into the root.  This will only
@@ -2292,7 +2355,6 @@ static int i_stage2(cdrom_paranoia_t *p, long int beginword, long int endword,
         } /* end for */
       }
     } /* end if(count) */
-    free(list);
 
     /* If we were able to extend the verified root at all during this pass
      * through the loop, loop again to see if we can merge any remaining
@@ -2339,6 +2401,53 @@ static void i_end_case(cdrom_paranoia_t *p, long endword,
   }
 }
 
+/* Remember that the root words [begin, end) were filled in by a skip,
+   so that cdio_paranoia_read_batch() can flag the sectors they end up
+   in.  Skips only ever extend the root, so anything recorded that lies
+   before the cursor has already been handed out and can be forgotten;
+   otherwise the ranges are merged, erring on the side of flagging. */
+static void i_note_skip(cdrom_paranoia_t *p, long begin, long end) {
+  if (p->skipbegin == p->skipend ||
+      p->skipend <= p->cursor * CD_FRAMEWORDS) {
+    p->skipbegin = begin;
+    p->skipend = end;
+  } else {
+    p->skipbegin = min(p->skipbegin, begin);
+    p->skipend = max(p->skipend, end);
+  }
+}
+
+/* ===========================================================================
+ * i_sector_status() (internal)
+ *
+ * paranoia_sector_status_t bits for the sector starting at root word
+ * (beginword).
+ */
+static unsigned char i_sector_status(cdrom_paranoia_t *p, long beginword) {
+  unsigned char ret = PARANOIA_SECTOR_OK;
+
+  if (p->skipbegin < beginword + CD_FRAMEWORDS && p->skipend > beginword)
+    ret |= PARANOIA_SECTOR_SKIPPED;
+  if (!(p->enable & (PARANOIA_MODE_VERIFY | PARANOIA_MODE_OVERLAP)))
+    ret |= PARANOIA_SECTOR_UNVERIFIED;
+  return (ret);
+}
+
+/* The (sectors) sectors of samples at (samples), starting at root word
+   (beginword), are being handed out; checksum them if asked to (see
+   twopass.c). */
+static void i_note_returned(cdrom_paranoia_t *p, long beginword,
+                            const int16_t *samples, long sectors) {
+  long j;
+
+  if (!p->sums)
+    return;
+  for (j = 0; j < sectors; j++)
+    i_sums_note(p, beginword / CD_FRAMEWORDS + j, samples + j * CD_FRAMEWORDS,
+                i_sector_status(p, beginword + j * CD_FRAMEWORDS) &
+                    PARANOIA_SECTOR_SKIPPED);
+}
+
 /* We want to add a sector. Look through the caches for something that
    spans.  Also look at the flags on the c_block... if this is an
    obliterated sector, get a bit of a chunk past the obliteration. */
@@ -2360,16 +2469,18 @@ static void verify_skip_case(cdrom_paranoia_t *p,
   fprintf(stderr, "\nskipping\n");
 #endif
 
+  /* With no root yet, skip from where the caller is reading, or the
+     root made here would be trimmed away before the next try. */
   if (rv(root) == NULL) {
-    post = 0;
+    post = p->cursor * CD_FRAMEWORDS;
   } else {
     post = re(root);
   }
   if (post == -1)
     post = 0;
 
-  if (callback)
-    (*callback)(post, PARANOIA_CB_SKIP);
+  p->stats.skips++;
+  i_callback(p, callback, post, PARANOIA_CB_SKIP);
 
 #if TRACE_PARANOIA
   fprintf(stderr, "Skipping [%ld-", post);
@@ -2421,9 +2532,11 @@ static void verify_skip_case(cdrom_paranoia_t *p,
       gend = min(gend + OVERLAP_ADJ, cend);
 
       if (rv(root) == NULL) {
-        int16_t *buff = malloc(cs(graft));
-        memcpy(buff, cv(graft), cs(graft));
-        rc(root) = c_alloc(buff, cb(graft), cs(graft));
+        int16_t *buff = malloc((gend - post) * sizeof(int16_t));
+        memcpy(buff, cv(graft) + post - cbegin,
+               (gend - post) * sizeof(int16_t));
+        rc(root) = c_alloc(buff, post, gend - post);
+        rc(root)->p = p;
       } else {
         c_append(rc(root), cv(graft) + post - cbegin, gend - post);
       }
@@ -2436,6 +2549,7 @@ static void verify_skip_case(cdrom_paranoia_t *p,
 #endif
 
       root->returnedlimit = re(root);
+      i_note_skip(p, post, re(root));
       return;
     }
   }
@@ -2446,6 +2560,7 @@ static void verify_skip_case(cdrom_paranoia_t *p,
 
     if (rv(root) == NULL) {
       rc(root) = c_alloc(temp, post, CDIO_CD_FRAMESIZE_RAW);
+      rc(root)->p = p;
     } else {
       c_append(rc(root), temp, CDIO_CD_FRAMESIZE_RAW);
       free(temp);
@@ -2456,16 +2571,23 @@ static void verify_skip_case(cdrom_paranoia_t *p,
 #endif
 
     root->returnedlimit = re(root);
+    i_note_skip(p, post, re(root));
   }
 }
 
 /**** toplevel ****************************************/
 
 void paranoia_free(cdrom_paranoia_t *p) {
+  i_reader_stop(p);
   paranoia_resetall(p);
   sort_free(p->sortcache);
   free_list(p->cache, 1);
   free_list(p->fragments, 1);
+  v_index_free(p);
+  c_free_pins(p);
+  c_pool_free(p);
+  i_sums_free(p);
+  i_defer_free(p);
   free(p);
 }
 
@@ -2478,6 +2600,7 @@ void paranoia_free(cdrom_paranoia_t *p) {
   e.g. PARANOIA_MODE_FULL^PARANOIA_MODE_NEVERSKIP
 */
 void paranoia_modeset(cdrom_paranoia_t *p, int mode_flags) {
+  i_reader_flush(p);
   p->enable = mode_flags;
 }
 
@@ -2507,10 +2630,13 @@ lsn_t paranoia_seek(cdrom_paranoia_t *p, int32_t seek, int whence) {
   if (cdda_sector_gettrack(p->d, sector) == -1)
     return (-1);
 
+  i_reader_flush(p);
   i_cblock_destructor(p->root.vector);
   p->root.vector = NULL;
   p->root.lastsector = 0;
   p->root.returnedlimit = 0;
+  p->readsecond = 1;
+  p->skipbegin = p->skipend = 0; /* they were in the root */
 
   ret = p->cursor;
   p->cursor = sector;
@@ -2548,16 +2674,45 @@ static void cdrom_cache_update(cdrom_paranoia_t *p, int lba, int sectors) {
   }
 }
 
-static void cdrom_cache_handler(cdrom_paranoia_t *p, int lba,
+/* Do cdda_read_timed() times tell a seek from a cache hit on this
+   drive?  Image files read at once; a simulated drive times itself. */
+static int i_timed_reads(cdrom_paranoia_t *p) {
+  return (p->d->test_state != NULL ||
+          cdio_get_driver_id(p->d->p_cdio) == cdio_os_driver);
+}
+
+static void cdrom_cache_handler(cdrom_paranoia_t *p, read_job_t *job, int lba,
                                 void (*callback)(long, paranoia_cb_mode_t)) {
   int seekpos;
   int ms;
+  long seeked;
+  long long start;
+  int adapt = p->cdcache_adapt && i_timed_reads(p);
   if (lba >= p->cdcache_end)
     return; /* nothing to do */
 
   if (lba < 0)
     lba = 0;
 
+  if (adapt && lba >= p->cdcache_begin) {
+    /* The model says lba is still in the drive's cache.  Read it and
+       see: if that took a seek, the drive has already dropped it, its
+       cache is smaller than we think, and the read just made was as
+       good as a flush. */
+    job->seeked = 1;
+    start = i_clock();
+    seeked = cdda_read_timed(p->d, NULL, lba, 1, &ms);
+    job->seektime += i_clock() - start;
+    if (seeked == 1)
+      job->cachedist = p->cdcache_end - lba;
+    if (seeked == 1 && ms >= MIN_SEEK_MS) {
+      job->cachedistmiss = 1;
+      p->cdcache_begin = lba;
+      p->cdcache_end = lba + 1;
+      return;
+    }
+  }
+
   if (lba < p->cdcache_begin) {
     /* should always trigger a backseek so let's do that here and look for the
      * timing */
@@ -2571,89 +2726,54 @@ static void cdrom_cache_handler(cdrom_paranoia_t *p, int lba,
     seekpos = (pre < cdda_disc_firstsector(p->d) ? post : pre);
   }
 
-  if (cdda_read_timed(p->d, NULL, seekpos, 1, &ms) == 1)
-    if (seekpos < p->cdcache_begin && ms < MIN_SEEK_MS)
+  job->seeked = 1;
+  start = i_clock();
+  seeked = cdda_read_timed(p->d, NULL, seekpos, 1, &ms);
+  job->seektime += i_clock() - start;
+  if (seeked == 1)
+    if (seekpos < p->cdcache_begin && ms < MIN_SEEK_MS) {
       if (cdio_get_driver_id(p->d->p_cdio) == cdio_os_driver)
-        if (callback)
-          (*callback)(seekpos *CD_FRAMEWORDS, PARANOIA_CB_CACHEERR);
+        i_read_job_note(job, callback, seekpos * CD_FRAMEWORDS,
+                        PARANOIA_CB_CACHEERR);
+      if (adapt)
+        job->cachehit = 1;
+    }
   cdrom_cache_update(p, seekpos, 1);
   return;
 }
 
+/* Sectors per read_job.  When reads are compared, a cache model's
+   worth, so that re-reads come from the disc rather than the drive's
+   cache; otherwise STREAM_READS commands, which is plenty to keep the
+   drive streaming. */
+static long i_read_size(cdrom_paranoia_t *p) {
+  if (p->enable & (PARANOIA_MODE_VERIFY | PARANOIA_MODE_OVERLAP))
+    return p->cdcache_size;
+  return STREAM_READS * p->d->nsectors;
+}
+
+/* Do reads ask for C2 error pointers?  Only when reads would be
+   compared otherwise, and cdio_paranoia_c2() found the drive returns
+   them. */
+static int i_read_c2(cdrom_paranoia_t *p) {
+  return (p->c2 && (p->enable & PARANOIA_MODE_VERIFY) && p->d->c2 > 0);
+}
+
 /* ===========================================================================
- * read_c_block() (internal)
- *
- * This funtion reads many (p->readahead) sectors, encompassing at least
- * the requested words.
+ * i_plan_read() (internal)
  *
- * It returns a c_block which encapsulates these sectors' data and sector
- * number.  The sectors come come from multiple low-level read requests.
- *
- * This function reads many sectors in order to exhaust any caching on the
- * drive itself, as caching would simply return the same incorrect data
- * over and over.  Paranoia depends on truly re-reading portions of the
- * disc to make sure the reads are accurate and correct any inaccuracies.
- *
- * Which precise sectors are read varies ("jiggles") between calls to
- * read_c_block, to prevent consistent errors across multiple reads
- * from being misinterpreted as correct data.
- *
- * The size of each low-level read is determined by the underlying driver
- * (p->d->nsectors), which allows the driver to specify how many sectors
- * can be read in a single request.  Historically, the Linux kernel could
- * only read 8 sectors at a time, with likely dropped samples between each
- * read request.  Other operating systems may have different limitations.
- *
- * This function is called by paranoia_read_limited(), which breaks the
- * c_block of read data into runs of samples that are likely to be
- * contiguous, verifies them and stores them in verified fragments, and
- * eventually merges the fragments into the verified root.
- *
- * This function returns the last c_block read or NULL on error.
+ * Works out where a read meant to cover sector (target) should begin,
+ * jiggling the start as described for i_read_c_block() below, and
+ * records it, together with the drive and range parameters it depends
+ * on, in a new read_job.
  */
-
-static c_block_t *i_read_c_block(cdrom_paranoia_t *p, long beginword,
-                                 long endword,
-                                 void (*callback)(long, paranoia_cb_mode_t)) {
-
-  /* why do it this way?  We need to read lots of sectors to kludge
-     around stupid read ahead buffers on cheap drives, as well as avoid
-     expensive back-seeking. We also want to 'jiggle' the start address
-     to try to break borderline drives more noticeably (and make broken
-     drives with unaddressable sectors behave more often). */
-
-  long readat, firstread;
-  long totaltoread = p->cdcache_size;
-  long sectatonce = p->d->nsectors;
-  long driftcomp = (float)p->dyndrift / CD_FRAMEWORDS + .5;
-  c_block_t *new = NULL;
-  root_block *root = &p->root;
-  int16_t *buffer = NULL;
-  unsigned char *flags = NULL;
-  long sofar;
-  long dynoverlap = (p->dynoverlap + CD_FRAMEWORDS - 1) / CD_FRAMEWORDS;
-  long anyflag = 0;
-
-  /* Calculate the first sector to read.  This calculation takes
-   * into account the need to jitter the starting point of the read
-   * to reveal consistent errors as well as the low reliability of
-   * the edge words of a read.
-   *
-   * ???: Document more clearly how dynoverlap and MIN_SECTOR_BACKUP
-   * are calculated and used.
-   */
-
-  /* What is the first sector to read?  want some pre-buffer if
-     we're not at the extreme beginning of the disc */
+static read_job_t *i_plan_read(cdrom_paranoia_t *p, long target) {
+  read_job_t *job = calloc(1, sizeof(read_job_t));
+  long driftcomp = 0;
+  long readat;
 
   if (p->enable & (PARANOIA_MODE_VERIFY | PARANOIA_MODE_OVERLAP)) {
 
-    long target;
-    if (rv(root) == NULL || rb(root) > beginword)
-      target = p->cursor - dynoverlap;
-    else
-      target = re(root) / (CD_FRAMEWORDS)-dynoverlap;
-
     /* we want to jitter the read alignment boundary, as some
        drives, beginning from a specific point, will tend to
        lose bytes between sectors in the same place.  Also, as
@@ -2666,33 +2786,62 @@ static c_block_t *i_read_c_block(cdrom_paranoia_t *p, long beginword,
     p->jitter--;
     if (p->jitter < 0)
       p->jitter += JIGGLE_MODULO;
+    driftcomp = (float)p->dyndrift / CD_FRAMEWORDS + .5;
 
   } else {
-    readat = p->cursor;
+    readat = target;
   }
 
-  readat += driftcomp;
+  job->target = target;
+  job->readat = readat + driftcomp;
+  job->totaltoread = i_read_size(p);
+  job->sectatonce = p->d->nsectors;
+  job->firstsector = p->current_firstsector;
+  job->lastsector = p->current_lastsector;
+  job->wantflags =
+      (p->enable & (PARANOIA_MODE_OVERLAP | PARANOIA_MODE_VERIFY)) != 0;
+  job->c2 = i_read_c2(p);
+  job->firstread = -1;
+
+  /* Buffers come from the pool here rather than in i_fetch_read(),
+     which may be running on the reader thread. */
+  job->buffer = c_pool_vector(p, job->totaltoread * CD_FRAMEWORDS);
+  if (job->wantflags)
+    job->flags = c_pool_flags(p, job->totaltoread * CD_FRAMEWORDS);
+  return (job);
+}
 
-  /* Create a new, empty c_block and add it to the head of the
-   * list of c_blocks in memory.  It will be empty until the end of
-   * this subroutine.
-   */
-  if (p->enable & (PARANOIA_MODE_OVERLAP | PARANOIA_MODE_VERIFY)) {
-    flags = calloc(totaltoread * CD_FRAMEWORDS, 1);
-    new = new_c_block(p);
-    recover_cache(p);
-  } else {
-    /* in the case of root it's just the buffer */
-    paranoia_resetall(p);
-    new = new_c_block(p);
-  }
+/* ===========================================================================
+ * i_fetch_read() (internal)
+ *
+ * Carries out the low-level reads for a planned read_job, filling in
+ * its buffer and flags.  This is the part of i_read_c_block() that
+ * talks to the drive, and the only part the reader thread runs; so it
+ * must not look at anything in (p) beyond the drive and the drive
+ * cache model.  Callbacks go through i_read_job_note().
+ */
+static void i_fetch_read(cdrom_paranoia_t *p, read_job_t *job,
+                         void (*callback)(long, paranoia_cb_mode_t)) {
+  long readat = job->readat;
+  long totaltoread = job->totaltoread;
+  long sectatonce = job->sectatonce;
+  int16_t *buffer = job->buffer;
+  unsigned char *flags = job->flags;
+  unsigned char *c2 = NULL;
+  long sofar;
+  long firstread;
 
-  buffer = calloc(totaltoread * CDIO_CD_FRAMESIZE_RAW, 1);
   sofar = 0;
   firstread = -1;
+  if (job->c2 && flags) {
+    c2 = malloc(sectatonce * CDDA_C2_SIZE);
+    job->c2trust = (c2 != NULL);
+  }
 
-  /* we have a read span; flush the drive cache if needed */
-  cdrom_cache_handler(p, readat, callback);
+  /* we have a read span; flush the drive cache if needed.  Reads
+     that won't be compared don't care what the drive has cached. */
+  if (job->wantflags)
+    cdrom_cache_handler(p, job, readat, callback);
 
 #if TRACE_PARANOIA
   fprintf(stderr, "Reading [%ld-%ld] from media\n", readat * CD_FRAMEWORDS,
@@ -2715,12 +2864,12 @@ static c_block_t *i_read_c_block(cdrom_paranoia_t *p, long beginword,
     long thisread;             /* how many sectors were read this request */
 
     /* don't under/overflow the audio session */
-    if (adjread < p->current_firstsector) {
-      secread -= p->current_firstsector - adjread;
-      adjread = p->current_firstsector;
+    if (adjread < job->firstsector) {
+      secread -= job->firstsector - adjread;
+      adjread = job->firstsector;
     }
-    if (adjread + secread - 1 > p->current_lastsector)
-      secread = p->current_lastsector - adjread + 1;
+    if (adjread + secread - 1 > job->lastsector)
+      secread = job->lastsector - adjread + 1;
 
     if (sofar + secread > totaltoread)
       secread = totaltoread - sofar;
@@ -2733,8 +2882,40 @@ static c_block_t *i_read_c_block(cdrom_paranoia_t *p, long beginword,
       /* Issue the low-level read to the driver.
        */
 
-      thisread =
-          cdda_read(p->d, buffer + sofar * CD_FRAMEWORDS, adjread, secread);
+      if (c2) {
+        thisread = cdda_read_c2(p->d, buffer + sofar * CD_FRAMEWORDS, c2,
+                                adjread, secread);
+        if (thisread == -405) {
+          /* the drive can't; read as usual from here on */
+          free(c2);
+          c2 = NULL;
+          job->c2trust = 0;
+        }
+      }
+      if (!c2)
+        thisread =
+            cdda_read(p->d, buffer + sofar * CD_FRAMEWORDS, adjread, secread);
+      job->reads++;
+      if (thisread > 0)
+        job->sectors += thisread;
+
+      /* Mark the words of any byte the drive flagged; each byte of
+         pointers covers four words. */
+      if (c2 && thisread > 0) {
+        long s, k;
+        for (s = 0; s < thisread; s++) {
+          const unsigned char *sc2 = c2 + s * CDDA_C2_SIZE;
+          unsigned char *sflags = flags + (sofar + s) * CD_FRAMEWORDS;
+          int any = 0;
+          for (k = 0; k < CD_FRAMEWORDS; k++)
+            if (sc2[k >> 2] & (0xC0 >> (2 * (k & 3)))) {
+              sflags[k] |= FLAGS_C2;
+              any = 1;
+            }
+          job->c2flagged += any;
+        }
+        job->c2sectors += thisread;
+      }
 
 #if TRACE_PARANOIA & 1
       fprintf(stderr, "- Read [%ld-%ld] (0x%04X...0x%04X)%s",
@@ -2762,17 +2943,13 @@ static c_block_t *i_read_c_block(cdrom_paranoia_t *p, long beginword,
        */
       if (thisread < secread) {
 
+        job->readerrs++;
         if (thisread < 0) {
 #ifdef ENOMEDIUM
           if (errno == ENOMEDIUM) {
             /* the one error we bail on immediately */
-            if (new)
-              free_c_block(new);
-            if (buffer)
-              free(buffer);
-            if (flags)
-              free(flags);
-            return NULL;
+            job->error = ENOMEDIUM;
+            break;
           }
 #endif
           thisread = 0;
@@ -2787,9 +2964,8 @@ static c_block_t *i_read_c_block(cdrom_paranoia_t *p, long beginword,
         /* Uhhh... right.  Make something up. But don't make us seek
            backward! */
 
-        if (callback)
-          (*callback)((adjread + thisread) * CD_FRAMEWORDS,
-                      PARANOIA_CB_READERR);
+        i_read_job_note(job, callback, (adjread + thisread) * CD_FRAMEWORDS,
+                        PARANOIA_CB_READERR);
         memset(buffer + (sofar + thisread) * CD_FRAMEWORDS, 0,
                CDIO_CD_FRAMESIZE_RAW * (secread - thisread));
         if (flags)
@@ -2797,7 +2973,7 @@ static c_block_t *i_read_c_block(cdrom_paranoia_t *p, long beginword,
                  CD_FRAMEWORDS * (secread - thisread));
       }
       if (thisread != 0)
-        anyflag = 1;
+        job->anyflag = 1;
 
       /* Because samples are likely to be dropped between read requests,
        * mark the samples near the the boundaries of the read requests
@@ -2820,17 +2996,17 @@ static c_block_t *i_read_c_block(cdrom_paranoia_t *p, long beginword,
           flags[sofar * CD_FRAMEWORDS + i] |= FLAGS_EDGE;
       }
 
-      if (adjread + secread - 1 == p->current_lastsector)
-        new->lastsector = -1;
+      if (adjread + secread - 1 == job->lastsector)
+        job->lastread = 1;
 
-      if (callback)
-        (*callback)((adjread + secread - 1) * CD_FRAMEWORDS, PARANOIA_CB_READ);
+      i_read_job_note(job, callback, (adjread + secread - 1) * CD_FRAMEWORDS,
+                      PARANOIA_CB_READ);
 
       cdrom_cache_update(p, adjread, secread);
       sofar += secread;
       readat = adjread + secread;
     } else /* secread <= 0 */
-      if (readat < p->current_firstsector)
+      if (readat < job->firstsector)
         readat += sectatonce; /* due to being before the readable area */
       else
         break; /* due to being past the readable area */
@@ -2841,30 +3017,411 @@ static c_block_t *i_read_c_block(cdrom_paranoia_t *p, long beginword,
 
   } /* end while */
 
+  job->firstread = firstread;
+  job->sofar = sofar;
+  free(c2);
+}
+
+/* ===========================================================================
+ * i_read_fits() (internal)
+ *
+ * Would the read_job the reader thread planned ahead of time do in
+ * place of one planned now for sector (target)?  It must have been
+ * made under the same settings, must not start past (target) (or it
+ * can't overlap the root), and must not start so far before it that
+ * most of it re-reads samples the root already has.
+ */
+static int i_read_fits(cdrom_paranoia_t *p, read_job_t *job, long target) {
+  if (job->error || job->totaltoread != i_read_size(p) ||
+      job->sectatonce != p->d->nsectors || job->c2 != i_read_c2(p) ||
+      job->firstsector != p->current_firstsector ||
+      job->lastsector != p->current_lastsector ||
+      job->wantflags !=
+          ((p->enable & (PARANOIA_MODE_OVERLAP | PARANOIA_MODE_VERIFY)) != 0))
+    return 0;
+  if (!job->wantflags)
+    return (job->target == target);
+  return (job->target <= target && target - job->target <= job->totaltoread / 2);
+}
+
+/* ===========================================================================
+ * i_read_ahead() (internal)
+ *
+ * Keeps the reader thread's queue full.  Each queued read is planned
+ * one stride past the last, (last) being the newest read whose target
+ * is known.  The stride is what the root usually grows by per read:
+ *
+ * - with verification, a sector is only verified once two reads have
+ *   covered it, so reads come in pairs starting at (nearly) the same
+ *   sector; after the second, the root has grown by a whole read less
+ *   the overlap and jiggle we back up by;
+ * - with only overlap checking, or with reads the drive vouches for
+ *   with C2 error pointers (cdio_paranoia_c2()), every read is merged
+ *   directly, so the root advances by a whole read less the overlap;
+ * - with neither, reads simply follow one another.
+ *
+ * A read planned wrongly is thrown away by i_read_fits(), along with
+ * the rest of the queue, so it costs the drive a read it didn't need
+ * to make.
+ */
+static void i_read_ahead(cdrom_paranoia_t *p, read_job_t *last) {
+  long dynoverlap = (p->dynoverlap + CD_FRAMEWORDS - 1) / CD_FRAMEWORDS;
+  long totaltoread = i_read_size(p);
+  int verify = (p->enable & PARANOIA_MODE_VERIFY) && !i_read_c2(p);
+  long stride;
+
+  if (p->enable & (PARANOIA_MODE_VERIFY | PARANOIA_MODE_OVERLAP))
+    stride = totaltoread - dynoverlap - JIGGLE_MODULO;
+  else
+    stride = totaltoread;
+  if (stride < 1)
+    stride = 1;
+
+  while (i_reader_queued(p) < i_reader_depth(p)) {
+    read_job_t *job;
+    int second = verify && !last->second;
+    long target;
+
+    if (i_reader_last(p)) {
+      last = i_reader_last(p);
+      second = verify && !last->second;
+    }
+    target = second ? last->target : last->target + stride;
+    if (target > p->current_lastsector)
+      break;
+    job = i_plan_read(p, target);
+    job->second = second;
+    i_reader_submit(p, job);
+  }
+}
+
+/* ===========================================================================
+ * i_cachemodel_adapt() (internal)
+ *
+ * With cdio_paranoia_cachemodel_adapt() on, resizes the cache model
+ * from what cdrom_cache_handler() found out since the last call.
+ *
+ * A seek the model expected to miss the drive's cache that hit it
+ * means the cache is bigger than modelled, and a model that is too
+ * small lets the drive hand back stale data, so the model doubles at
+ * once.  A re-read the model expected to hit that missed means the
+ * cache is smaller than how far behind the reads it was, and one that
+ * hit that it is at least that big.  A loaded machine can make a hit
+ * look slow, so the model never shrinks below the furthest hit seen,
+ * nor below CACHEMODEL_MIN_SECTORS.
+ */
+static void i_cachemodel_adapt(cdrom_paranoia_t *p) {
+  int size = p->cdcache_size;
+
+  if (!p->cdcache_adapt)
+    return;
+
+  if (p->cdcache_hits)
+    size = min(size * 2, CACHEMODEL_SECTORS);
+  else if (p->cdcache_missdist)
+    size = min(size, max(max(p->cdcache_missdist, p->cdcache_hitdist),
+                         CACHEMODEL_MIN_SECTORS));
+  p->cdcache_hits = p->cdcache_missdist = 0;
+
+  if (size != p->cdcache_size) {
+    i_reader_flush(p); /* its reads were planned for the old size */
+    i_cachemodel_set(p, size);
+  }
+}
+
+/* ===========================================================================
+ * i_take_read() (internal)
+ *
+ * The read_job for sector (target), done.  With the reader thread on
+ * (cdio_paranoia_threaded()), the reads themselves have usually been
+ * done already: we take the next read the thread has queued up if
+ * i_read_fits() says it will do, and only otherwise read
+ * synchronously.  Either way the thread is then given the following
+ * reads to get on with.
+ */
+static read_job_t *i_take_read(cdrom_paranoia_t *p, long target,
+                               void (*callback)(long, paranoia_cb_mode_t)) {
+  read_job_t *job = NULL;
+
+  if (p->reader) {
+    job = i_reader_take(p);
+    if (job && !i_read_fits(p, job, target)) {
+      i_read_job_free(p, job);
+      job = NULL;
+      i_reader_flush(p);
+    }
+    if (job)
+      i_read_job_replay(job, callback);
+  }
+
+  if (!job) {
+    /* The reader thread, if any, is idle now. */
+    job = i_plan_read(p, target);
+    i_fetch_read(p, job, callback);
+  }
+
+  /* Is this the second read of a verifying pair (see i_read_ahead())? */
+  job->second = (p->enable & PARANOIA_MODE_VERIFY) && !job->c2 &&
+                !p->readsecond && labs(target - p->readtarget) < JIGGLE_MODULO;
+  p->readtarget = target;
+  p->readsecond = job->second;
+
+  if (p->reader && !job->error)
+    i_read_ahead(p, job);
+  return (job);
+}
+
+/* ===========================================================================
+ * i_c2_verify() (internal)
+ *
+ * With cdio_paranoia_c2() on, marks the samples of a block read with
+ * C2 error pointers that the drive didn't flag (and that were read at
+ * all) as verified, so stage 1 makes fragments of them without a
+ * second read to compare against.  Flagged samples are left to be
+ * verified by comparison as usual.
+ *
+ * Like stage1_matched(), each run is marked short by OVERLAP_ADJ at
+ * either end, which i_stage1() adds back when it makes the fragment;
+ * the ends of the block itself are not trimmed, as nothing is added
+ * back there.
+ *
+ * The drive only vouches for each sector's own bytes, so this trusts
+ * it to stream accurately: samples dropped or jittered between read
+ * commands (FLAGS_EDGE) go unnoticed, which is why it is an option.
+ */
+static void i_c2_verify(c_block_t *c) {
+  long size = cs(c);
+  long begin = 0;
+  long end, i;
+
+  while (begin < size) {
+    for (; begin < size; begin++)
+      if ((c->flags[begin] & (FLAGS_C2 | FLAGS_UNREAD)) == 0)
+        break;
+    for (end = begin; end < size; end++)
+      if (c->flags[end] & (FLAGS_C2 | FLAGS_UNREAD))
+        break;
+    for (i = begin > 0 ? begin + OVERLAP_ADJ : 0;
+         i < (end < size ? end - OVERLAP_ADJ : size); i++)
+      c->flags[i] |= FLAGS_VERIFIED;
+    begin = end;
+  }
+}
+
+/* ===========================================================================
+ * read_c_block() (internal)
+ *
+ * This funtion reads many (p->readahead) sectors, encompassing at least
+ * the requested words.
+ *
+ * It returns a c_block which encapsulates these sectors' data and sector
+ * number.  The sectors come come from multiple low-level read requests.
+ *
+ * This function reads many sectors in order to exhaust any caching on the
+ * drive itself, as caching would simply return the same incorrect data
+ * over and over.  Paranoia depends on truly re-reading portions of the
+ * disc to make sure the reads are accurate and correct any inaccuracies.
+ *
+ * Which precise sectors are read varies ("jiggles") between calls to
+ * read_c_block, to prevent consistent errors across multiple reads
+ * from being misinterpreted as correct data.
+ *
+ * The size of each low-level read is determined by the underlying driver
+ * (p->d->nsectors), which allows the driver to specify how many sectors
+ * can be read in a single request.  Historically, the Linux kernel could
+ * only read 8 sectors at a time, with likely dropped samples between each
+ * read request.  Other operating systems may have different limitations.
+ *
+ * The reads themselves come from i_take_read(), and so usually from
+ * the reader thread when it is on.
+ *
+ * This function is called by paranoia_read_limited(), which breaks the
+ * c_block of read data into runs of samples that are likely to be
+ * contiguous, verifies them and stores them in verified fragments, and
+ * eventually merges the fragments into the verified root.
+ *
+ * This function returns the last c_block read or NULL on error.
+ */
+
+static c_block_t *i_read_c_block(cdrom_paranoia_t *p, long beginword,
+                                 long endword,
+                                 void (*callback)(long, paranoia_cb_mode_t)) {
+
+  /* why do it this way?  We need to read lots of sectors to kludge
+     around stupid read ahead buffers on cheap drives, as well as avoid
+     expensive back-seeking. We also want to 'jiggle' the start address
+     to try to break borderline drives more noticeably (and make broken
+     drives with unaddressable sectors behave more often). */
+
+  c_block_t *new = NULL;
+  root_block *root = &p->root;
+  read_job_t *job;
+  long dynoverlap = (p->dynoverlap + CD_FRAMEWORDS - 1) / CD_FRAMEWORDS;
+  long target;
+
+  /* Calculate the first sector to read.  This calculation takes
+   * into account the need to jitter the starting point of the read
+   * to reveal consistent errors as well as the low reliability of
+   * the edge words of a read.
+   *
+   * ???: Document more clearly how dynoverlap and MIN_SECTOR_BACKUP
+   * are calculated and used.
+   */
+
+  /* What is the first sector to read?  want some pre-buffer if
+     we're not at the extreme beginning of the disc */
+
+  if (rv(root) == NULL || rb(root) > beginword)
+    target = p->cursor - dynoverlap;
+  else
+    target = re(root) / (CD_FRAMEWORDS)-dynoverlap;
+
+  /* Create a new, empty c_block and add it to the head of the
+   * list of c_blocks in memory.  It will be empty until the end of
+   * this subroutine.
+   */
+  new = new_c_block(p);
+  recover_cache(p);
+
+  i_cachemodel_adapt(p);
+
+  job = i_take_read(p, target, callback);
+
+  if (job->error) {
+    /* the one error we bail on immediately */
+    free_c_block(new);
+    errno = job->error;
+    i_read_job_free(p, job);
+    return NULL;
+  }
+
+  if (job->lastread)
+    new->lastsector = -1;
+
   /* If we managed to read any sectors at all (anyflag), fill in the
    * previously allocated c_block with the read data.  Otherwise, free
    * our buffers, dispose of the c_block, and return NULL.
    */
-  if (anyflag) {
-    new->vector = buffer;
-    new->begin = firstread *CD_FRAMEWORDS - p->dyndrift;
-    new->size = sofar *CD_FRAMEWORDS;
-    new->flags = flags;
+  if (job->anyflag) {
+    new->vector = job->buffer;
+    new->begin = job->firstread * CD_FRAMEWORDS - p->dyndrift;
+    new->size = job->sofar * CD_FRAMEWORDS;
+    new->alloc = job->totaltoread * CD_FRAMEWORDS;
+    new->flags = job->flags;
+    job->buffer = NULL;
+    job->flags = NULL;
+    if (job->c2trust)
+      i_c2_verify(new);
 
 #if TRACE_PARANOIA
     fprintf(stderr, "- Read block %ld:[%ld-%ld] from media\n", p->cache->active,
             cb(new), ce(new));
 #endif
   } else {
-    if (new)
-      free_c_block(new);
-    free(buffer);
-    free(flags);
+    free_c_block(new);
     new = NULL;
   }
+  i_read_job_free(p, job);
   return (new);
 }
 
+/* ===========================================================================
+ * i_note_memory() (internal)
+ *
+ * Updates the peak_memory statistic with the sample and flag buffers
+ * held right now: the read cache, the root, buffers the root moved off
+ * that borrowed spans still hold, and the spare buffers in the pool.
+ * Called once per pass of cdio_paranoia_read_limited(), which is
+ * after every read.
+ */
+static void i_note_memory(cdrom_paranoia_t *p) {
+  long bytes = (p->pool.nvectors * 2 + p->pool.nflags) * p->pool.words;
+  c_block_t *c;
+  c_pin_t *pin;
+
+  for (c = c_first(p); c; c = c_next(c))
+    bytes += c->alloc * (c->flags ? 3 : 2);
+  for (pin = p->pins; pin; pin = pin->next)
+    if (!pin->owner)
+      bytes += pin->words * 2;
+  if (p->root.vector)
+    bytes += p->root.vector->alloc * (p->root.vector->flags ? 3 : 2);
+  if (bytes > p->stats.peak_memory)
+    p->stats.peak_memory = bytes;
+}
+
+/* ===========================================================================
+ * i_stream_read() (internal)
+ *
+ * cdio_paranoia_read_limited() with PARANOIA_MODE_DISABLE.  Nothing
+ * is compared, so none of the cache, fragments, overlap or drive
+ * cache flushing is needed: the root simply holds the last block
+ * read, and sectors are handed out of it until the cursor runs off
+ * its end.  Blocks are i_read_size() sectors and follow one another,
+ * so with the reader thread on, the next ones are being read while
+ * this one is handed out and the drive never has to stop.  Each
+ * block's buffer goes back to the pool to be read into again.
+ *
+ * A block that didn't read in full is read again, up to (max_retries)
+ * times unless PARANOIA_MODE_NEVERSKIP is set; after that it is
+ * handed out, zeroes where it didn't read, as a skip.  Otherwise the
+ * zeroes would read the same every time and pass a recheck.
+ */
+static int16_t *i_stream_read(cdrom_paranoia_t *p,
+                              void (*callback)(long int, paranoia_cb_mode_t),
+                              int max_retries, long long entry) {
+  root_block *root = &p->root;
+  long beginword = p->cursor * CD_FRAMEWORDS;
+  int retries = 0;
+
+  while (rv(root) == NULL || rb(root) > beginword ||
+         re(root) < beginword + CD_FRAMEWORDS) {
+    long long start = i_clock();
+    read_job_t *job;
+
+    if (p->cache->active)
+      paranoia_resetall(p); /* left over from another mode */
+
+    job = i_take_read(p, p->cursor, callback);
+    p->stats.time_read += i_clock() - start;
+
+    if (job->error || job->sofar == 0) {
+      /* the medium is gone, or there is nothing left to read */
+      if (job->error)
+        errno = job->error;
+      i_read_job_free(p, job);
+      p->stats.time_total += i_clock() - entry;
+      return NULL;
+    }
+    if (!job->anyflag || job->readerrs) {
+      if ((p->enable & PARANOIA_MODE_NEVERSKIP) || retries++ < max_retries) {
+        i_read_job_free(p, job);
+        continue;
+      }
+      i_note_skip(p, job->firstread * CD_FRAMEWORDS,
+                  (job->firstread + job->sofar) * CD_FRAMEWORDS);
+      i_callback(p, callback, beginword, PARANOIA_CB_SKIP);
+    }
+
+    if (!root->vector) {
+      /* off the cache list, but its buffers go back to the pool */
+      root->vector = c_alloc(NULL, 0, 0);
+      root->vector->p = p;
+    }
+    c_replace(root->vector, job->buffer, job->firstread * CD_FRAMEWORDS,
+              job->sofar * CD_FRAMEWORDS, job->totaltoread * CD_FRAMEWORDS);
+    job->buffer = NULL;
+    i_read_job_free(p, job);
+    i_note_memory(p);
+  }
+
+  i_note_returned(p, beginword, rv(root) + (beginword - rb(root)), 1);
+  p->cursor++;
+  p->stats.sectors_returned++;
+  p->stats.time_total += i_clock() - entry;
+  return (rv(root) + (beginword - rb(root)));
+}
+
 /** ==========================================================================
  * cdio_paranoia_read(), cdio_paranoia_read_limited()
  *
@@ -2892,6 +3449,8 @@ int16_t *cdio_paranoia_read_limited(cdrom_paranoia_t *p,
   long int retry_count = 0;
   long int lastend = -2;
   root_block *root = &p->root;
+  long long entry = i_clock();
+  long long start;
 
   if (p->d->opened == 0) {
     errno = EBADF;
@@ -2900,6 +3459,8 @@ int16_t *cdio_paranoia_read_limited(cdrom_paranoia_t *p,
 
   if (beginword > p->root.returnedlimit)
     p->root.returnedlimit = beginword;
+  if (!(p->enable & (PARANOIA_MODE_VERIFY | PARANOIA_MODE_OVERLAP)))
+    return (i_stream_read(p, callback, max_retries, entry));
   lastend = re(root);
 
   /* Since paranoia reads and verifies chunks of data at a time
@@ -2913,9 +3474,7 @@ int16_t *cdio_paranoia_read_limited(cdrom_paranoia_t *p,
 
   /* First, is the sector we want already in the root? */
   while (rv(root) == NULL || rb(root) > beginword ||
-         (re(root) < endword + (MAX_SECTOR_OVERLAP * CD_FRAMEWORDS) &&
-          p->enable & (PARANOIA_MODE_VERIFY | PARANOIA_MODE_OVERLAP)) ||
-         re(root) < endword) {
+         re(root) < endword + (MAX_SECTOR_OVERLAP * CD_FRAMEWORDS)) {
 
     /* Nope; we need to build or extend the root verified range */
 
@@ -2929,34 +3488,35 @@ int16_t *cdio_paranoia_read_limited(cdrom_paranoia_t *p,
      * try to read data from the drive.
      */
 
-    if (p->enable & (PARANOIA_MODE_VERIFY | PARANOIA_MODE_OVERLAP)) {
-
-      /* We need to make sure our memory consumption doesn't grow
-       * to the size of the whole CD.  But at the same time, we
-       * need to hang onto some of the verified data (even perhaps
-       * data that's already been returned by paranoia_read()) in
-       * order to verify and accurately position future samples.
-       *
-       * Therefore, we free some of the verified data that we
-       * no longer need.
-       */
-      i_paranoia_trim(p, beginword, endword);
-      recover_cache(p);
+    /* We need to make sure our memory consumption doesn't grow
+     * to the size of the whole CD.  But at the same time, we
+     * need to hang onto some of the verified data (even perhaps
+     * data that's already been returned by paranoia_read()) in
+     * order to verify and accurately position future samples.
+     *
+     * Therefore, we free some of the verified data that we
+     * no longer need.
+     */
+    start = i_clock();
+    i_paranoia_trim(p, beginword, endword);
+    recover_cache(p);
+    p->stats.time_trim += i_clock() - start;
 
-      if (rb(root) != -1 && p->root.lastsector)
-        i_end_case(p, endword + (MAX_SECTOR_OVERLAP * CD_FRAMEWORDS), callback);
-      else
+    if (rb(root) != -1 && p->root.lastsector)
+      i_end_case(p, endword + (MAX_SECTOR_OVERLAP * CD_FRAMEWORDS), callback);
+    else {
 
-        /* Merge as many verified fragments into the verified root
-         * as we need to satisfy the pending request.  We may
-         * not have all the fragments we need, in which case we'll
-         * read data from the CD further below.
-         */
-        i_stage2(p, beginword, endword + (MAX_SECTOR_OVERLAP * CD_FRAMEWORDS),
-                 callback);
-    } else
-      i_end_case(p, endword + (MAX_SECTOR_OVERLAP * CD_FRAMEWORDS),
-                 callback); /* only trips if we're already done */
+      /* Merge as many verified fragments into the verified root
+       * as we need to satisfy the pending request.  We may
+       * not have all the fragments we need, in which case we'll
+       * read data from the CD further below.
+       */
+      start = i_clock();
+      p->stats.stage2_merges +=
+          i_stage2(p, beginword,
+                   endword + (MAX_SECTOR_OVERLAP * CD_FRAMEWORDS), callback);
+      p->stats.time_stage2 += i_clock() - start;
+    }
 
 #if TRACE_PARANOIA
     fprintf(stderr, "- Root is now [%ld-%ld] silencebegin=%ld\n", rb(root),
@@ -2980,68 +3540,59 @@ int16_t *cdio_paranoia_read_limited(cdrom_paranoia_t *p,
        * read requests, and words which were near the boundaries of
        * those read requests are marked with FLAGS_EDGE.
        */
-      c_block_t *new = i_read_c_block(p, beginword, endword, callback);
+      c_block_t *new;
+
+      start = i_clock();
+      new = i_read_c_block(p, beginword, endword, callback);
+      p->stats.time_read += i_clock() - start;
 
       if (new) {
-        if (p->enable & (PARANOIA_MODE_OVERLAP | PARANOIA_MODE_VERIFY)) {
+        /* If we need to verify these samples, send them to
+         * stage 1 verification, which will add verified samples
+         * to the set of verified fragments.  Verified fragments
+         * will be merged into the verified root during stage 2
+         * overlap analysis.
+         */
+        if (p->enable & PARANOIA_MODE_VERIFY) {
+          start = i_clock();
+          i_stage1(p, new, callback);
+          p->stats.time_stage1 += i_clock() - start;
+        }
 
-          /* If we need to verify these samples, send them to
-           * stage 1 verification, which will add verified samples
-           * to the set of verified fragments.  Verified fragments
-           * will be merged into the verified root during stage 2
-           * overlap analysis.
-           */
-          if (p->enable & PARANOIA_MODE_VERIFY)
-            i_stage1(p, new, callback);
-
-          /* If we're only doing overlapping reads (no stage 1
-           * verification), consider each low-level read in the
-           * c_block to be a verified fragment.  We exclude the
-           * edges from these fragments to enforce the requirement
-           * that we overlap the reads by the minimum amount.
-           * These fragments will be merged into the verified
-           * root during stage 2 overlap analysis.
-           */
-          else {
-            /* just make v_fragments from the boundary information. */
-            long begin = 0, end = 0;
-
-            while (begin < cs(new)) {
-              while (begin < cs(new) && (new->flags[begin] & FLAGS_EDGE))
-                begin++;
-              end = begin + 1;
-              while (end < cs(new) && (new->flags[end] & FLAGS_EDGE) == 0)
-                end++;
-              {
-                new_v_fragment(p, new, begin + cb(new), end + cb(new),
-                               (new->lastsector &&cb(new) + end == ce(new)));
-              }
-              begin = end;
+        /* If we're only doing overlapping reads (no stage 1
+         * verification), consider each low-level read in the
+         * c_block to be a verified fragment.  We exclude the
+         * edges from these fragments to enforce the requirement
+         * that we overlap the reads by the minimum amount.
+         * These fragments will be merged into the verified
+         * root during stage 2 overlap analysis.
+         */
+        else {
+          /* just make v_fragments from the boundary information. */
+          long begin = 0, end = 0;
+
+          while (begin < cs(new)) {
+            while (begin < cs(new) && (new->flags[begin] & FLAGS_EDGE))
+              begin++;
+            end = begin + 1;
+            while (end < cs(new) && (new->flags[end] & FLAGS_EDGE) == 0)
+              end++;
+            {
+              new_v_fragment(p, new, begin + cb(new), end + cb(new),
+                             (new->lastsector &&cb(new) + end == ce(new)));
             }
+            begin = end;
           }
-
-        } else {
-
-          /* If we're not doing any overlapping reads or verification
-           * of data, skip over the stage 1 and stage 2 verification and
-           * promote this c_block directly to the current "verified" root.
-           */
-
-          if (p->root.vector)
-            i_cblock_destructor(p->root.vector);
-          free_elem(new->e, 0);
-          p->root.vector = new;
-
-          i_end_case(p, endword + (MAX_SECTOR_OVERLAP * CD_FRAMEWORDS),
-                     callback);
         }
       } else {
 
 #ifdef ENOMEDIUM
         /* Was the medium removed or the device closed out from
            under us? */
-        if (errno == ENOMEDIUM)
+        if (errno == ENOMEDIUM) {
+          p->stats.time_total += i_clock() - entry;
           return NULL;
+        }
 #endif
       }
     }
@@ -3065,7 +3616,17 @@ int16_t *cdio_paranoia_read_limited(cdrom_paranoia_t *p,
       /* The better way to do this is to look at how many actual
          matches we're getting and what kind of gap */
 
-      if (retry_count % 5 == 0) {
+      if (p->deferretries && retry_count >= p->deferretries &&
+          rv(root) != NULL) {
+        /* Put this spot off until the caller comes back for it,
+           rather than keep the drive here.  Not before there is a
+           root, which the first reads take a few tries to start. */
+        long skipfrom = re(root);
+
+        verify_skip_case(p, callback);
+        i_defer_note(p, skipfrom, re(root));
+        retry_count = 0;
+      } else if (retry_count % 5 == 0) {
         if (p->dynoverlap == MAX_SECTOR_OVERLAP * CD_FRAMEWORDS ||
             retry_count == max_retries) {
           if (!(p->enable & PARANOIA_MODE_NEVERSKIP))
@@ -3076,8 +3637,7 @@ int16_t *cdio_paranoia_read_limited(cdrom_paranoia_t *p,
             p->dynoverlap *= 1.5;
             if (p->dynoverlap > MAX_SECTOR_OVERLAP * CD_FRAMEWORDS)
               p->dynoverlap = MAX_SECTOR_OVERLAP * CD_FRAMEWORDS;
-            if (callback)
-              (*callback)(p->dynoverlap, PARANOIA_CB_OVERLAP);
+            i_callback(p, callback, p->dynoverlap, PARANOIA_CB_OVERLAP);
           }
         }
       }
@@ -3089,8 +3649,13 @@ int16_t *cdio_paranoia_read_limited(cdrom_paranoia_t *p,
      * contains the needed data, we'll just fall through.
      */
 
+    i_note_memory(p);
+
   } /* end while */
+  i_note_returned(p, beginword, rv(root) + (beginword - rb(root)), 1);
   p->cursor++;
+  p->stats.sectors_returned++;
+  p->stats.time_total += i_clock() - entry;
 
   /* Return a pointer into the verified root.  Thus, the caller
    * must NOT free the returned pointer!
@@ -3098,6 +3663,193 @@ int16_t *cdio_paranoia_read_limited(cdrom_paranoia_t *p,
   return (rv(root) + (beginword - rb(root)));
 }
 
+/** ==========================================================================
+ * cdio_paranoia_read_batch()
+ *
+ * Fills (buffer) with the next (sectors) sectors of verified audio.
+ *
+ * Whatever is already sitting in the verified root, with the same
+ * look-ahead that cdio_paranoia_read_limited() insists on, is copied
+ * straight out; only when the root runs short do we go through
+ * cdio_paranoia_read_limited() to extend it by one more sector, after
+ * which the next run can again be copied in bulk.
+ */
+long cdio_paranoia_read_batch(cdrom_paranoia_t *p, int16_t *buffer,
+                              long sectors, unsigned char *status,
+                              void (*callback)(long int, paranoia_cb_mode_t),
+                              int max_retries) {
+  root_block *root = &p->root;
+  long done = 0;
+
+  if (p->d->opened == 0) {
+    errno = EBADF;
+    return -1;
+  }
+
+  while (done < sectors) {
+    long beginword = p->cursor * CD_FRAMEWORDS;
+    long ready = 0;
+    long lookahead;
+    long j;
+
+    /* How many whole sectors, starting at the cursor, would
+     * cdio_paranoia_read_limited() hand back without doing any work?
+     */
+    lookahead = (p->enable & (PARANOIA_MODE_VERIFY | PARANOIA_MODE_OVERLAP))
+                    ? MAX_SECTOR_OVERLAP * CD_FRAMEWORDS
+                    : 0;
+    if (rv(root) != NULL && rb(root) <= beginword)
+      ready = (re(root) - lookahead - beginword) / CD_FRAMEWORDS;
+
+    if (ready > 0) {
+      /* cdio_paranoia_read_limited() times itself; time this the same */
+      long long start = i_clock();
+
+      ready = min(ready, sectors - done);
+      memcpy(buffer + done * CD_FRAMEWORDS, rv(root) + (beginword - rb(root)),
+             ready * CDIO_CD_FRAMESIZE_RAW);
+      if (status)
+        for (j = 0; j < ready; j++)
+          status[done + j] =
+              i_sector_status(p, beginword + j * CD_FRAMEWORDS);
+      i_note_returned(p, beginword, rv(root) + (beginword - rb(root)),
+                      ready);
+
+      p->cursor += ready;
+      p->stats.sectors_returned += ready;
+      done += ready;
+
+      /* Keep returnedlimit where the individual reads would have
+       * left it.
+       */
+      beginword = (p->cursor - 1) * CD_FRAMEWORDS;
+      if (beginword > root->returnedlimit)
+        root->returnedlimit = beginword;
+      p->stats.time_total += i_clock() - start;
+    } else {
+      int16_t *readbuf = cdio_paranoia_read_limited(p, callback, max_retries);
+
+      if (readbuf == NULL)
+        return (done ? done : -1);
+      memcpy(buffer + done * CD_FRAMEWORDS, readbuf, CDIO_CD_FRAMESIZE_RAW);
+      if (status)
+        status[done] = i_sector_status(p, beginword);
+      done++;
+    }
+  }
+
+  return (done);
+}
+
+/** ==========================================================================
+ * cdio_paranoia_borrow()
+ *
+ * Like cdio_paranoia_read_batch(), but rather than copying, hands back
+ * a span pointing straight into the verified root.  The root buffer is
+ * pinned until cdio_paranoia_release(): anything that would otherwise
+ * realloc, shift or free it moves the root to a new buffer instead
+ * (see c_pin() in p_block.c), and i_paranoia_trim() leaves a pinned
+ * root alone.
+ */
+long cdio_paranoia_borrow(cdrom_paranoia_t *p, long sectors,
+                          paranoia_span_t *span,
+                          void (*callback)(long int, paranoia_cb_mode_t),
+                          int max_retries) {
+  root_block *root = &p->root;
+  long beginword = p->cursor * CD_FRAMEWORDS;
+  int16_t *samples;
+  long ready = 0;
+  long lookahead;
+
+  span->samples = NULL;
+  span->lsn = p->cursor;
+  span->sectors = 0;
+  span->pin = NULL;
+
+  if (p->d->opened == 0) {
+    errno = EBADF;
+    return -1;
+  }
+  if (sectors < 1)
+    return 0;
+
+  lookahead = (p->enable & (PARANOIA_MODE_VERIFY | PARANOIA_MODE_OVERLAP))
+                  ? MAX_SECTOR_OVERLAP * CD_FRAMEWORDS
+                  : 0;
+  if (rv(root) != NULL && rb(root) <= beginword)
+    ready = (re(root) - lookahead - beginword) / CD_FRAMEWORDS;
+
+  if (ready > 0) {
+    long long start = i_clock();
+
+    ready = min(ready, sectors);
+    samples = rv(root) + (beginword - rb(root));
+    i_note_returned(p, beginword, samples, ready);
+    p->cursor += ready;
+    p->stats.sectors_returned += ready;
+    p->stats.time_total += i_clock() - start;
+  } else {
+    /* Nothing verified yet; have the root extended by one sector. */
+    samples = cdio_paranoia_read_limited(p, callback, max_retries);
+    if (samples == NULL)
+      return -1;
+    ready = 1;
+  }
+
+  /* Stage 2 only repairs the root past returnedlimit, so make sure
+   * that excludes everything handed out.
+   */
+  if (beginword + ready * CD_FRAMEWORDS > root->returnedlimit)
+    root->returnedlimit = beginword + ready * CD_FRAMEWORDS;
+
+  span->samples = samples;
+  span->sectors = ready;
+  span->pin = c_pin(p, root->vector);
+  return (ready);
+}
+
+/** ==========================================================================
+ * cdio_paranoia_release()
+ *
+ * Gives back a span obtained from cdio_paranoia_borrow().
+ */
+void cdio_paranoia_release(cdrom_paranoia_t *p, paranoia_span_t *span) {
+  if (span->pin == NULL)
+    return;
+  c_unpin(p, span->pin);
+  span->samples = NULL;
+  span->sectors = 0;
+  span->pin = NULL;
+}
+
+/* depth < 0 indicates a query.  Returns the depth before the call. */
+int cdio_paranoia_threaded(cdrom_paranoia_t *p, int depth) {
+  int ret = i_reader_depth(p);
+  if (depth >= 0 && depth != ret) {
+    if (i_reader_start(p, depth, i_fetch_read) < 0) {
+      errno = ENOSYS;
+      return -1;
+    }
+  }
+  return ret;
+}
+
+void cdio_paranoia_get_stats(const cdrom_paranoia_t *p,
+                             paranoia_stats_t *stats) {
+  const c_pin_t *pin;
+
+  *stats = p->stats;
+  stats->time_sort += p->sortcache->buildtime;
+  stats->dynoverlap = p->dynoverlap;
+  stats->dyndrift = p->dyndrift;
+  stats->cache_model = p->cdcache_size;
+  stats->fragments = p->fragments->active;
+  stats->retired_buffers = 0;
+  for (pin = p->pins; pin; pin = pin->next)
+    if (!pin->owner)
+      stats->retired_buffers++;
+}
+
 /* a temporary hack */
 void cdio_paranoia_overlapset(cdrom_paranoia_t *p, long int overlap) {
   p->dynoverlap = overlap * CD_FRAMEWORDS;
@@ -0,0 +1,353 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* ===========================================================================
+ * The optional reader thread.
+ *
+ * With cdio_paranoia_threaded() turned on, i_read_c_block() no longer
+ * has to wait for the drive: while the caller's thread runs stage 1
+ * and stage 2 over one c_block, the reader thread is already fetching
+ * the next ones.  Reads are planned (readat, jiggle, drift) by the
+ * caller's thread exactly as before and queued here as read_jobs; the
+ * reader thread only performs them, in order, with the same fetch
+ * routine i_read_c_block() uses when there is no thread.
+ *
+ * While the thread is running it is the only one touching the drive
+ * and the drive cache model (p->cdcache_*).  The caller's thread only
+ * does so after i_reader_flush(), when the thread is idle.
+ *
+ * Callbacks made during a threaded read are saved in the job and made
+ * from the caller's thread when the job is taken.
+ * ===========================================================================
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+# define __CDIO_CONFIG_H__ 1
+#endif
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif
+
+#include <cdio/paranoia/cdda.h>
+#include <cdio/paranoia/paranoia.h>
+#include "p_block.h"
+#include "reader.h"
+
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+
+enum { JOB_QUEUED, JOB_BUSY, JOB_DONE };
+
+/**** read jobs **********************************************************/
+
+/* Make a callback now, or save it for later if the job is being done
+   by the reader thread. */
+void i_read_job_note(read_job_t *job,
+                     void (*callback)(long, paranoia_cb_mode_t), long pos,
+                     paranoia_cb_mode_t mode) {
+  if (!job->record) {
+    if (callback) {
+      long long start = i_clock();
+      (*callback)(pos, mode);
+      job->callbacktime += i_clock() - start;
+    }
+    return;
+  }
+  if (job->nevents == job->eventsalloc) {
+    job->eventsalloc = job->eventsalloc ? job->eventsalloc * 2 : 64;
+    job->events =
+        realloc(job->events, job->eventsalloc * sizeof(read_event_t));
+  }
+  job->events[job->nevents].pos = pos;
+  job->events[job->nevents].mode = mode;
+  job->nevents++;
+}
+
+void i_read_job_replay(read_job_t *job,
+                       void (*callback)(long, paranoia_cb_mode_t)) {
+  long i;
+  if (callback && job->nevents) {
+    long long start = i_clock();
+    for (i = 0; i < job->nevents; i++)
+      (*callback)(job->events[i].pos, job->events[i].mode);
+    job->callbacktime += i_clock() - start;
+  }
+  job->nevents = 0;
+}
+
+/* Every job ends up here, whether it was used, found not to fit or
+   flushed, so this is where the drive work it did is added to
+   p->stats.  Sectors before p->readhigh have been asked for before. */
+void i_read_job_free(cdrom_paranoia_t *p, read_job_t *job) {
+  if (job) {
+    paranoia_stats_t *stats = &p->stats;
+
+    stats->drive_reads += job->reads;
+    stats->sectors_read += job->sectors;
+    stats->bytes_read += (long long)job->sectors * CDIO_CD_FRAMESIZE_RAW;
+    stats->read_errors += job->readerrs;
+    stats->cache_seeks += job->seeked;
+    stats->c2_sectors += job->c2sectors;
+    stats->c2_flagged += job->c2flagged;
+    stats->time_seek += job->seektime;
+    stats->time_callback += job->callbacktime;
+    p->cdcache_hits += job->cachehit;
+    if (job->cachedist && job->cachedistmiss) {
+      if (!p->cdcache_missdist || job->cachedist < p->cdcache_missdist)
+        p->cdcache_missdist = job->cachedist;
+    } else if (job->cachedist > p->cdcache_hitdist)
+      p->cdcache_hitdist = job->cachedist;
+    if (job->firstread >= 0 && job->sectors > 0) {
+      long end = job->firstread + job->sofar;
+      if (p->readhigh > job->firstread)
+        stats->sectors_reread +=
+            min(job->sectors, min(end, p->readhigh) - job->firstread);
+      if (end > p->readhigh)
+        p->readhigh = end;
+    }
+
+    c_pool_release(p, job->buffer, job->flags,
+                   job->totaltoread * CD_FRAMEWORDS);
+    free(job->events);
+    free(job);
+  }
+}
+
+#ifdef HAVE_PTHREAD
+
+/**** the thread *********************************************************/
+
+struct paranoia_reader {
+  cdrom_paranoia_t *p;
+  read_fetch_fn fetch;
+  int depth;
+
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t work; /* signalled when a job is queued, or on quit */
+  pthread_cond_t done; /* signalled when a job is finished */
+  int quit;
+
+  read_job_t *head; /* jobs in the order they will be taken */
+  read_job_t *tail;
+  int queued;
+};
+
+static void *i_reader_main(void *arg) {
+  struct paranoia_reader *r = arg;
+  read_job_t *job;
+
+  pthread_mutex_lock(&r->lock);
+  while (!r->quit) {
+    for (job = r->head; job && job->state != JOB_QUEUED; job = job->next)
+      ;
+    if (!job) {
+      pthread_cond_wait(&r->work, &r->lock);
+      continue;
+    }
+    job->state = JOB_BUSY;
+    pthread_mutex_unlock(&r->lock);
+
+    (*r->fetch)(r->p, job, NULL);
+
+    pthread_mutex_lock(&r->lock);
+    job->state = JOB_DONE;
+    pthread_cond_broadcast(&r->done);
+  }
+  pthread_mutex_unlock(&r->lock);
+  return NULL;
+}
+
+int i_reader_start(cdrom_paranoia_t *p, int depth, read_fetch_fn fetch) {
+  struct paranoia_reader *r;
+
+  i_reader_stop(p);
+  if (depth <= 0)
+    return 0;
+
+  r = calloc(1, sizeof(struct paranoia_reader));
+  r->p = p;
+  r->fetch = fetch;
+  r->depth = depth > MAX_READER_DEPTH ? MAX_READER_DEPTH : depth;
+  pthread_mutex_init(&r->lock, NULL);
+  pthread_cond_init(&r->work, NULL);
+  pthread_cond_init(&r->done, NULL);
+
+  if (pthread_create(&r->thread, NULL, i_reader_main, r)) {
+    pthread_cond_destroy(&r->done);
+    pthread_cond_destroy(&r->work);
+    pthread_mutex_destroy(&r->lock);
+    free(r);
+    return -1;
+  }
+  p->reader = r;
+  return 0;
+}
+
+void i_reader_stop(cdrom_paranoia_t *p) {
+  struct paranoia_reader *r = p->reader;
+  if (!r)
+    return;
+
+  i_reader_flush(p);
+  pthread_mutex_lock(&r->lock);
+  r->quit = 1;
+  pthread_cond_signal(&r->work);
+  pthread_mutex_unlock(&r->lock);
+  pthread_join(r->thread, NULL);
+
+  pthread_cond_destroy(&r->done);
+  pthread_cond_destroy(&r->work);
+  pthread_mutex_destroy(&r->lock);
+  free(r);
+  p->reader = NULL;
+}
+
+int i_reader_depth(cdrom_paranoia_t *p) {
+  return (p->reader ? p->reader->depth : 0);
+}
+
+/**** the queue **********************************************************/
+
+void i_reader_submit(cdrom_paranoia_t *p, read_job_t *job) {
+  struct paranoia_reader *r = p->reader;
+
+  job->record = 1;
+  job->state = JOB_QUEUED;
+  job->next = NULL;
+
+  pthread_mutex_lock(&r->lock);
+  if (r->tail)
+    r->tail->next = job;
+  else
+    r->head = job;
+  r->tail = job;
+  r->queued++;
+  pthread_cond_signal(&r->work);
+  pthread_mutex_unlock(&r->lock);
+}
+
+int i_reader_queued(cdrom_paranoia_t *p) {
+  return (p->reader ? p->reader->queued : 0);
+}
+
+/* The most recently submitted job still in the queue, if any.  Only the
+   caller's thread adds and removes jobs, so this stays valid until it
+   next calls i_reader_take() or i_reader_flush(). */
+read_job_t *i_reader_last(cdrom_paranoia_t *p) {
+  return (p->reader ? p->reader->tail : NULL);
+}
+
+/* Remove the oldest job from the queue, waiting for the reader to
+   finish it first.  Returns NULL if nothing is queued. */
+read_job_t *i_reader_take(cdrom_paranoia_t *p) {
+  struct paranoia_reader *r = p->reader;
+  read_job_t *job;
+
+  if (!r)
+    return NULL;
+
+  pthread_mutex_lock(&r->lock);
+  job = r->head;
+  if (job) {
+    while (job->state != JOB_DONE)
+      pthread_cond_wait(&r->done, &r->lock);
+    r->head = job->next;
+    if (!r->head)
+      r->tail = NULL;
+    r->queued--;
+    job->next = NULL;
+  }
+  pthread_mutex_unlock(&r->lock);
+  return job;
+}
+
+/* Throw away every queued job.  Jobs not yet started are dropped
+   outright; we wait for the one in progress, if any.  Afterwards the
+   reader thread is idle until the next i_reader_submit(). */
+void i_reader_flush(cdrom_paranoia_t *p) {
+  struct paranoia_reader *r = p->reader;
+  read_job_t *job, *next, *keep = NULL;
+
+  if (!r)
+    return;
+
+  pthread_mutex_lock(&r->lock);
+  for (job = r->head; job; job = next) {
+    next = job->next;
+    if (job->state == JOB_QUEUED)
+      i_read_job_free(p, job);
+    else {
+      job->next = keep;
+      keep = job;
+    }
+  }
+  r->head = r->tail = keep;
+  for (job = keep; job; job = job->next)
+    while (job->state != JOB_DONE)
+      pthread_cond_wait(&r->done, &r->lock);
+  r->head = r->tail = NULL;
+  r->queued = 0;
+  pthread_mutex_unlock(&r->lock);
+
+  for (job = keep; job; job = next) {
+    next = job->next;
+    i_read_job_free(p, job);
+  }
+}
+
+#else /* !HAVE_PTHREAD */
+
+int i_reader_start(cdrom_paranoia_t *p, int depth, read_fetch_fn fetch) {
+  (void)p;
+  (void)fetch;
+  return (depth > 0 ? -1 : 0);
+}
+
+void i_reader_stop(cdrom_paranoia_t *p) { (void)p; }
+
+int i_reader_depth(cdrom_paranoia_t *p) {
+  (void)p;
+  return 0;
+}
+
+void i_reader_submit(cdrom_paranoia_t *p, read_job_t *job) {
+  (void)p;
+  i_read_job_free(p, job);
+}
+
+int i_reader_queued(cdrom_paranoia_t *p) {
+  (void)p;
+  return 0;
+}
+
+read_job_t *i_reader_last(cdrom_paranoia_t *p) {
+  (void)p;
+  return NULL;
+}
+
+read_job_t *i_reader_take(cdrom_paranoia_t *p) {
+  (void)p;
+  return NULL;
+}
+
+void i_reader_flush(cdrom_paranoia_t *p) { (void)p; }
+
+#endif /* HAVE_PTHREAD */
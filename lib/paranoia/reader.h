@@ -0,0 +1,97 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _READER_H_
+#define _READER_H_
+
+/* The most read jobs the reader thread may have queued up at once. */
+#define MAX_READER_DEPTH 8
+
+/* A callback i_read_c_block() would have made during a read, saved so
+   that it can be made later from the caller's thread. */
+typedef struct read_event {
+  long pos;
+  paranoia_cb_mode_t mode;
+} read_event_t;
+
+/* One i_read_c_block()-sized run of drive reads.  The first group of
+   fields is filled in when the read is planned, the rest when it is
+   carried out (possibly by the reader thread). */
+typedef struct read_job {
+  long target;      /* sector the read was meant to cover, before jiggle */
+  long readat;      /* first sector to read, jiggle and drift included */
+  long totaltoread; /* sectors */
+  long sectatonce;  /* sectors per cdda_read() */
+  long firstsector; /* readable range at planning time */
+  long lastsector;
+  int wantflags; /* also fill in FLAGS_EDGE/FLAGS_UNREAD */
+  int record;    /* save callbacks in events[] rather than making them */
+  int second;    /* the second of a pair of reads of the same spot */
+  int c2;        /* read C2 error pointers, see cdio_paranoia_c2() */
+
+  int16_t *buffer;
+  unsigned char *flags;
+  long firstread; /* first sector actually read, or -1 */
+  long sofar;     /* sectors in buffer */
+  int anyflag;    /* did any read return data? */
+  int lastread;   /* did we read up to lastsector? */
+  int error;      /* errno if the read was abandoned, else 0 */
+  long reads;     /* cdda_read() calls made, for p->stats */
+  long sectors;   /* sectors they returned */
+  long readerrs;  /* how many returned short */
+  int c2trust;    /* did every read return C2 error pointers? */
+  long c2sectors; /* sectors read with them */
+  long c2flagged; /* ...of which the drive flagged errors in */
+  int seeked;     /* did we seek to flush the drive cache? */
+  long long seektime;     /* ns spent seeking */
+  long long callbacktime; /* ns spent in callbacks made for the job */
+  int cachehit;       /* adaptive cache model: a seek that should have
+                         missed the drive cache hit it */
+  long cachedist;     /* ...a re-read was probed this many sectors behind
+                         the reads, or 0 */
+  int cachedistmiss;  /* ...and missed the cache */
+
+  read_event_t *events;
+  long nevents;
+  long eventsalloc;
+
+  int state;
+  struct read_job *next;
+} read_job_t;
+
+typedef void (*read_fetch_fn)(cdrom_paranoia_t *p, read_job_t *job,
+                              void (*callback)(long, paranoia_cb_mode_t));
+
+extern void i_read_job_note(read_job_t *job,
+                            void (*callback)(long, paranoia_cb_mode_t),
+                            long pos, paranoia_cb_mode_t mode);
+extern void i_read_job_replay(read_job_t *job,
+                              void (*callback)(long, paranoia_cb_mode_t));
+extern void i_read_job_free(cdrom_paranoia_t *p, read_job_t *job);
+
+/* Returns 0, or -1 if threads aren't available in this build. */
+extern int i_reader_start(cdrom_paranoia_t *p, int depth, read_fetch_fn fetch);
+extern void i_reader_stop(cdrom_paranoia_t *p);
+extern int i_reader_depth(cdrom_paranoia_t *p);
+
+extern void i_reader_submit(cdrom_paranoia_t *p, read_job_t *job);
+extern int i_reader_queued(cdrom_paranoia_t *p);
+extern read_job_t *i_reader_last(cdrom_paranoia_t *p);
+extern read_job_t *i_reader_take(cdrom_paranoia_t *p);
+extern void i_reader_flush(cdrom_paranoia_t *p);
+
+#endif /*_READER_H_*/
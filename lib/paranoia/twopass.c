@@ -0,0 +1,360 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* ===========================================================================
+ * Two-pass ripping.
+ *
+ * Verification costs at least a second read of every sector, and far
+ * more on a disc that reads badly.  When most of a disc reads the same
+ * every time, it is cheaper to read it straight through twice, without
+ * verification, and keep paranoia for the few places where the two
+ * reads disagree.
+ *
+ * While cdio_paranoia_checksums() is on, each sector the read
+ * functions hand out has its CRC-32 noted here.  cdio_paranoia_recheck()
+ * reads the same sectors again and reports the ranges whose checksums
+ * differ, and cdio_paranoia_reread() rips a range again in whatever
+ * mode the caller has set, reading only a little either side of it.
+ * The sectors of the recheck and the reread are not noted.
+ *
+ * A scratch costs the same kind of time in a single verified pass:
+ * cdio_paranoia_read_limited() keeps the drive seeking back and forth
+ * over it until it gives up.  With cdio_paranoia_defer() on, it gives
+ * up after a few tries, fills in the gap as a skip would and queues the
+ * range, so that the rest of the disc streams on.  The caller takes the
+ * queue from cdio_paranoia_deferred() and rips each range again with
+ * cdio_paranoia_reread(), which doesn't defer, once the drive has
+ * nothing else to do.
+ * ===========================================================================
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+# define __CDIO_CONFIG_H__ 1
+#endif
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif
+
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <cdio/paranoia/cdda.h>
+#include <cdio/paranoia/paranoia.h>
+#include "p_block.h"
+#include "overlap.h"
+#include "crc32.h"
+#include "twopass.h"
+
+/* sectors read at a time by cdio_paranoia_recheck() */
+#define RECHECK_SECTORS 75
+
+/* ranges closer than this are merged, since each is read with this
+   much either side of it anyway */
+#define RECHECK_GAP (2 * MAX_SECTOR_OVERLAP)
+
+enum { SUM_NONE, SUM_OK, SUM_SKIPPED };
+
+struct paranoia_sums {
+  int paused;           /* during a recheck or reread */
+  int lost;             /* a sector couldn't be noted for lack of memory */
+  long first;           /* sector of crc[0]; -1 until one is noted */
+  long n;               /* sectors from first that have been noted */
+  long alloc;
+  uint32_t *crc;
+  unsigned char *state; /* SUM_ per sector */
+};
+
+void i_sums_note(cdrom_paranoia_t *p, long lsn, const int16_t *samples,
+                 int skipped) {
+  struct paranoia_sums *s = p->sums;
+  long i;
+
+  if (s->paused)
+    return;
+  if (s->first < 0)
+    s->first = lsn;
+  if (lsn < s->first)
+    return;
+
+  i = lsn - s->first;
+  if (i >= s->alloc) {
+    long alloc = max(s->alloc * 2, i + 1);
+    uint32_t *crc = realloc(s->crc, alloc * sizeof(*crc));
+    unsigned char *state;
+
+    if (crc)
+      s->crc = crc;
+    state = crc ? realloc(s->state, alloc) : NULL;
+    if (!state) {
+      s->lost = 1;
+      return;
+    }
+    memset(state + s->alloc, SUM_NONE, alloc - s->alloc);
+    s->state = state;
+    s->alloc = alloc;
+  }
+
+  s->crc[i] = i_crc32(0, samples, CDIO_CD_FRAMESIZE_RAW);
+  s->state[i] = skipped ? SUM_SKIPPED : SUM_OK;
+  if (i >= s->n)
+    s->n = i + 1;
+}
+
+void i_sums_free(cdrom_paranoia_t *p) {
+  if (p->sums) {
+    free(p->sums->crc);
+    free(p->sums->state);
+    free(p->sums);
+    p->sums = NULL;
+  }
+}
+
+void i_defer_note(cdrom_paranoia_t *p, long beginword, long endword) {
+  paranoia_range_t r;
+
+  if (endword <= beginword)
+    return;
+  /* a skip can fill in past what is being read; that part is never
+     handed out */
+  r.first = max(beginword / CD_FRAMEWORDS, p->current_firstsector);
+  r.last = min((endword - 1) / CD_FRAMEWORDS, p->current_lastsector);
+  if (r.last < r.first)
+    return;
+
+  /* a scratch is usually given up on a piece at a time */
+  if (p->ndeferred) {
+    paranoia_range_t *prev = &p->deferred[p->ndeferred - 1];
+    if (r.first >= prev->first && r.first <= prev->last + RECHECK_GAP) {
+      prev->last = max(prev->last, r.last);
+      return;
+    }
+  }
+  if (p->ndeferred == p->deferalloc) {
+    int alloc = p->deferalloc ? p->deferalloc * 2 : 16;
+    paranoia_range_t *grown =
+        realloc(p->deferred, alloc * sizeof(paranoia_range_t));
+    if (!grown) {
+      p->deferlost = 1;
+      return;
+    }
+    p->deferred = grown;
+    p->deferalloc = alloc;
+  }
+  p->deferred[p->ndeferred++] = r;
+}
+
+void i_defer_free(cdrom_paranoia_t *p) {
+  free(p->deferred);
+  p->deferred = NULL;
+  p->ndeferred = p->deferalloc = 0;
+  p->deferlost = 0;
+}
+
+int cdio_paranoia_defer(cdrom_paranoia_t *p, int retries) {
+  int ret = p->deferretries;
+
+  if (retries >= 0)
+    p->deferretries = retries;
+  return ret;
+}
+
+int cdio_paranoia_deferred(cdrom_paranoia_t *p, paranoia_range_t *p_ranges,
+                           int i_max) {
+  int n = min(p->ndeferred, i_max);
+
+  if (p->deferlost) {
+    p->deferlost = 0;
+    errno = ENOMEM;
+    return -1;
+  }
+  if (n <= 0)
+    return 0;
+  memcpy(p_ranges, p->deferred, n * sizeof(paranoia_range_t));
+  p->ndeferred -= n;
+  memmove(p->deferred, p->deferred + n,
+          p->ndeferred * sizeof(paranoia_range_t));
+  return n;
+}
+
+int cdio_paranoia_checksums(cdrom_paranoia_t *p, int on) {
+  i_sums_free(p);
+  if (!on)
+    return 0;
+  p->sums = calloc(1, sizeof(struct paranoia_sums));
+  if (!p->sums)
+    return -1;
+  p->sums->first = -1;
+  return 0;
+}
+
+/* Put p back at sector (cursor) with the range [first, last], as it was
+   before a recheck or reread.  paranoia_seek() would refuse a cursor
+   past the end of a track, where a finished rip leaves it, and would
+   reset the range, so seek somewhere known to be good to drop the
+   root and then set the rest by hand. */
+static void i_restore(cdrom_paranoia_t *p, long good, long cursor, long first,
+                      long last) {
+  paranoia_seek(p, good, SEEK_SET);
+  p->cursor = cursor;
+  p->current_firstsector = first;
+  p->current_lastsector = last;
+}
+
+/* Add bad sector (lsn) to the ranges found so far. */
+static void i_recheck_bad(paranoia_range_t *p_ranges, int i_max, int *count,
+                          paranoia_range_t *cur, long lsn) {
+  if (*count && lsn - cur->last <= RECHECK_GAP) {
+    cur->last = lsn;
+  } else {
+    cur->first = cur->last = lsn;
+    (*count)++;
+  }
+  if (*count <= i_max)
+    p_ranges[*count - 1] = *cur;
+}
+
+int cdio_paranoia_recheck(cdrom_paranoia_t *p, paranoia_range_t *p_ranges,
+                          int i_max,
+                          void (*callback)(long int, paranoia_cb_mode_t),
+                          int max_retries) {
+  struct paranoia_sums *s = p->sums;
+  int enable = p->enable;
+  long cursor = p->cursor;
+  long first = p->current_firstsector;
+  long last = p->current_lastsector;
+  paranoia_range_t cur = {0, 0};
+  unsigned char status[RECHECK_SECTORS];
+  int16_t *buffer;
+  int count = 0;
+  long lsn;
+
+  if (!s || s->first < 0)
+    return 0;
+  if (s->lost) {
+    errno = ENOMEM;
+    return -1;
+  }
+  buffer = malloc(RECHECK_SECTORS * CDIO_CD_FRAMESIZE_RAW);
+  if (!buffer)
+    return -1;
+
+  s->paused = 1;
+  paranoia_modeset(p, PARANOIA_MODE_DISABLE);
+
+  /* Read as far away as the disc allows first, so that the start of
+     the span comes from the disc again rather than the drive's cache. */
+  {
+    lsn_t disc_first = cdda_disc_firstsector(p->d);
+    lsn_t disc_last = cdda_disc_lastsector(p->d);
+    lsn_t far = (s->first - disc_first > disc_last - (s->first + s->n - 1))
+                    ? disc_first
+                    : disc_last;
+    cdda_read(p->d, NULL, far, 1);
+  }
+
+  if (paranoia_seek(p, s->first, SEEK_SET) < 0) {
+    count = -1;
+    errno = EINVAL;
+    goto done;
+  }
+  p->current_firstsector = s->first;
+  p->current_lastsector = s->first + s->n - 1;
+
+  for (lsn = s->first; lsn < s->first + s->n;) {
+    long want = min(RECHECK_SECTORS, s->first + s->n - lsn);
+    long got = cdio_paranoia_read_batch(p, buffer, want, status, callback,
+                                        max_retries);
+    long j;
+
+    if (got <= 0) {
+      count = -1;
+      goto done;
+    }
+    for (j = 0; j < got; j++, lsn++) {
+      long i = lsn - s->first;
+      if (s->state[i] != SUM_OK || (status[j] & PARANOIA_SECTOR_SKIPPED) ||
+          s->crc[i] != i_crc32(0, buffer + j * CD_FRAMEWORDS,
+                               CDIO_CD_FRAMESIZE_RAW))
+        i_recheck_bad(p_ranges, i_max, &count, &cur, lsn);
+    }
+  }
+
+done:
+  free(buffer);
+  paranoia_modeset(p, enable);
+  i_restore(p, s->first, cursor, first, last);
+  s->paused = 0;
+  return count;
+}
+
+long cdio_paranoia_reread(cdrom_paranoia_t *p, const paranoia_range_t *range,
+                          int16_t *p_buffer, unsigned char *p_status,
+                          void (*callback)(long int, paranoia_cb_mode_t),
+                          int max_retries) {
+  long cursor = p->cursor;
+  long first = p->current_firstsector;
+  long last = p->current_lastsector;
+  int paused = p->sums ? p->sums->paused : 0;
+  int deferretries = p->deferretries;
+  long from, ret = 0;
+
+  if (range->last < range->first) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  /* Enough either side for the reads to overlap, but no further than
+     the range p was reading before, unless the range itself is.
+     Verification starts at the beginning of that, since a root is
+     hard to start in the middle of a scratch but easy to carry into
+     one; the sectors before the range are thrown away. */
+  from = max(range->first - MAX_SECTOR_OVERLAP, min(first, range->first));
+  if (paranoia_seek(p, from, SEEK_SET) < 0 &&
+      paranoia_seek(p, from = range->first, SEEK_SET) < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  /* Whatever was read there before didn't verify, or isn't trusted;
+     start again from the disc. */
+  paranoia_resetcache(p);
+  p->current_firstsector = from;
+  p->current_lastsector =
+      min(range->last + MAX_SECTOR_OVERLAP, max(last, range->last));
+
+  if (p->sums)
+    p->sums->paused = 1;
+  p->deferretries = 0;
+  for (; from < range->first && ret == 0; from++)
+    if (!cdio_paranoia_read_limited(p, callback, max_retries))
+      ret = -1;
+  if (ret == 0)
+    ret = cdio_paranoia_read_batch(p, p_buffer,
+                                   range->last - range->first + 1, p_status,
+                                   callback, max_retries);
+  p->deferretries = deferretries;
+  if (p->sums)
+    p->sums->paused = paused;
+
+  i_restore(p, range->first, cursor, first, last);
+  return ret;
+}
@@ -0,0 +1,38 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TWOPASS_H_
+#define _TWOPASS_H_
+
+/* Sector checksums for cdio_paranoia_recheck(); kept in p->sums while
+   cdio_paranoia_checksums() is on. */
+struct paranoia_sums;
+
+/* Note that sector (lsn), whose samples are at (samples), was handed
+   out; (skipped) if paranoia gave up on any of it. */
+extern void i_sums_note(cdrom_paranoia_t *p, long lsn, const int16_t *samples,
+                        int skipped);
+
+extern void i_sums_free(cdrom_paranoia_t *p);
+
+/* Queue root words [beginword, endword), just filled in by a skip, to
+   be ripped again later; see cdio_paranoia_defer(). */
+extern void i_defer_note(cdrom_paranoia_t *p, long beginword, long endword);
+
+extern void i_defer_free(cdrom_paranoia_t *p);
+
+#endif /*_TWOPASS_H_*/
@@ -6,6 +6,10 @@
 /* Eliminate teeny little writes.  patch submitted by
    Rob Ross <rbross@parl.ces.clemson.edu> --Monty 19991008 */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
@@ -13,13 +17,32 @@
 
 #define OUTBUFSZ 32 * 1024
 
+/* One buffer per open output; several drives may be writing to their
+   own files at once. */
+#define BW_SLOTS 16
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+static pthread_mutex_t bw_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define bw_lock() pthread_mutex_lock(&bw_mutex)
+#define bw_unlock() pthread_mutex_unlock(&bw_mutex)
+#else
+#define bw_lock()
+#define bw_unlock()
+#endif
+
 #include "buffering_write.h"
 #include "utils.h"
 
+typedef struct bw_slot {
+  int fd;
+  long pos;
+  char outbuf[OUTBUFSZ];
+} bw_slot_t;
+
 /* GLOBALS FOR BUFFERING CALLS */
-static int bw_fd = -1;
-static long bw_pos = 0;
-static char bw_outbuf[OUTBUFSZ];
+static bw_slot_t bw_slots[BW_SLOTS];
+static int bw_inited = 0;
 
 static long int blocking_write(int outf, char *buffer, long num) {
   long int words = 0, temp;
@@ -36,6 +59,35 @@ static long int blocking_write(int outf, char *buffer, long num) {
   return (0);
 }
 
+/* Find the buffer for fd, claiming a free one if it has none yet.
+   NULL when every buffer is taken; the caller then writes through. */
+static bw_slot_t *bw_slot(int fd, int claim) {
+  bw_slot_t *free_slot = NULL;
+  int i;
+
+  bw_lock();
+  if (!bw_inited) {
+    for (i = 0; i < BW_SLOTS; i++)
+      bw_slots[i].fd = -1;
+    bw_inited = 1;
+  }
+  for (i = 0; i < BW_SLOTS; i++) {
+    if (bw_slots[i].fd == fd) {
+      bw_unlock();
+      return &bw_slots[i];
+    }
+    if (bw_slots[i].fd == -1 && free_slot == NULL)
+      free_slot = &bw_slots[i];
+  }
+  if (claim && free_slot) {
+    free_slot->fd = fd;
+    free_slot->pos = 0;
+  } else
+    free_slot = NULL;
+  bw_unlock();
+  return free_slot;
+}
+
 /** buffering_write() - buffers data to a specified size before writing.
  *
  * Restrictions:
@@ -43,48 +95,76 @@ static long int blocking_write(int outf, char *buffer, long num) {
  *
  */
 long int buffering_write(int fd, char *buffer, long num) {
-  if (fd != bw_fd) {
-    /* clean up after buffering for some other file */
-    if (bw_fd >= 0 && bw_pos > 0) {
-      if (blocking_write(bw_fd, bw_outbuf, bw_pos)) {
-        perror("write (in buffering_write, flushing)");
-      }
+  bw_slot_t *bw = bw_slot(fd, 1);
+
+  if (bw == NULL) {
+    if (buffer && num && blocking_write(fd, buffer, num)) {
+      perror("write (in buffering_write, unbuffered)");
+      return (-1);
     }
-    bw_fd = fd;
-    bw_pos = 0;
+    return (0);
   }
 
-  if (bw_pos + num > OUTBUFSZ) {
+  if (bw->pos + num > OUTBUFSZ) {
     /* fill our buffer first, then write, then modify buffer and num */
-    memcpy(&bw_outbuf[bw_pos], buffer, OUTBUFSZ - bw_pos);
-    if (blocking_write(fd, bw_outbuf, OUTBUFSZ)) {
+    memcpy(&bw->outbuf[bw->pos], buffer, OUTBUFSZ - bw->pos);
+    if (blocking_write(fd, bw->outbuf, OUTBUFSZ)) {
       perror("write (in buffering_write, full buffer)");
       return (-1);
     }
-    num -= (OUTBUFSZ - bw_pos);
-    buffer += (OUTBUFSZ - bw_pos);
-    bw_pos = 0;
+    num -= (OUTBUFSZ - bw->pos);
+    buffer += (OUTBUFSZ - bw->pos);
+    bw->pos = 0;
   }
   /* save data */
   if (buffer && num)
-    memcpy(&bw_outbuf[bw_pos], buffer, num);
-  bw_pos += num;
+    memcpy(&bw->outbuf[bw->pos], buffer, num);
+  bw->pos += num;
 
   return (0);
 }
 
+/** buffering_write_at() - writes data at a given offset in the file,
+ * over what was written there before.  Whatever is buffered is written
+ * out first, and the file offset is left where it was.
+ *
+ */
+int buffering_write_at(int fd, off_t pos, char *buffer, long num) {
+  bw_slot_t *bw = bw_slot(fd, 0);
+  off_t end;
+
+  if (bw && bw->pos > 0) {
+    if (blocking_write(fd, bw->outbuf, bw->pos)) {
+      perror("write (in buffering_write_at)");
+      return (-1);
+    }
+    bw->pos = 0;
+  }
+  if ((end = lseek(fd, 0, SEEK_CUR)) == -1 ||
+      lseek(fd, pos, SEEK_SET) == -1 || blocking_write(fd, buffer, num) ||
+      lseek(fd, end, SEEK_SET) == -1) {
+    perror("write (in buffering_write_at)");
+    return (-1);
+  }
+  return (0);
+}
+
 /** buffering_close() - writes out remaining buffered data before
  * closing file.
  *
  */
 int buffering_close(int fd) {
-  if (fd == bw_fd && bw_pos > 0) {
+  bw_slot_t *bw = bw_slot(fd, 0);
+
+  if (bw) {
     /* write out remaining data and clean up */
-    if (blocking_write(fd, bw_outbuf, bw_pos)) {
+    if (bw->pos > 0 && blocking_write(fd, bw->outbuf, bw->pos)) {
       perror("write (in buffering_close)");
     }
-    bw_fd = -1;
-    bw_pos = 0;
+    bw_lock();
+    bw->fd = -1;
+    bw->pos = 0;
+    bw_unlock();
   }
   return (close(fd));
 }
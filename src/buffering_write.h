@@ -11,6 +11,13 @@
  */
 extern long buffering_write(int outf, char *buffer, long num);
 
+/** buffering_write_at() - writes data at a given offset in the file,
+ * over what was written there before.  Whatever is buffered is written
+ * out first, and the file offset is left where it was.
+ *
+ */
+extern int buffering_write_at(int fd, off_t pos, char *buffer, long num);
+
 /** buffering_close() - writes out remaining buffered data before
  * closing file.
  *
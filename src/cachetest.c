@@ -415,6 +415,8 @@ int analyze_cache(cdrom_drive_t *d, FILE *progress, FILE *log, int speed) {
     }
   }
   cachesize = current - 1;
+  if (cdda_profile(d) && cachesize < hi)
+    cdda_profile(d)->cache_sectors = cachesize;
 
   printC("\r");
   if (cachesize == hi) {
@@ -777,6 +779,8 @@ int analyze_cache(cdrom_drive_t *d, FILE *progress, FILE *log, int speed) {
   }
 
   cachegran -= rollbehind;
+  if (cdda_profile(d))
+    cdda_profile(d)->cache_granularity = cachegran;
 
   logC("\n");
   printC("\r");
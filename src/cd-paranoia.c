@@ -98,6 +98,11 @@ static void gettimeofday(struct timeval* tv, void* timezone);
 #include "header.h"
 #include "buffering_write.h"
 #include "cachetest.h"
+#include "checksum_db.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #ifndef O_BINARY
 #define O_BINARY 0
@@ -114,6 +119,8 @@ static int bigendianp(void) {
   return (1);
 }
 
+/* Returns the sector that offset names, -1 if it names nothing, or -2 after
+   reporting a malformed or out-of-range offset. */
 static long parse_offset(cdrom_drive_t *d, char *offset, int begin) {
   track_t i_track = CDIO_INVALID_TRACK;
   long hours = -1;
@@ -134,7 +141,7 @@ static long parse_offset(cdrom_drive_t *d, char *offset, int begin) {
     temp = strchr(offset, '[');
     if (temp == NULL) {
       report("Error parsing span argument");
-      exit(1);
+      return -2;
     }
     *temp = '\0';
     time = temp + 1;
@@ -149,7 +156,7 @@ static long parse_offset(cdrom_drive_t *d, char *offset, int begin) {
       if (i_track >= cdio_get_first_track_num(d->p_cdio) + d->tracks) {
         /*take track i_first_track-1 as pre-gap of 1st track*/
         report("Track #%d does not exist.", i_track);
-        exit(1);
+        return -2;
       }
     }
   }
@@ -172,7 +179,7 @@ static long parse_offset(cdrom_drive_t *d, char *offset, int begin) {
     case '.':
       if (sectors != -1) {
         report("Error parsing span argument");
-        exit(1);
+        return -2;
       }
       sectors = val;
       break;
@@ -185,7 +192,7 @@ static long parse_offset(cdrom_drive_t *d, char *offset, int begin) {
         hours = val;
       else {
         report("Error parsing span argument");
-        exit(1);
+        return -2;
       }
       break;
     }
@@ -231,7 +238,7 @@ static long parse_offset(cdrom_drive_t *d, char *offset, int begin) {
   if (i_track != CDIO_INVALID_TRACK) {
     if (cdda_sector_gettrack(d, ret) != i_track) {
       report("Time/sector offset goes beyond end of specified track.");
-      exit(1);
+      return -2;
     }
   }
 
@@ -239,7 +246,7 @@ static long parse_offset(cdrom_drive_t *d, char *offset, int begin) {
 
   if (ret > cdda_disc_lastsector(d)) {
     report("Time/sector offset goes beyond end of disc.");
-    exit(1);
+    return -2;
   }
 
   return (ret);
@@ -282,15 +289,79 @@ static void display_toc(cdrom_drive_t *d) {
 #include "usage.h"
 static void usage(FILE *f) { fprintf(f, usage_help); }
 
-static long callbegin;
-static long callend;
 static long callscript = 0;
 
-static int skipped_flag = 0;
 static int abort_on_skip = 0;
 static FILE *logfile = NULL;
 static int logfile_open = 0;
 static int reportfile_open = 0;
+static int printit = 0; /* progress meter has somewhere to go */
+
+/* One drive being ripped.  Normally there is exactly one of these;
+   with --multi-drive there is one per drive, each run on its own
+   thread where threads are available. */
+typedef struct rip_worker {
+  char *device;  /* as given with -d, or NULL to autosense */
+  char tag[32];  /* "[sr0] " style prefix, empty for a lone drive */
+  char name[24]; /* same without decoration, for file names */
+  char *span;    /* private copy; parse_offset() writes into it */
+  cdrom_drive_t *d;
+  cdrom_paranoia_t *p;
+  int status;
+  int skipped_flag;
+  long callbegin;
+  long callend;
+
+  /* progress meter state */
+  long c_sector;
+  long v_sector;
+  char dispcache[31];
+  int last;
+  long lasttime;
+  char heartbeat;
+  int overlap;
+  int slevel;
+  int slast;
+  int stimeout;
+  char meter[64]; /* this drive's part of the combined meter */
+
+  /* for --stats-json */
+  paranoia_stats_t stats;
+  int have_stats;
+  long long start_us;
+  long long wall_us; /* -1 until the rip is over */
+  long long write_us;
+
+  /* for --checksums and --checksum-db: the file being written */
+  paranoia_checksum_t sum;
+  int sum_flags;
+  int summing;
+#ifdef HAVE_PTHREAD
+  pthread_t thread;
+  int threaded;
+#endif
+} rip_worker_t;
+
+static rip_worker_t *workers = NULL;
+static int nworkers = 0;
+static int multi_drive = 0;
+
+#ifdef HAVE_PTHREAD
+static pthread_key_t worker_key;
+/* drives finishing together take turns rewriting the profile database */
+static pthread_mutex_t profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static rip_worker_t *running = NULL;
+
+/* The worker the calling thread is ripping for. */
+static rip_worker_t *current_worker(void) {
+#ifdef HAVE_PTHREAD
+  rip_worker_t *w = pthread_getspecific(worker_key);
+  if (w)
+    return w;
+#endif
+  return running;
+}
 
 #if TRACE_PARANOIA
 static void callback(long int inpos, paranoia_cb_mode_t function) {}
@@ -302,6 +373,37 @@ static const char *callback_strings[16] = {
     "finished",
 };
 
+/* With several drives, one status line shows every drive's position
+   and mood; the full meter only goes to the log when a rip finishes. */
+static void multi_meter(rip_worker_t *w, const char *buffer, long sector,
+                        const char *smilie, paranoia_cb_mode_t function) {
+  long len = w->callend - w->callbegin + 1;
+  long done = len > 0 ? (sector - w->callbegin + 1) * 100 / len : 0;
+  int i;
+
+  if (done < 0)
+    done = 0;
+  if (done > 100)
+    done = 100;
+
+  report_lock();
+  snprintf(w->meter, sizeof(w->meter), "%s%3ld%%%s %c", w->name, done, smilie,
+           w->heartbeat);
+  if (isatty(STDERR_FILENO)) {
+    fputc('\r', stderr);
+    for (i = 0; i < nworkers; i++)
+      if (workers[i].meter[0])
+        fprintf(stderr, "%s%s", i ? " | " : "", workers[i].meter);
+    fputs("   ", stderr);
+  }
+  if (logfile != NULL && function == PARANOIA_CB_FINISHED) {
+    fprintf(logfile, "%s%s", w->tag, buffer + 1);
+    fprintf(logfile, "\n\n");
+    fflush(logfile);
+  }
+  report_unlock();
+}
+
 static void callback(long int inpos, paranoia_cb_mode_t function) {
   /*
 
@@ -311,31 +413,23 @@ static void callback(long int inpos, paranoia_cb_mode_t function) {
 
   int graph = 30;
   char buffer[256];
-  static long c_sector = 0, v_sector = 0;
-  static char dispcache[] = "                              ";
-  static int last = 0;
-  static long lasttime = 0;
+  rip_worker_t *w = current_worker();
   long int sector, osector = 0;
   struct timeval thistime;
-  static char heartbeat = ' ';
   int position = 0, aheadposition = 0;
-  static int overlap = 0;
-  static int printit = -1;
-
-  static int slevel = 0;
-  static int slast = 0;
-  static int stimeout = 0;
   static int cacheerr = 0;
   const char *smilie = "= :-)";
 
   if (callscript)
-    fprintf(stderr, "##: %d [%s] @ %ld\n", function,
+    fprintf(stderr, "##%s%s: %d [%s] @ %ld\n", w->name[0] ? " " : "", w->name,
+            function,
             ((int)function >= 0 && (int)function < 16
                  ? callback_strings[function]
                  : ""),
             inpos);
   else {
     if (function == PARANOIA_CB_CACHEERR) {
+      report_lock();
       if (!cacheerr) {
         fprintf(stderr,
                 "\rWARNING: The CDROM drive appears to be seeking impossibly "
@@ -350,6 +444,7 @@ static void callback(long int inpos, paranoia_cb_mode_t function) {
                 "to assist developers in correcting the problem.\n\n");
       }
       cacheerr++;
+      report_unlock();
     }
   }
 
@@ -358,91 +453,85 @@ static void callback(long int inpos, paranoia_cb_mode_t function) {
     osector = inpos;
     sector = inpos / CD_FRAMEWORDS;
 
-    if (printit == -1) {
-      if (isatty(STDERR_FILENO) || (logfile != NULL)) {
-        printit = 1;
-      } else {
-        printit = 0;
-      }
-    }
-
     if (printit == 1) { /* else don't bother; it's probably being
                            redirected */
-      position = ((float)(sector - callbegin) / (callend - callbegin)) * graph;
+      position = ((float)(sector - w->callbegin) / (w->callend - w->callbegin)) *
+                 graph;
 
       aheadposition =
-          ((float)(c_sector - callbegin) / (callend - callbegin)) * graph;
+          ((float)(w->c_sector - w->callbegin) / (w->callend - w->callbegin)) *
+          graph;
 
       if (function == PARANOIA_CB_WROTE) {
-        v_sector = sector;
+        w->v_sector = sector;
         return;
       }
       if (function == PARANOIA_CB_FINISHED) {
-        last = 8;
-        heartbeat = '*';
-        slevel = 0;
-        v_sector = sector;
+        w->last = 8;
+        w->heartbeat = '*';
+        w->slevel = 0;
+        w->v_sector = sector;
       } else if (position < graph && position >= 0)
         switch (function) {
         case PARANOIA_CB_VERIFY:
-          if (stimeout >= 30) {
-            if (overlap > CD_FRAMEWORDS)
-              slevel = 2;
+          if (w->stimeout >= 30) {
+            if (w->overlap > CD_FRAMEWORDS)
+              w->slevel = 2;
             else
-              slevel = 1;
+              w->slevel = 1;
           }
           break;
         case PARANOIA_CB_READ:
-          if (sector > c_sector)
-            c_sector = sector;
+          if (sector > w->c_sector)
+            w->c_sector = sector;
           break;
 
         case PARANOIA_CB_FIXUP_EDGE:
-          if (stimeout >= 5) {
-            if (overlap > CD_FRAMEWORDS)
-              slevel = 2;
+          if (w->stimeout >= 5) {
+            if (w->overlap > CD_FRAMEWORDS)
+              w->slevel = 2;
             else
-              slevel = 1;
+              w->slevel = 1;
           }
-          if (dispcache[position] == ' ')
-            dispcache[position] = '-';
+          if (w->dispcache[position] == ' ')
+            w->dispcache[position] = '-';
           break;
         case PARANOIA_CB_FIXUP_ATOM:
-          if (slevel < 3 || stimeout > 5)
-            slevel = 3;
-          if (dispcache[position] == ' ' || dispcache[position] == '-')
-            dispcache[position] = '+';
+          if (w->slevel < 3 || w->stimeout > 5)
+            w->slevel = 3;
+          if (w->dispcache[position] == ' ' || w->dispcache[position] == '-')
+            w->dispcache[position] = '+';
           break;
         case PARANOIA_CB_READERR:
-          slevel = 6;
-          if (dispcache[position] != 'V' && dispcache[position] != 'C')
-            dispcache[position] = 'e';
+          w->slevel = 6;
+          if (w->dispcache[position] != 'V' && w->dispcache[position] != 'C')
+            w->dispcache[position] = 'e';
           break;
         case PARANOIA_CB_CACHEERR:
-          slevel = 8;
-          dispcache[position] = 'C';
+          w->slevel = 8;
+          w->dispcache[position] = 'C';
           break;
         case PARANOIA_CB_SKIP:
-          slevel = 8;
-          if (dispcache[position] != 'C')
-            dispcache[position] = 'V';
+          w->slevel = 8;
+          if (w->dispcache[position] != 'C')
+            w->dispcache[position] = 'V';
           break;
         case PARANOIA_CB_OVERLAP:
-          overlap = osector;
+          w->overlap = osector;
           break;
         case PARANOIA_CB_SCRATCH:
-          slevel = 7;
+          w->slevel = 7;
           break;
         case PARANOIA_CB_DRIFT:
-          if (slevel < 4 || stimeout > 5)
-            slevel = 4;
+          if (w->slevel < 4 || w->stimeout > 5)
+            w->slevel = 4;
           break;
         case PARANOIA_CB_FIXUP_DROPPED:
         case PARANOIA_CB_FIXUP_DUPED:
-          slevel = 5;
-          if (dispcache[position] == ' ' || dispcache[position] == '-' ||
-              dispcache[position] == '+')
-            dispcache[position] = '!';
+          w->slevel = 5;
+          if (w->dispcache[position] == ' ' || w->dispcache[position] == '-' ||
+              w->dispcache[position] == '+')
+            w->dispcache[position] = '!';
           break;
         case PARANOIA_CB_REPAIR:
         case PARANOIA_CB_BACKOFF:
@@ -453,9 +542,9 @@ static void callback(long int inpos, paranoia_cb_mode_t function) {
             ;
         }
 
-      switch (slevel) {
+      switch (w->slevel) {
       case 0: /* finished, or no jitter */
-        if (skipped_flag)
+        if (w->skipped_flag)
           smilie = " 8-X";
         else
           smilie = " :^D";
@@ -483,77 +572,83 @@ static void callback(long int inpos, paranoia_cb_mode_t function) {
         break;
       case 8: /* skip */
         smilie = " ;-(";
-        skipped_flag = 1;
+        w->skipped_flag = 1;
         break;
       }
 
       gettimeofday(&thistime, NULL);
       test = thistime.tv_sec * 10 + thistime.tv_usec / 100000;
 
-      if (lasttime != test || function == PARANOIA_CB_FINISHED ||
-          slast != slevel) {
-        if (lasttime != test || function == PARANOIA_CB_FINISHED) {
-          last++;
-          lasttime = test;
-          if (last > 7)
-            last = 0;
-          stimeout++;
-          switch (last) {
+      if (w->lasttime != test || function == PARANOIA_CB_FINISHED ||
+          w->slast != w->slevel) {
+        if (w->lasttime != test || function == PARANOIA_CB_FINISHED) {
+          w->last++;
+          w->lasttime = test;
+          if (w->last > 7)
+            w->last = 0;
+          w->stimeout++;
+          switch (w->last) {
           case 0:
-            heartbeat = ' ';
+            w->heartbeat = ' ';
             break;
           case 1:
           case 7:
-            heartbeat = '.';
+            w->heartbeat = '.';
             break;
           case 2:
           case 6:
-            heartbeat = 'o';
+            w->heartbeat = 'o';
             break;
           case 3:
           case 5:
-            heartbeat = '0';
+            w->heartbeat = '0';
             break;
           case 4:
-            heartbeat = 'O';
+            w->heartbeat = 'O';
             break;
           }
           if (function == PARANOIA_CB_FINISHED)
-            heartbeat = '*';
+            w->heartbeat = '*';
         }
-        if (slast != slevel) {
-          stimeout = 0;
+        if (w->slast != w->slevel) {
+          w->stimeout = 0;
         }
-        slast = slevel;
+        w->slast = w->slevel;
 
-        if (abort_on_skip && skipped_flag && function != PARANOIA_CB_FINISHED) {
+        if (abort_on_skip && w->skipped_flag &&
+            function != PARANOIA_CB_FINISHED) {
           sprintf(buffer, "\r (== PROGRESS == [%s| %06ld %02d ] ==%s %c ==)   ",
-                  "  ...aborting; please wait... ", v_sector,
-                  overlap / CD_FRAMEWORDS, smilie, heartbeat);
+                  "  ...aborting; please wait... ", w->v_sector,
+                  w->overlap / CD_FRAMEWORDS, smilie, w->heartbeat);
         } else {
-          if (v_sector == 0)
+          if (w->v_sector == 0)
             sprintf(buffer,
                     "\r (== PROGRESS == [%s| ...... %02d ] ==%s %c ==)   ",
-                    dispcache, overlap / CD_FRAMEWORDS, smilie, heartbeat);
+                    w->dispcache, w->overlap / CD_FRAMEWORDS, smilie,
+                    w->heartbeat);
 
           else
             sprintf(buffer,
                     "\r (== PROGRESS == [%s| %06ld %02d ] ==%s %c ==)   ",
-                    dispcache, v_sector, overlap / CD_FRAMEWORDS, smilie,
-                    heartbeat);
+                    w->dispcache, w->v_sector, w->overlap / CD_FRAMEWORDS,
+                    smilie, w->heartbeat);
 
           if (aheadposition >= 0 && aheadposition < graph &&
               !(function == PARANOIA_CB_FINISHED))
             buffer[aheadposition + 19] = '>';
         }
 
-        if (isatty(STDERR_FILENO))
-          fprintf(stderr, "%s", buffer);
+        if (nworkers > 1)
+          multi_meter(w, buffer, w->v_sector, smilie, function);
+        else {
+          if (isatty(STDERR_FILENO))
+            fprintf(stderr, "%s", buffer);
 
-        if (logfile != NULL && function == PARANOIA_CB_FINISHED) {
-          fprintf(logfile, "%s", buffer + 1);
-          fprintf(logfile, "\n\n");
-          fflush(logfile);
+          if (logfile != NULL && function == PARANOIA_CB_FINISHED) {
+            fprintf(logfile, "%s", buffer + 1);
+            fprintf(logfile, "\n\n");
+            fflush(logfile);
+          }
         }
       }
     }
@@ -561,17 +656,34 @@ static void callback(long int inpos, paranoia_cb_mode_t function) {
 
   /* clear the indicator for next batch */
   if (function == PARANOIA_CB_FINISHED)
-    memset(dispcache, ' ', graph);
+    memset(w->dispcache, ' ', graph);
 }
 #endif /* !TRACE_PARANOIA */
 
+/* long options with no short equivalent */
+enum {
+  OPT_STATS_JSON = 256,
+  OPT_PROFILE_DB,
+  OPT_ADAPT_CACHE,
+  OPT_C2,
+  OPT_TWO_PASS,
+  OPT_CHECKSUMS,
+  OPT_CHECKSUM_DB,
+  OPT_DEFER
+};
+
 static const char optstring[] =
-    "aBcCd:eEfFg:k:hi:l:L:Am:n:o:O:pqQrRsS:Tt:VvwWx:XYZz::";
+    "aBcCd:eEfFg:k:hi:l:L:Am:Mn:o:O:pqQrRsS:Tt:VvwWx:XYZz::";
 
 static const struct option options[] = {
     {"abort-on-skip", no_argument, NULL, 'X'},
+    {"adapt-cache", no_argument, NULL, OPT_ADAPT_CACHE},
     {"analyze-drive", no_argument, NULL, 'A'},
     {"batch", no_argument, NULL, 'B'},
+    {"c2", no_argument, NULL, OPT_C2},
+    {"checksum-db", required_argument, NULL, OPT_CHECKSUM_DB},
+    {"checksums", no_argument, NULL, OPT_CHECKSUMS},
+    {"defer", optional_argument, NULL, OPT_DEFER},
     {"disable-extra-paranoia", no_argument, NULL, 'Y'},
     {"disable-fragmentation", no_argument, NULL, 'F'},
     {"disable-paranoia", no_argument, NULL, 'Z'},
@@ -588,6 +700,7 @@ static const struct option options[] = {
     {"log-summary", required_argument, NULL, 'l'},
     {"log-debug", required_argument, NULL, 'L'},
     {"mmc-timeout", required_argument, NULL, 'm'},
+    {"multi-drive", no_argument, NULL, 'M'},
     {"never-skip", optional_argument, NULL, 'z'},
     {"output-aifc", no_argument, NULL, 'a'},
     {"output-aiff", no_argument, NULL, 'f'},
@@ -596,21 +709,56 @@ static const struct option options[] = {
     {"output-raw-little-endian", no_argument, NULL, 'r'},
     {"output-wav", no_argument, NULL, 'w'},
     {"query", no_argument, NULL, 'Q'},
+    {"profile-db", required_argument, NULL, OPT_PROFILE_DB},
     {"quiet", no_argument, NULL, 'q'},
     {"sample-offset", required_argument, NULL, 'O'},
+    {"stats-json", required_argument, NULL, OPT_STATS_JSON},
     {"stderr-progress", no_argument, NULL, 'e'},
     {"test-mode", required_argument, NULL, 'x'},
     {"toc-bias", no_argument, NULL, 'T'},
     {"toc-offset", required_argument, NULL, 't'},
+    {"two-pass", no_argument, NULL, OPT_TWO_PASS},
     {"verbose", no_argument, NULL, 'v'},
     {"version", no_argument, NULL, 'V'},
 
     {NULL, 0, NULL, 0}};
 
-static cdrom_drive_t *d = NULL;
-static cdrom_paranoia_t *p = NULL;
-static char *span = NULL;
-static char *force_cdrom_device = NULL;
+/* Settings shared by every drive, from the command line */
+static int toc_bias = 0;
+static int force_cdrom_endian = -1;
+static int output_type = 1;   /* 0=raw, 1=wav, 2=aifc */
+static int output_endian = 0; /* -1=host, 0=little, 1=big */
+static int query_only = 0;
+static int batch = 0;
+static int run_cache_test = 0;
+static int adapt_cache = 0;
+static int use_c2 = 0;
+static int two_pass = 0;
+static long int defer_retries = 0;
+static int show_checksums = 0;
+static long int force_cdrom_overlap = -1;
+static long int force_cdrom_sectors = -1;
+static long int force_cdrom_speed = 0;
+static long int force_overread = 0;
+static long int sample_offset_arg = 0;
+static int sample_offset_given = 0;
+static long int test_flags = 0;
+static long int toc_offset_arg = 0;
+static long int max_retries = 20;
+
+/* full paranoia, but allow skipping */
+static int paranoia_mode = PARANOIA_MODE_FULL ^ PARANOIA_MODE_NEVERSKIP;
+
+static char *reportfile_name = NULL;
+static char *stats_json_name = NULL;
+static char *profile_db_name = NULL;
+static char *checksum_db_name = NULL;
+static char *span_arg = NULL;
+static char *outfile_arg = NULL;
+
+/* drives given with -d, -g or -k */
+static char **devices = NULL;
+static int ndevices = 0;
 
 #define free_and_null(p)                                                       \
   free(p);                                                                     \
@@ -626,16 +774,134 @@ static void gettimeofday(struct timeval *tv, void *timezone) {
 }
 #endif
 
+static long long now_us(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* buffering_write(), counting the time it takes for --stats-json, and
+   adding what is written to the checksums. */
+static long timed_write(rip_worker_t *w, int fd, char *buffer, long num) {
+  long long start = now_us();
+  long ret = buffering_write(fd, buffer, num);
+  w->write_us += now_us() - start;
+  if (w->summing)
+    paranoia_checksum_add(&w->sum, buffer, num);
+  return ret;
+}
+
+/* Keep a drive's paranoia statistics before its paranoia object goes. */
+static void save_stats(rip_worker_t *w) {
+  if (w->p) {
+    cdio_paranoia_get_stats(w->p, &w->stats);
+    w->have_stats = 1;
+  }
+}
+
+static void json_string(FILE *f, const char *s) {
+  fputc('"', f);
+  for (; s && *s; s++) {
+    if (*s == '"' || *s == '\\')
+      fprintf(f, "\\%c", *s);
+    else if ((unsigned char)*s < 0x20)
+      fprintf(f, "\\u%04x", (unsigned char)*s);
+    else
+      fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+/* --stats-json: one line per drive with the paranoia statistics and
+   the time spent in each phase, in nanoseconds.  wall_ns is the whole
+   rip and write_ns the part of it spent writing the output, so that
+   wall_ns - time_total - write_ns is what's left for everything else.
+*/
+static void write_stats_json(void) {
+  FILE *f;
+  int i;
+
+  if (!strcmp(stats_json_name, "-"))
+    f = stdout;
+  else if ((f = fopen(stats_json_name, "w")) == NULL) {
+    report("Cannot open statistics file %s: %s", stats_json_name,
+           strerror(errno));
+    return;
+  }
+
+  for (i = 0; i < nworkers; i++) {
+    rip_worker_t *w = &workers[i];
+    paranoia_stats_t *st = &w->stats;
+    long long wall = w->wall_us;
+
+    if (!w->have_stats)
+      continue;
+    if (wall < 0)
+      wall = now_us() - w->start_us;
+
+    fprintf(f, "{\"device\":");
+    json_string(f, w->device ? w->device : w->name);
+    fprintf(f,
+            ",\"status\":%d,\"wall_ns\":%lld,\"write_ns\":%lld"
+            ",\"sectors_returned\":%ld,\"drive_reads\":%ld"
+            ",\"sectors_read\":%ld,\"sectors_reread\":%ld"
+            ",\"bytes_read\":%lld,\"read_errors\":%ld"
+            ",\"cache_seeks\":%ld,\"stage1_matches\":%ld"
+            ",\"stage2_merges\":%ld,\"fixup_edge\":%ld"
+            ",\"fixup_atom\":%ld,\"fixup_dropped\":%ld"
+            ",\"fixup_duped\":%ld,\"skips\":%ld"
+            ",\"c2_sectors\":%ld,\"c2_flagged\":%ld",
+            w->status, wall * 1000, w->write_us * 1000, st->sectors_returned,
+            st->drive_reads, st->sectors_read, st->sectors_reread,
+            st->bytes_read, st->read_errors, st->cache_seeks,
+            st->stage1_matches, st->stage2_merges, st->fixup_edge,
+            st->fixup_atom, st->fixup_dropped, st->fixup_duped, st->skips,
+            st->c2_sectors, st->c2_flagged);
+    fprintf(f,
+            ",\"time_total\":%lld,\"time_read\":%lld"
+            ",\"time_seek\":%lld,\"time_stage1\":%lld"
+            ",\"time_stage2\":%lld,\"time_sort\":%lld"
+            ",\"time_trim\":%lld,\"time_callback\":%lld"
+            ",\"dynoverlap\":%ld,\"dyndrift\":%ld,\"cache_model\":%ld"
+            ",\"fragments\":%ld,\"peak_memory\":%ld}\n",
+            st->time_total, st->time_read, st->time_seek, st->time_stage1,
+            st->time_stage2, st->time_sort, st->time_trim, st->time_callback,
+            st->dynoverlap, st->dyndrift, st->cache_model, st->fragments,
+            st->peak_memory);
+  }
+
+  if (f != stdout)
+    fclose(f);
+  else
+    fflush(f);
+}
+
 /* This is run automatically before leaving the program.
    Free allocated resources.
 */
 static void cleanup(void) {
-  if (p)
-    paranoia_free(p);
-  if (d)
-    cdda_close(d);
-  free_and_null(force_cdrom_device);
-  free_and_null(span);
+  int i;
+  for (i = 0; i < nworkers; i++)
+    save_stats(&workers[i]);
+  if (stats_json_name)
+    write_stats_json();
+  free_and_null(stats_json_name);
+  free_and_null(profile_db_name);
+  free_and_null(checksum_db_name);
+  for (i = 0; i < nworkers; i++) {
+    if (workers[i].p)
+      paranoia_free(workers[i].p);
+    if (workers[i].d)
+      cdda_close(workers[i].d);
+    free(workers[i].span);
+  }
+  free_and_null(workers);
+  nworkers = 0;
+  for (i = 0; i < ndevices; i++)
+    free(devices[i]);
+  free_and_null(devices);
+  ndevices = 0;
+  free_and_null(span_arg);
   if (logfile_open) {
     if (logfile)
       fclose(logfile);
@@ -685,337 +951,110 @@ static bool get_int_arg(char c, long int *pi_arg) {
   }
 }
 
-int main(int argc, char *argv[]) {
-  int toc_bias = 0;
-  int force_cdrom_endian = -1;
-  int output_type = 1;   /* 0=raw, 1=wav, 2=aifc */
-  int output_endian = 0; /* -1=host, 0=little, 1=big */
-  int query_only = 0;
-  int batch = 0;
-  int run_cache_test = 0;
-  long int force_cdrom_overlap = -1;
-  long int force_cdrom_sectors = -1;
-  long int force_cdrom_speed = 0;
-  long int force_overread = 0;
-  long int sample_offset = 0;
-  long int test_flags = 0;
-  long int toc_offset = 0;
-  long int max_retries = 20;
+/* Remember a drive given on the command line or found by autosensing. */
+static void add_device(const char *device) {
+  char **grown = realloc(devices, (ndevices + 1) * sizeof(char *));
+  if (grown == NULL) {
+    report("Out of memory");
+    exit(1);
+  }
+  devices = grown;
+  devices[ndevices++] = strdup(device);
+}
 
-  char *logfile_name = NULL;
-  char *reportfile_name = NULL;
+/* Name a --multi-drive worker after its device, e.g. "sr0" for
+   /dev/sr0, so its messages and files can be told apart. */
+static void name_worker(rip_worker_t *w, int i) {
+  const char *base = strrchr(w->device, '/');
+  int j;
+
+  base = base ? base + 1 : w->device;
+  snprintf(w->name, sizeof(w->name), "%s", *base ? base : "cd");
+  for (j = 0; j < i; j++)
+    if (!strcmp(workers[j].name, w->name)) {
+      snprintf(w->name, sizeof(w->name), "cd%d", i + 1);
+      break;
+    }
+  snprintf(w->tag, sizeof(w->tag), "[%s] ", w->name);
+}
 
-  /* full paranoia, but allow skipping */
-  int paranoia_mode = PARANOIA_MODE_FULL ^ PARANOIA_MODE_NEVERSKIP;
+/* Find, open and configure w's drive.  Returns 0 on success, or 1
+   after reporting why the drive can't be used. */
+static int open_drive(rip_worker_t *w) {
+  cdrom_drive_t *d;
 
-  int out;
+  /* Query the cdrom/disc; we may need to override some settings */
 
-  int c, long_option_index;
+  if (w->device)
+    d = cdda_identify(w->device, verbose, NULL);
+  else {
+    driver_id_t driver_id;
+    char **ppsz_cd_drives =
+        cdio_get_devices_with_cap_ret(NULL, CDIO_FS_AUDIO, false, &driver_id);
+    if (ppsz_cd_drives && *ppsz_cd_drives) {
+      d = cdda_identify(*ppsz_cd_drives, verbose, NULL);
+    } else {
+      report("\nUnable find or access a CD-ROM drive with an audio CD"
+             " in it.");
+      report("\nYou might try specifying the drive, especially if it has"
+             " mixed-mode (and non-audio) format tracks");
+      cdio_free_device_list(ppsz_cd_drives);
+      return 1;
+    }
 
-  atexit(cleanup);
+    cdio_free_device_list(ppsz_cd_drives);
+  }
 
-  while ((c = getopt_long(argc, argv, optstring, options,
-                          &long_option_index)) != EOF) {
-    switch (c) {
-    case 'a':
-      output_type = 2;
-      output_endian = 1;
-      break;
-    case 'B':
-      batch = 1;
-      break;
-    case 'c':
-      force_cdrom_endian = 0;
-      break;
-    case 'C':
-      force_cdrom_endian = 1;
-      break;
-    case 'e':
-      callscript = 1;
-      fprintf(stderr,
-              "Sending all callback output to stderr for wrapper script\n");
-      break;
-    case 'f':
-      output_type = 3;
-      output_endian = 1;
-      break;
-    case 'F':
-      paranoia_mode &= ~(PARANOIA_MODE_FRAGMENT);
-      break;
-    case 'g':
-    case 'k':
-    case 'd':
-      if (force_cdrom_device) {
-        fprintf(stderr,
-                "Multiple cdrom devices given. Previous device %s ignored\n",
-                force_cdrom_device);
-        free(force_cdrom_device);
-      }
-      force_cdrom_device = strdup(optarg);
-      break;
-    case 'h':
-      usage(stdout);
-      exit(0);
-    case 'l':
-      if (logfile_name)
-        free(logfile_name);
-      logfile_name = NULL;
-      if (optarg)
-        logfile_name = strdup(optarg);
-      logfile_open = 1;
-      break;
-    case 'L':
-      if (reportfile_name)
-        free(reportfile_name);
-      reportfile_name = NULL;
-      if (optarg)
-        reportfile_name = strdup(optarg);
-      reportfile_open = 1;
-      break;
-    case 'm': {
-      long int mmc_timeout_sec;
-      if (get_int_arg(c, &mmc_timeout_sec)) {
-        mmc_timeout_ms = 1000 * mmc_timeout_sec;
-      }
-    } break;
-    case 'n':
-      get_int_arg(c, &force_cdrom_sectors);
-      break;
-    case 'o':
-      get_int_arg(c, &force_cdrom_overlap);
-      break;
-    case 'O':
-      get_int_arg(c, &sample_offset);
-      break;
-    case 'p':
-      output_type = 0;
-      output_endian = -1;
-      break;
-    case 'r':
-      output_type = 0;
-      output_endian = 0;
-      break;
-    case 'q':
-      verbose = CDDA_MESSAGE_FORGETIT;
-      quiet = 1;
-      break;
-    case 'Q':
-      query_only = 1;
-      break;
-    case 'R':
-      output_type = 0;
-      output_endian = 1;
-      break;
-    case 'S':
-      get_int_arg(c, &force_cdrom_speed);
-      break;
-    case 't':
-      get_int_arg(c, &toc_offset);
-      break;
-    case 'T':
-      toc_bias = -1;
-      break;
-    case 'v':
-      verbose = CDDA_MESSAGE_PRINTIT;
-      quiet = 0;
-      break;
-    case 'V':
-      fprintf(stderr, PARANOIA_VERSION);
-      fprintf(stderr, "\n");
-      exit(0);
-      break;
-    case 'w':
-      output_type = 1;
-      output_endian = 0;
-      break;
-    case 'W':
-      paranoia_mode &= ~PARANOIA_MODE_REPAIR;
-      break;
-    case 'x':
-      get_int_arg(c, &test_flags);
-      break;
-    case 'X':
-      /*paranoia_mode&=~(PARANOIA_MODE_SCRATCH|PARANOIA_MODE_REPAIR);*/
-      abort_on_skip = 1;
-      break;
-    case 'Y':
-      paranoia_mode |= PARANOIA_MODE_OVERLAP; /* cdda2wav style overlap
-                                                  check only */
-      paranoia_mode &= ~PARANOIA_MODE_VERIFY;
-      break;
-    case 'Z':
-      paranoia_mode = PARANOIA_MODE_DISABLE;
-      break;
-    case 'A':
-      run_cache_test = 1;
-      query_only = 1;
-      reportfile_open = 1;
-      verbose = CDDA_MESSAGE_PRINTIT;
-      break;
-    case 'z':
-      if (optarg) {
-        get_int_arg(c, &max_retries);
-        paranoia_mode &= ~PARANOIA_MODE_NEVERSKIP;
-      } else {
-        paranoia_mode |= PARANOIA_MODE_NEVERSKIP;
-      }
+  if (!d) {
+    if (!verbose)
+      report("\nUnable to open cdrom drive; -v might give more information.");
+    return 1;
+  }
+  w->d = d;
+
+  if (verbose)
+    cdda_verbose_set(d, CDDA_MESSAGE_PRINTIT, CDDA_MESSAGE_PRINTIT);
+  else
+    cdda_verbose_set(d, CDDA_MESSAGE_PRINTIT, CDDA_MESSAGE_FORGETIT);
+
+  /* start from what we learned about this drive model last time */
+  if (profile_db_name) {
+    switch (cdda_profile_use(d, profile_db_name)) {
+    case 1:
+      if (verbose)
+        report("Using the saved profile for this drive from %s",
+               profile_db_name);
       break;
-    case 'E':
-      force_overread = 1;
+    case -1:
+      report("Cannot read drive profiles from %s: %s", profile_db_name,
+             strerror(errno));
       break;
-    default:
-      usage(stderr);
-      exit(1);
     }
   }
 
-  if (logfile_open) {
-    if (logfile_name == NULL)
-      logfile_name = strdup("cdparanoia.log");
-    if (!strcmp(logfile_name, "-")) {
-      logfile = stdout;
-      logfile_open = 0;
-    } else {
-      logfile = fopen(logfile_name, "w");
-      if (logfile == NULL) {
-        report("Cannot open log summary file %s: %s", logfile_name,
-               strerror(errno));
-        exit(1);
-      }
-    }
-  }
-  if (reportfile_open) {
-    if (reportfile_name == NULL)
-      reportfile_name = strdup("cdparanoia.log");
-    if (!strcmp(reportfile_name, "-")) {
-      reportfile = stdout;
-      reportfile_open = 0;
-    } else {
-      if (logfile_name && !strcmp(reportfile_name, logfile_name)) {
-        reportfile = logfile;
-        reportfile_open = 0;
-      } else {
-        reportfile = fopen(reportfile_name, "w");
-        if (reportfile == NULL) {
-          report("Cannot open debug log file %s: %s", reportfile_name,
-                 strerror(errno));
-          exit(1);
-        }
-      }
-    }
-  }
-
-  if (logfile) {
-    /* log command line and version */
-    int i;
-    for (i = 0; i < argc; i++)
-      fprintf(logfile, "%s ", argv[i]);
-    fprintf(logfile, "\n");
-
-    if (reportfile != logfile) {
-      fprintf(logfile, VERSION);
-      fprintf(logfile, "\n");
-      fprintf(logfile, "Using cdda library version: %s\n", cdda_version());
-      fprintf(logfile, "Using paranoia library version: %s\n",
-              paranoia_version());
-    }
-    fflush(logfile);
-  }
-
-  if (reportfile && reportfile != logfile) {
-    /* log command line */
-    int i;
-    for (i = 0; i < argc; i++)
-      fprintf(reportfile, "%s ", argv[i]);
-    fprintf(reportfile, "\n");
-    fflush(reportfile);
-  }
-
-  if (optind >= argc && !query_only) {
-    if (batch)
-      span = NULL;
-    else {
-      /* D'oh.  No span. Fetch me a brain, Igor. */
-      usage(stderr);
-      exit(1);
-    }
-  } else if (argv[optind])
-    span = strdup(argv[optind]);
-
-  report(PARANOIA_VERSION);
-  if (verbose) {
-    report("Using cdda library version: %s", cdda_version());
-    report("Using paranoia library version: %s", paranoia_version());
-  }
-
-  /* Query the cdrom/disc; we may need to override some settings */
-
-  if (force_cdrom_device)
-    d = cdda_identify(force_cdrom_device, verbose, NULL);
-  else {
-    driver_id_t driver_id;
-    char **ppsz_cd_drives =
-        cdio_get_devices_with_cap_ret(NULL, CDIO_FS_AUDIO, false, &driver_id);
-    if (ppsz_cd_drives && *ppsz_cd_drives) {
-      d = cdda_identify(*ppsz_cd_drives, verbose, NULL);
-    } else {
-      report("\nUnable find or access a CD-ROM drive with an audio CD"
-             " in it.");
-      report("\nYou might try specifying the drive, especially if it has"
-             " mixed-mode (and non-audio) format tracks");
-      exit(1);
-    }
-
-    cdio_free_device_list(ppsz_cd_drives);
-  }
-
-  if (!d) {
-    if (!verbose)
-      report("\nUnable to open cdrom drive; -v might give more information.");
-    exit(1);
-  }
-
-  if (verbose)
-    cdda_verbose_set(d, CDDA_MESSAGE_PRINTIT, CDDA_MESSAGE_PRINTIT);
-  else
-    cdda_verbose_set(d, CDDA_MESSAGE_PRINTIT, CDDA_MESSAGE_FORGETIT);
-
-  /* possibly force hand on endianness of drive, sector request size */
-  if (force_cdrom_endian != -1) {
-    d->bigendianp = force_cdrom_endian;
-    switch (force_cdrom_endian) {
-    case 0:
-      report("Forcing CDROM sense to little-endian; ignoring preset and "
-             "autosense");
-      break;
-    case 1:
-      report(
-          "Forcing CDROM sense to big-endian; ignoring preset and autosense");
-      break;
+  /* possibly force hand on endianness of drive, sector request size */
+  if (force_cdrom_endian != -1) {
+    d->bigendianp = force_cdrom_endian;
+    switch (force_cdrom_endian) {
+    case 0:
+      report("Forcing CDROM sense to little-endian; ignoring preset and "
+             "autosense");
+      break;
+    case 1:
+      report(
+          "Forcing CDROM sense to big-endian; ignoring preset and autosense");
+      break;
     }
   }
   if (force_cdrom_sectors != -1) {
-    if (force_cdrom_sectors < 0 || force_cdrom_sectors > 100) {
-      report("Default sector read size must be 1<= n <= 100\n");
-      cdda_close(d);
-      d = NULL;
-      exit(1);
-    }
     report("Forcing default to read %ld sectors; "
            "ignoring preset and autosense",
            force_cdrom_sectors);
     d->nsectors = force_cdrom_sectors;
+    if (cdda_profile(d))
+      cdda_profile(d)->nsectors = force_cdrom_sectors;
   }
   if (force_cdrom_overlap != -1) {
-    if (force_cdrom_overlap < 0 ||
-        force_cdrom_overlap > CDIO_CD_FRAMES_PER_SEC) {
-      report("Search overlap sectors must be 0<= n <=75\n");
-      cdda_close(d);
-      d = NULL;
-      if (logfile && logfile != stdout)
-        fclose(logfile);
-      exit(1);
-    }
     report("Forcing search overlap to %ld sectors; "
            "ignoring autosense",
            force_cdrom_overlap);
@@ -1027,22 +1066,19 @@ int main(int argc, char *argv[]) {
   case -4:
   case -5:
     report("\nUnable to open disc.  Is there an audio CD in the drive?");
-    exit(1);
+    return 1;
   case -6:
     report("\nCdparanoia could not find a way to read audio from this drive.");
-    exit(1);
+    return 1;
   case 0:
     break;
   default:
     report("\nUnable to open disc.");
-    exit(1);
+    return 1;
   }
 
   d->i_test_flags = test_flags;
 
-  if (force_cdrom_speed == 0)
-    force_cdrom_speed = -1;
-
   if (force_cdrom_speed != -1) {
     report("\nAttempting to set speed to %ldx... ", force_cdrom_speed);
   } else {
@@ -1058,6 +1094,244 @@ int main(int argc, char *argv[]) {
       report("\tdrive returned OK.");
   }
 
+  return 0;
+}
+
+/* Rip (or query, or analyze) the disc in w's already opened drive.
+   Returns the exit status for this drive. */
+/* Most ranges --two-pass re-rips one at a time; past that, the rest of
+   the batch is re-ripped as one. */
+#define TWO_PASS_RANGES 64
+
+/* sectors read at a time by checksum_file() */
+#define CHECKSUM_SECTORS 64
+
+/* --defer: reads without progress before a place is put off, and the
+   speed it is then ripped at */
+#define DEFER_RETRIES 5
+#define DEFER_SPEED 4
+
+/* Rip (n) ranges again in paranoia_mode and write them over what was
+   written of them.  Disc byte (data_begin) was written at file offset
+   (data), and (data_len) bytes from there; (carry) is the copy of
+   sector (carry_lsn) kept for the next batch, or NULL.  Read errors,
+   and with -X skips, leave w->skipped_flag set.  Returns 0, or -1 if
+   the output couldn't be written. */
+static int rerip(rip_worker_t *w, int out, off_t data, long long data_begin,
+                 long long data_len, int16_t *carry, long carry_lsn,
+                 const paranoia_range_t *ranges, int n) {
+  cdrom_paranoia_t *p = w->p;
+  long long data_end = data_begin + data_len;
+  int skipped = 0, failed = 0;
+  int i;
+
+  paranoia_modeset(p, paranoia_mode);
+
+  for (i = 0; i < n && !failed && !(skipped && abort_on_skip); i++) {
+    const paranoia_range_t *r = &ranges[i];
+    long sectors = r->last - r->first + 1;
+    long long begin = (long long)r->first * CDIO_CD_FRAMESIZE_RAW;
+    long long end = begin + (long long)sectors * CDIO_CD_FRAMESIZE_RAW;
+    int16_t *buf = malloc(sectors * CDIO_CD_FRAMESIZE_RAW);
+    unsigned char *status = malloc(sectors);
+    long got, j;
+
+    if (!buf || !status) {
+      free(buf);
+      free(status);
+      errno = ENOMEM;
+      return -1;
+    }
+    got = paranoia_reread(p, r, buf, status, callback, max_retries);
+    if (got < sectors) {
+      report("\nparanoia_reread: Unrecoverable error, bailing.\n");
+      failed = 1;
+    }
+    for (j = 0; j < got; j++)
+      if (status[j] & PARANOIA_SECTOR_SKIPPED)
+        skipped = 1;
+
+    if (got == sectors) {
+      if (output_endian != bigendianp())
+        for (j = 0; j < sectors * CD_FRAMEWORDS; j++)
+          buf[j] = UINT16_SWAP_LE_BE_C(buf[j]);
+      if (carry && carry_lsn >= r->first && carry_lsn <= r->last)
+        memcpy(carry, buf + (carry_lsn - r->first) * CD_FRAMEWORDS,
+               CDIO_CD_FRAMESIZE_RAW);
+
+      if (begin < data_begin)
+        begin = data_begin;
+      if (end > data_end)
+        end = data_end;
+      if (end > begin &&
+          buffering_write_at(out, data + (begin - data_begin),
+                             (char *)buf + (begin - (long long)r->first *
+                                                        CDIO_CD_FRAMESIZE_RAW),
+                             end - begin)) {
+        free(buf);
+        free(status);
+        return -1;
+      }
+    }
+    free(buf);
+    free(status);
+  }
+
+  w->skipped_flag = failed || (skipped && abort_on_skip);
+  return 0;
+}
+
+/* --two-pass: once a batch has been read straight through and written,
+   read it again, and rip what didn't read the same both times with
+   full paranoia, writing it over the first read.  Arguments are as
+   for rerip().  Returns the number of ranges written over, or -1 if
+   the output couldn't be written. */
+static int two_pass_fixup(rip_worker_t *w, int out, off_t data,
+                          long long data_begin, long long data_len,
+                          int16_t *carry, long carry_lsn) {
+  cdrom_paranoia_t *p = w->p;
+  paranoia_range_t ranges[TWO_PASS_RANGES];
+  int n;
+
+  n = paranoia_recheck(p, ranges, TWO_PASS_RANGES, callback, max_retries);
+  if (n < 0) {
+    report("\nparanoia_recheck: %s, bailing.\n", strerror(errno));
+    w->skipped_flag = 1;
+    return 0;
+  }
+  /* the callback flags skips; here they only mean a difference */
+  w->skipped_flag = 0;
+  if (n > TWO_PASS_RANGES) {
+    ranges[TWO_PASS_RANGES - 1].last =
+        (data_begin + data_len - 1) / CDIO_CD_FRAMESIZE_RAW;
+    if (carry && carry_lsn > ranges[TWO_PASS_RANGES - 1].last)
+      ranges[TWO_PASS_RANGES - 1].last = carry_lsn;
+    n = TWO_PASS_RANGES;
+  }
+  if (n == 0)
+    return 0;
+
+  report("\n%d range%s read differently the second time; "
+         "ripping again with paranoia.\n",
+         n, n == 1 ? "" : "s");
+  if (rerip(w, out, data, data_begin, data_len, carry, carry_lsn, ranges, n))
+    return -1;
+  paranoia_modeset(p, PARANOIA_MODE_DISABLE);
+  return n;
+}
+
+/* --defer: once a batch has been written, rip what paranoia put off
+   while reading it, with the drive slowed down, and write it over
+   what was skipped.  Arguments are as for rerip().  Returns the
+   number of ranges written over, or -1 if the output couldn't be
+   written. */
+static int defer_fixup(rip_worker_t *w, int out, off_t data,
+                       long long data_begin, long long data_len,
+                       int16_t *carry, long carry_lsn) {
+  cdrom_paranoia_t *p = w->p;
+  paranoia_range_t ranges[TWO_PASS_RANGES];
+  int total = 0, n;
+
+  /* the callback flagged the skips that put them off */
+  w->skipped_flag = 0;
+  while (!w->skipped_flag &&
+         (n = paranoia_deferred(p, ranges, TWO_PASS_RANGES)) != 0) {
+    if (n < 0) {
+      report("\nparanoia_deferred: %s, bailing.\n", strerror(errno));
+      w->skipped_flag = 1;
+      break;
+    }
+    if (total == 0) {
+      report("\nRipping again what was put off%s.\n",
+             force_cdrom_speed == -1 || force_cdrom_speed > DEFER_SPEED
+                 ? ", at reduced speed"
+                 : "");
+      if (force_cdrom_speed == -1 || force_cdrom_speed > DEFER_SPEED)
+        cdda_speed_set(w->d, DEFER_SPEED);
+    }
+    total += n;
+    if (rerip(w, out, data, data_begin, data_len, carry, carry_lsn, ranges,
+              n))
+      return -1;
+  }
+  if (total && (force_cdrom_speed == -1 || force_cdrom_speed > DEFER_SPEED))
+    cdda_speed_set(w->d, force_cdrom_speed);
+  /* whatever is left belongs to later batches, which read it afresh */
+  while (paranoia_deferred(p, ranges, TWO_PASS_RANGES) > 0)
+    ;
+  return total;
+}
+
+/* After --two-pass has written over parts of file (name), add up
+   w->sum again from the (sectors) sectors that start at offset (data).
+   The file has only just been written, so this shouldn't need the
+   disk.  Returns 0, or -1 with errno set. */
+static int checksum_file(rip_worker_t *w, const char *name, off_t data,
+                         long sectors) {
+  char *buf = malloc(CHECKSUM_SECTORS * CDIO_CD_FRAMESIZE_RAW);
+  int fd = open(name, O_RDONLY | O_BINARY);
+  long num;
+
+  if (!buf || fd == -1 || lseek(fd, data, SEEK_SET) == -1) {
+    free(buf);
+    if (fd != -1)
+      close(fd);
+    return -1;
+  }
+  paranoia_checksum_init(&w->sum, sectors, w->sum_flags);
+  while ((num = read(fd, buf, CHECKSUM_SECTORS * CDIO_CD_FRAMESIZE_RAW)) > 0)
+    paranoia_checksum_add(&w->sum, buf, num);
+  free(buf);
+  close(fd);
+  return num == 0 ? 0 : -1;
+}
+
+/* --checksums and --checksum-db: report the checksums of a file that
+   was ripped whole, and remember them if they're new.  (rewritten)
+   ranges were written over since they were added up. */
+static void finish_checksums(rip_worker_t *w, const char *name, off_t data,
+                             long sectors, int rewritten) {
+  paranoia_checksum_t *c = &w->sum;
+
+  if (rewritten > 0 && checksum_file(w, name, data, sectors)) {
+    report("\nCannot checksum %s: %s", name, strerror(errno));
+    return;
+  }
+  if (c->samples != (uint32_t)sectors * CD_FRAMESAMPLES)
+    return;
+
+  if (show_checksums)
+    report("\nCRC32 %08lX  AccurateRip v1 %08lX  v2 %08lX",
+           (unsigned long)c->crc32, (unsigned long)c->ar_v1,
+           (unsigned long)c->ar_v2);
+  if (logfile) {
+    report_lock();
+    fprintf(logfile, "%s%s: CRC32 %08lX  AccurateRip v1 %08lX  v2 %08lX\n",
+            w->tag, name, (unsigned long)c->crc32, (unsigned long)c->ar_v1,
+            (unsigned long)c->ar_v2);
+    fflush(logfile);
+    report_unlock();
+  }
+
+  if (checksum_db_name && !checksum_db_find(sectors, c)) {
+    if (checksum_db_add(sectors, c, name))
+      report("\nCannot add to checksum database %s: %s", checksum_db_name,
+             strerror(errno));
+  }
+}
+
+static int rip_drive(rip_worker_t *w) {
+  cdrom_drive_t *d = w->d;
+  cdrom_paranoia_t *p;
+  char *span = w->span;
+  long int toc_offset = toc_offset_arg;
+  long int sample_offset = sample_offset_arg;
+  cdda_profile_t *prof = cdda_profile(d);
+  char prefix[sizeof(w->name) + 1];
+  int out;
+
+  snprintf(prefix, sizeof(prefix), "%s%s", w->name, w->name[0] ? "." : "");
+
   if (run_cache_test) {
     int warn = analyze_cache(d, stderr, reportfile, force_cdrom_speed);
 
@@ -1085,7 +1359,7 @@ int main(int argc, char *argv[]) {
     display_toc(d);
 
   if (query_only)
-    exit(0);
+    return 0;
 
   /*
      Nearly all CD-ROM/CD-R drives will add a sample offset (either
@@ -1140,6 +1414,9 @@ int main(int argc, char *argv[]) {
      tracks will be padded with empty data rather than attempting to
      read beyond the disk lead-in/lead-out.
 
+     With --profile-db, an offset given here is remembered for the
+     drive model, and used when none is given next time.
+
      For more info, see:
        -
      https://www.exactaudiocopy.de/en/index.php/support/faq/offset-questions/
@@ -1149,6 +1426,12 @@ int main(int argc, char *argv[]) {
      [Note to libcdio driver hackers: make sure all CD-drivers don't
      try to read outside of the stated disc boundaries.]
   */
+  if (prof) {
+    if (sample_offset_given)
+      prof->sample_offset = sample_offset;
+    else if (prof->sample_offset != CDDA_PROFILE_UNKNOWN)
+      sample_offset = prof->sample_offset;
+  }
   if (sample_offset) {
     toc_offset += sample_offset / 588;
     sample_offset %= 588;
@@ -1183,7 +1466,7 @@ int main(int argc, char *argv[]) {
       char *span2 = strchr(span, '-');
       if (strrchr(span, '-') != span2) {
         report("Error parsing span argument");
-        exit(1);
+        return 1;
       }
 
       if (span2 != NULL) {
@@ -1192,17 +1475,21 @@ int main(int argc, char *argv[]) {
       }
 
       i_first_lsn = parse_offset(d, span, -1);
+      if (i_first_lsn == -2)
+        return 1;
 
       if (i_first_lsn == -1)
         i_last_lsn = parse_offset(d, span2, cdda_disc_firstsector(d));
 
       else
         i_last_lsn = parse_offset(d, span2, i_first_lsn);
+      if (i_last_lsn == -2)
+        return 1;
 
       if (i_first_lsn == -1) {
         if (i_last_lsn == -1) {
           report("Error parsing span argument");
-          exit(1);
+          return 1;
         } else {
           i_first_lsn = cdda_disc_firstsector(d);
         }
@@ -1225,11 +1512,11 @@ int main(int argc, char *argv[]) {
       /* Check for errors on lsn before getting track */
       if (i_first_lsn < 0) {
         report("Error on begin of span: %li.  Aborting.\n\n", i_first_lsn);
-        exit(1);
+        return 1;
       }
       if (i_last_lsn < 0) {
         report("Error on end of span: %li.  Aborting.\n\n", i_last_lsn);
-        exit(1);
+        return 1;
       }
 
       int track1 = cdda_sector_gettrack(d, i_first_lsn);
@@ -1242,7 +1529,7 @@ int main(int argc, char *argv[]) {
           report("Selected span contains non audio track at track %02d.  "
                  "Aborting.\n\n",
                  i);
-          exit(1);
+          return 1;
         }
       }
 
@@ -1276,14 +1563,27 @@ int main(int argc, char *argv[]) {
       int offset_buffer_used = 0;
       int offset_skip = sample_offset * 4;
       off_t sectorlen;
+      off_t data_start;
+      const char *known;
+      int rewritten;
 
-#if defined(HAVE_GETUID) && (defined(HAVE_SETEUID) || defined(HAVE_SETEGID))
-      int dummy __attribute__((unused));
-#endif
-      p = paranoia_init(d);
+      w->p = p = paranoia_init(d);
       paranoia_modeset(p, paranoia_mode);
       if (force_cdrom_overlap != -1)
         paranoia_overlapset(p, force_cdrom_overlap);
+      if (adapt_cache)
+        paranoia_cachemodel_adapt(p, 1);
+      if (use_c2)
+        paranoia_c2(p, 1);
+      if (defer_retries)
+        paranoia_defer(p, defer_retries);
+      /* --two-pass reads everything through without verifying first. */
+      if (two_pass)
+        paranoia_modeset(p, PARANOIA_MODE_DISABLE);
+      /* With nothing to verify, only the drive sets the pace; keep it
+         reading while the output is written. */
+      if (paranoia_mode == PARANOIA_MODE_DISABLE || two_pass)
+        paranoia_threaded(p, 2);
 
       if (verbose) {
         cdda_verbose_set(d, CDDA_MESSAGE_LOGIT, CDDA_MESSAGE_LOGIT);
@@ -1293,14 +1593,6 @@ int main(int argc, char *argv[]) {
 
       paranoia_seek(p, cursor = i_first_lsn, SEEK_SET);
 
-      /* this is probably a good idea in general */
-#if defined(HAVE_GETUID) && defined(HAVE_SETEUID)
-      dummy = seteuid(getuid());
-#endif
-#if defined(HAVE_GETGID) && defined(HAVE_SETEGID)
-      dummy = setegid(getgid());
-#endif
-
       while (cursor <= i_last_lsn) {
         char outfile_name[PATH_MAX];
         if (batch) {
@@ -1315,51 +1607,57 @@ int main(int argc, char *argv[]) {
           batch_track = -1;
         }
 
-        callbegin = batch_first;
-        callend = batch_last;
+        w->callbegin = batch_first;
+        w->callend = batch_last;
 
-        /* argv[optind] is the span, argv[optind+1] (if exists) is outfile */
+        /* outfile_arg is argv[optind+1], if there was one */
 
-        if (optind + 1 < argc) {
-          if (!strcmp(argv[optind + 1], "-")) {
+        if (outfile_arg) {
+          if (!strcmp(outfile_arg, "-")) {
+            if (two_pass || defer_retries) {
+              report("--%s rewrites its output, which can't be stdout.",
+                     two_pass ? "two-pass" : "defer");
+              return 1;
+            }
             out = dup(fileno(stdout));
             if (out == -1) {
               report("Cannot duplicate stdout: %s", strerror(errno));
-              exit(1);
+              return 1;
             }
             if (batch)
               report("Are you sure you wanted 'batch' "
                      "(-B) output with stdout?");
             report("outputting to stdout\n");
             if (logfile) {
-              fprintf(logfile, "outputting to stdout\n");
+              fprintf(logfile, "%soutputting to stdout\n", w->tag);
               fflush(logfile);
             }
             outfile_name[0] = '\0';
           } else {
             char dirname[PATH_MAX];
             char *basename =
-                split_base_dir(argv[optind + 1], dirname, PATH_MAX);
+                split_base_dir(outfile_arg, dirname, PATH_MAX);
 
             if (NULL == basename) {
               report("Output filename too long");
-              exit(1);
+              return 1;
             }
 
             int res;
             if (batch) {
-              res = snprintf(outfile_name, PATH_MAX, " %strack%02d.%s", dirname,
-                             batch_track, basename);
+              res = snprintf(outfile_name, PATH_MAX, " %s%strack%02d.%s",
+                             dirname, prefix, batch_track, basename);
             } else
-              res = snprintf(outfile_name, PATH_MAX, "%s%s", dirname, basename);
+              res = snprintf(outfile_name, PATH_MAX, "%s%s%s", dirname, prefix,
+                             basename);
 
             if (res < 0) {
               report("Error on setting filename");
-              exit(1);
+              return 1;
             }
             if (res >= PATH_MAX) {
               report("Output filename too long");
-              exit(1);
+              return 1;
             }
 
             if (basename[0] == '\0') {
@@ -1388,20 +1686,20 @@ int main(int argc, char *argv[]) {
             if (out == -1) {
               report("Cannot open specified output file %s: %s", outfile_name,
                      strerror(errno));
-              exit(1);
+              return 1;
             }
             report("outputting to %s\n", outfile_name);
             if (logfile) {
-              fprintf(logfile, "outputting to %s\n", outfile_name);
+              fprintf(logfile, "%soutputting to %s\n", w->tag, outfile_name);
               fflush(logfile);
             }
           }
         } else {
           /* default */
           if (batch)
-            sprintf(outfile_name, "track%02d.", batch_track);
+            sprintf(outfile_name, "%strack%02d.", prefix, batch_track);
           else
-            outfile_name[0] = '\0';
+            strcpy(outfile_name, prefix);
 
           switch (output_type) {
           case 0: /* raw */
@@ -1426,11 +1724,11 @@ int main(int argc, char *argv[]) {
           if (out == -1) {
             report("Cannot open default output file %s: %s", outfile_name,
                    strerror(errno));
-            exit(1);
+            return 1;
           }
           report("outputting to %s\n", outfile_name);
           if (logfile) {
-            fprintf(logfile, "outputting to %s\n", outfile_name);
+            fprintf(logfile, "%soutputting to %s\n", w->tag, outfile_name);
             fflush(logfile);
           }
         }
@@ -1453,31 +1751,52 @@ int main(int argc, char *argv[]) {
           WriteAiff(out, sectorlen * CD_FRAMESIZE_RAW);
           break;
         }
+        data_start = lseek(out, 0, SEEK_CUR);
+        if (two_pass)
+          paranoia_checksums(p, 1);
+        rewritten = 0;
+        w->summing = show_checksums || checksum_db_name;
+        if (w->summing) {
+          w->sum_flags = 0;
+          if (cdda_sector_gettrack(d, batch_first - toc_offset) <=
+              d->disc_toc[0].bTrack)
+            w->sum_flags |= PARANOIA_CHECKSUM_FIRST;
+          if (cdda_sector_gettrack(d, batch_last - toc_offset) == d->tracks)
+            w->sum_flags |= PARANOIA_CHECKSUM_LAST;
+          if (bigendianp() ^ (output_endian != bigendianp()))
+            w->sum_flags |= PARANOIA_CHECKSUM_BIGENDIAN;
+          paranoia_checksum_init(&w->sum, sectorlen, w->sum_flags);
+        }
 
         /* Off we go! */
 
         if (offset_buffer_used) {
           /* partial sector from previous batch read */
           cursor++;
-          if (buffering_write(out, ((char *)offset_buffer) + offset_buffer_used,
-                              CDIO_CD_FRAMESIZE_RAW - offset_buffer_used)) {
+          if (timed_write(w, out,
+                          ((char *)offset_buffer) + offset_buffer_used,
+                          CDIO_CD_FRAMESIZE_RAW - offset_buffer_used)) {
             report("Error writing output: %s", strerror(errno));
-            exit(1);
+            buffering_close(out);
+            return 1;
           }
         }
 
-        skipped_flag = 0;
+        w->skipped_flag = 0;
         while (cursor <= batch_last) {
           /* read a sector */
           int16_t *readbuf = paranoia_read_limited(p, callback, max_retries);
           char *err = cdda_errors(d);
           char *mes = cdda_messages(d);
 
-          if (mes || err)
+          if (mes || err) {
+            report_lock();
             fprintf(stderr,
                     "\r                               "
-                    "                                           \r%s%s\n",
-                    mes ? mes : "", err ? err : "");
+                    "                                           \r%s%s%s\n",
+                    w->tag, mes ? mes : "", err ? err : "");
+            report_unlock();
+          }
 
           if (err)
             free(err);
@@ -1486,18 +1805,20 @@ int main(int argc, char *argv[]) {
           if (readbuf == NULL) {
             if (errno == EBADF || errno == ENOMEDIUM) {
               report("\nparanoia_read: CDROM drive unavailable, bailing.\n");
-              exit(1);
+              buffering_close(out);
+              return 1;
             }
-            skipped_flag = 1;
+            w->skipped_flag = 1;
             report("\nparanoia_read: Unrecoverable error, bailing.\n");
             break;
           }
-          if (skipped_flag && abort_on_skip) {
+          if (w->skipped_flag && abort_on_skip && !two_pass &&
+              !defer_retries) {
             cursor = batch_last + 1;
             break;
           }
 
-          skipped_flag = 0;
+          w->skipped_flag = 0;
           cursor++;
 
           if (output_endian != bigendianp()) {
@@ -1508,10 +1829,11 @@ int main(int argc, char *argv[]) {
 
           callback(cursor * (CD_FRAMEWORDS)-1, PARANOIA_CB_WROTE);
 
-          if (buffering_write(out, ((char *)readbuf) + offset_skip,
-                              CDIO_CD_FRAMESIZE_RAW - offset_skip)) {
+          if (timed_write(w, out, ((char *)readbuf) + offset_skip,
+                          CDIO_CD_FRAMESIZE_RAW - offset_skip)) {
             report("Error writing output: %s", strerror(errno));
-            exit(1);
+            buffering_close(out);
+            return 1;
           }
           offset_skip = 0;
 
@@ -1537,25 +1859,29 @@ int main(int argc, char *argv[]) {
               err = cdda_errors(d);
               mes = cdda_messages(d);
 
-              if (mes || err)
+              if (mes || err) {
+                report_lock();
                 fprintf(stderr,
                         "\r                               "
-                        "                                           \r%s%s\n",
-                        mes ? mes : "", err ? err : "");
+                        "                                           \r%s%s%s\n",
+                        w->tag, mes ? mes : "", err ? err : "");
+                report_unlock();
+              }
 
               if (err)
                 free(err);
               if (mes)
                 free(mes);
               if (readbuf == NULL) {
-                skipped_flag = 1;
+                w->skipped_flag = 1;
                 report("\nparanoia_read: Unrecoverable error reading through "
                        "sample_offset shift\n\tat end of track, bailing.\n");
                 break;
               }
-              if (skipped_flag && abort_on_skip)
+              if (w->skipped_flag && abort_on_skip && !two_pass &&
+                  !defer_retries)
                 break;
-              skipped_flag = 0;
+              w->skipped_flag = 0;
               /* do not move the cursor */
 
               if (output_endian != bigendianp())
@@ -1570,10 +1896,11 @@ int main(int argc, char *argv[]) {
               offset_buffer_used = sample_offset * 4;
             }
 
-            if (buffering_write(out, (char *)offset_buffer,
-                                offset_buffer_used)) {
+            if (timed_write(w, out, (char *)offset_buffer,
+                            offset_buffer_used)) {
               report("Error writing output: %s", strerror(errno));
-              exit(1);
+              buffering_close(out);
+              return 1;
             }
           }
         }
@@ -1586,17 +1913,62 @@ int main(int argc, char *argv[]) {
           size_t missing_sector_bytes = CD_FRAMESIZE_RAW * toc_offset;
 
           silence = calloc(toc_offset, CD_FRAMESIZE_RAW);
-          if (!silence || buffering_write(out, silence, missing_sector_bytes)) {
+          if (!silence ||
+              timed_write(w, out, silence, missing_sector_bytes)) {
             report("Error writing output: %s", strerror(errno));
-            exit(1);
+            free(silence);
+            buffering_close(out);
+            return 1;
           }
           free(silence);
         }
 
+        /* Go back over what was written.  With --two-pass, read it
+           again, and rip what differs, skips in the first read
+           included; that isn't needed if the first matches a track
+           already known to be good.  With --defer, rip what was put
+           off. */
+        if ((two_pass || defer_retries) && cursor > batch_last &&
+            !w->skipped_flag) {
+          long long data_begin =
+              (long long)batch_first * CDIO_CD_FRAMESIZE_RAW +
+              sample_offset * 4;
+          long long data_len =
+              (long long)(batch_last - batch_first + 1) * CDIO_CD_FRAMESIZE_RAW;
+          int16_t *carry = offset_buffer_used ? offset_buffer : NULL;
+
+          if (two_pass && checksum_db_name &&
+              (known = checksum_db_find(sectorlen, &w->sum)) != NULL) {
+            report("\nMatches %s in the checksum database; "
+                   "not reading it again.",
+                   known[0] ? known : "a track");
+          } else if (two_pass) {
+            rewritten = two_pass_fixup(w, out, data_start, data_begin,
+                                       data_len, carry, batch_last + 1);
+          }
+          if (defer_retries && rewritten >= 0 && !w->skipped_flag) {
+            int n = defer_fixup(w, out, data_start, data_begin, data_len,
+                                carry, batch_last + 1);
+            rewritten = n < 0 ? n : rewritten + n;
+          }
+          if (rewritten < 0) {
+            report("Error writing output: %s", strerror(errno));
+            buffering_close(out);
+            return 1;
+          }
+        }
+
         callback(cursor * (CDIO_CD_FRAMESIZE_RAW / 2) - 1,
                  PARANOIA_CB_FINISHED);
-        buffering_close(out);
-        if (skipped_flag) {
+        {
+          long long start = now_us();
+          buffering_close(out);
+          w->write_us += now_us() - start;
+        }
+        if (w->summing && !w->skipped_flag)
+          finish_checksums(w, outfile_name, data_start, sectorlen, rewritten);
+        w->summing = 0;
+        if (w->skipped_flag) {
           /* remove the file */
           report("\nRemoving aborted file: %s", outfile_name);
           unlink(outfile_name);
@@ -1612,12 +1984,537 @@ int main(int argc, char *argv[]) {
         report("\n");
       }
 
+      save_stats(w);
       paranoia_free(p);
-      p = NULL;
+      w->p = NULL;
     }
   }
 
-  report("Done.\n\n");
-
   return 0;
 }
+
+/* For the -l log: how long the drive's read commands took, by kind,
+   so that a drive with a slow tail shows up even when the average
+   looks fine. */
+static void log_latency(rip_worker_t *w) {
+  static const char *names[CDDA_LATENCY_SERIES] = {"seek", "sequential",
+                                                   "retry"};
+  cdda_latency_t l;
+  cdda_range_t trouble[32];
+  long n[CDDA_LATENCY_SERIES];
+  int s, b, n_trouble;
+
+  cdda_latency(w->d, &l);
+  report_lock();
+  fprintf(logfile, "%sDrive read latency, microseconds:\n%s  %-17s", w->tag,
+          w->tag, "");
+  for (s = 0; s < CDDA_LATENCY_SERIES; s++) {
+    fprintf(logfile, " %10s", names[s]);
+    n[s] = 0;
+    for (b = 0; b < CDDA_LATENCY_BUCKETS; b++)
+      n[s] += l.count[s][b];
+  }
+  fprintf(logfile, "\n");
+
+  for (b = 0; b < CDDA_LATENCY_BUCKETS; b++) {
+    char range[32];
+
+    if (!l.count[0][b] && !l.count[1][b] && !l.count[2][b])
+      continue;
+    if (b == CDDA_LATENCY_BUCKETS - 1)
+      snprintf(range, sizeof(range), ">= %ld", 1L << (b - 1));
+    else if (b < 2)
+      snprintf(range, sizeof(range), "%d", b);
+    else
+      snprintf(range, sizeof(range), "%ld-%ld", 1L << (b - 1), (1L << b) - 1);
+    fprintf(logfile, "%s  %-17s", w->tag, range);
+    for (s = 0; s < CDDA_LATENCY_SERIES; s++)
+      fprintf(logfile, " %10ld", l.count[s][b]);
+    fprintf(logfile, "\n");
+  }
+
+  fprintf(logfile, "%s  %-17s", w->tag, "reads");
+  for (s = 0; s < CDDA_LATENCY_SERIES; s++)
+    fprintf(logfile, " %10ld", n[s]);
+  fprintf(logfile, "\n%s  %-17s", w->tag, "mean");
+  for (s = 0; s < CDDA_LATENCY_SERIES; s++)
+    fprintf(logfile, " %10lld", n[s] ? l.total_us[s] / n[s] : 0);
+  fprintf(logfile, "\n%s  %-17s", w->tag, "max");
+  for (s = 0; s < CDDA_LATENCY_SERIES; s++)
+    fprintf(logfile, " %10ld", l.max_us[s]);
+  fprintf(logfile, "\n%s  %ld retries, %ld with fewer sectors\n", w->tag,
+          l.retries, l.reductions);
+
+  n_trouble = cdda_trouble(w->d, trouble, 32);
+  for (s = 0; s < n_trouble && s < 32; s++)
+    fprintf(logfile, "%s  trouble at sectors %ld-%ld, read %ld at a time\n",
+            w->tag, (long) trouble[s].begin, (long) trouble[s].end - 1,
+            trouble[s].sectors);
+  fprintf(logfile, "\n");
+  fflush(logfile);
+  report_unlock();
+}
+
+/* Remember what this rip learned about the drive model for next time.
+   The overlap and drift paranoia settled on only mean something if it
+   was verifying, and the cache model if it was following the drive. */
+static void save_profile(rip_worker_t *w) {
+  cdda_profile_t *prof = cdda_profile(w->d);
+
+  if (w->have_stats && (paranoia_mode & PARANOIA_MODE_VERIFY)) {
+    prof->dynoverlap = w->stats.dynoverlap;
+    prof->dyndrift = w->stats.dyndrift;
+  }
+  if (w->have_stats && adapt_cache)
+    prof->cache_sectors = w->stats.cache_model;
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&profile_mutex);
+#endif
+  if (cdda_profile_save(w->d))
+    report("Cannot save drive profile to %s: %s", profile_db_name,
+           strerror(errno));
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&profile_mutex);
+#endif
+}
+
+/* Run one worker to completion on the calling thread, releasing its
+   drive afterwards so other drives' rips are unaffected. */
+static void *rip_worker(void *arg) {
+  rip_worker_t *w = arg;
+
+#ifdef HAVE_PTHREAD
+  pthread_setspecific(worker_key, w);
+#else
+  running = w;
+#endif
+  report_set_tag(w->tag);
+
+  w->start_us = now_us();
+  w->wall_us = -1;
+  w->status = rip_drive(w);
+  w->wall_us = now_us() - w->start_us;
+
+  if (w->p) {
+    save_stats(w);
+    paranoia_free(w->p);
+    w->p = NULL;
+  }
+  if (w->d) {
+    if (logfile != NULL && !query_only)
+      log_latency(w);
+    if (cdda_profile(w->d))
+      save_profile(w);
+    cdda_close(w->d);
+    w->d = NULL;
+  }
+  report_set_tag(NULL);
+  return NULL;
+}
+
+int main(int argc, char *argv[]) {
+  char *logfile_name = NULL;
+  int status = 0;
+  int i;
+
+  int c, long_option_index;
+
+  atexit(cleanup);
+#ifdef HAVE_PTHREAD
+  pthread_key_create(&worker_key, NULL);
+#endif
+
+  while ((c = getopt_long(argc, argv, optstring, options,
+                          &long_option_index)) != EOF) {
+    switch (c) {
+    case 'a':
+      output_type = 2;
+      output_endian = 1;
+      break;
+    case 'B':
+      batch = 1;
+      break;
+    case 'c':
+      force_cdrom_endian = 0;
+      break;
+    case 'C':
+      force_cdrom_endian = 1;
+      break;
+    case 'e':
+      callscript = 1;
+      fprintf(stderr,
+              "Sending all callback output to stderr for wrapper script\n");
+      break;
+    case 'f':
+      output_type = 3;
+      output_endian = 1;
+      break;
+    case 'F':
+      paranoia_mode &= ~(PARANOIA_MODE_FRAGMENT);
+      break;
+    case 'g':
+    case 'k':
+    case 'd':
+      add_device(optarg);
+      break;
+    case 'h':
+      usage(stdout);
+      exit(0);
+    case 'l':
+      if (logfile_name)
+        free(logfile_name);
+      logfile_name = NULL;
+      if (optarg)
+        logfile_name = strdup(optarg);
+      logfile_open = 1;
+      break;
+    case 'L':
+      if (reportfile_name)
+        free(reportfile_name);
+      reportfile_name = NULL;
+      if (optarg)
+        reportfile_name = strdup(optarg);
+      reportfile_open = 1;
+      break;
+    case 'M':
+      multi_drive = 1;
+      break;
+    case OPT_STATS_JSON:
+      free(stats_json_name);
+      stats_json_name = strdup(optarg);
+      break;
+    case OPT_ADAPT_CACHE:
+      adapt_cache = 1;
+      break;
+    case OPT_C2:
+      use_c2 = 1;
+      break;
+    case OPT_TWO_PASS:
+      two_pass = 1;
+      break;
+    case OPT_DEFER:
+      if (optarg)
+        get_int_arg(c, &defer_retries);
+      else
+        defer_retries = DEFER_RETRIES;
+      if (defer_retries < 0)
+        defer_retries = 0;
+      break;
+    case OPT_CHECKSUMS:
+      show_checksums = 1;
+      break;
+    case OPT_CHECKSUM_DB:
+      free(checksum_db_name);
+      checksum_db_name = strdup(optarg);
+      /* a match lets the second pass be skipped */
+      two_pass = 1;
+      break;
+    case OPT_PROFILE_DB:
+      free(profile_db_name);
+      profile_db_name = strdup(optarg);
+      break;
+    case 'm': {
+      long int mmc_timeout_sec;
+      if (get_int_arg(c, &mmc_timeout_sec)) {
+        mmc_timeout_ms = 1000 * mmc_timeout_sec;
+      }
+    } break;
+    case 'n':
+      get_int_arg(c, &force_cdrom_sectors);
+      break;
+    case 'o':
+      get_int_arg(c, &force_cdrom_overlap);
+      break;
+    case 'O':
+      get_int_arg(c, &sample_offset_arg);
+      sample_offset_given = 1;
+      break;
+    case 'p':
+      output_type = 0;
+      output_endian = -1;
+      break;
+    case 'r':
+      output_type = 0;
+      output_endian = 0;
+      break;
+    case 'q':
+      verbose = CDDA_MESSAGE_FORGETIT;
+      quiet = 1;
+      break;
+    case 'Q':
+      query_only = 1;
+      break;
+    case 'R':
+      output_type = 0;
+      output_endian = 1;
+      break;
+    case 'S':
+      get_int_arg(c, &force_cdrom_speed);
+      break;
+    case 't':
+      get_int_arg(c, &toc_offset_arg);
+      break;
+    case 'T':
+      toc_bias = -1;
+      break;
+    case 'v':
+      verbose = CDDA_MESSAGE_PRINTIT;
+      quiet = 0;
+      break;
+    case 'V':
+      fprintf(stderr, PARANOIA_VERSION);
+      fprintf(stderr, "\n");
+      exit(0);
+      break;
+    case 'w':
+      output_type = 1;
+      output_endian = 0;
+      break;
+    case 'W':
+      paranoia_mode &= ~PARANOIA_MODE_REPAIR;
+      break;
+    case 'x':
+      get_int_arg(c, &test_flags);
+      break;
+    case 'X':
+      /*paranoia_mode&=~(PARANOIA_MODE_SCRATCH|PARANOIA_MODE_REPAIR);*/
+      abort_on_skip = 1;
+      break;
+    case 'Y':
+      paranoia_mode |= PARANOIA_MODE_OVERLAP; /* cdda2wav style overlap
+                                                  check only */
+      paranoia_mode &= ~PARANOIA_MODE_VERIFY;
+      break;
+    case 'Z':
+      paranoia_mode = PARANOIA_MODE_DISABLE;
+      break;
+    case 'A':
+      run_cache_test = 1;
+      query_only = 1;
+      reportfile_open = 1;
+      verbose = CDDA_MESSAGE_PRINTIT;
+      break;
+    case 'z':
+      if (optarg) {
+        get_int_arg(c, &max_retries);
+        paranoia_mode &= ~PARANOIA_MODE_NEVERSKIP;
+      } else {
+        paranoia_mode |= PARANOIA_MODE_NEVERSKIP;
+      }
+      break;
+    case 'E':
+      force_overread = 1;
+      break;
+    default:
+      usage(stderr);
+      exit(1);
+    }
+  }
+
+  if (logfile_open) {
+    if (logfile_name == NULL)
+      logfile_name = strdup("cdparanoia.log");
+    if (!strcmp(logfile_name, "-")) {
+      logfile = stdout;
+      logfile_open = 0;
+    } else {
+      logfile = fopen(logfile_name, "w");
+      if (logfile == NULL) {
+        report("Cannot open log summary file %s: %s", logfile_name,
+               strerror(errno));
+        exit(1);
+      }
+    }
+  }
+  if (reportfile_open) {
+    if (reportfile_name == NULL)
+      reportfile_name = strdup("cdparanoia.log");
+    if (!strcmp(reportfile_name, "-")) {
+      reportfile = stdout;
+      reportfile_open = 0;
+    } else {
+      if (logfile_name && !strcmp(reportfile_name, logfile_name)) {
+        reportfile = logfile;
+        reportfile_open = 0;
+      } else {
+        reportfile = fopen(reportfile_name, "w");
+        if (reportfile == NULL) {
+          report("Cannot open debug log file %s: %s", reportfile_name,
+                 strerror(errno));
+          exit(1);
+        }
+      }
+    }
+  }
+
+  if (logfile) {
+    /* log command line and version */
+    for (i = 0; i < argc; i++)
+      fprintf(logfile, "%s ", argv[i]);
+    fprintf(logfile, "\n");
+
+    if (reportfile != logfile) {
+      fprintf(logfile, VERSION);
+      fprintf(logfile, "\n");
+      fprintf(logfile, "Using cdda library version: %s\n", cdda_version());
+      fprintf(logfile, "Using paranoia library version: %s\n",
+              paranoia_version());
+    }
+    fflush(logfile);
+  }
+
+  if (reportfile && reportfile != logfile) {
+    /* log command line */
+    for (i = 0; i < argc; i++)
+      fprintf(reportfile, "%s ", argv[i]);
+    fprintf(reportfile, "\n");
+    fflush(reportfile);
+  }
+
+  if (!multi_drive)
+    while (ndevices > 1) {
+      fprintf(stderr,
+              "Multiple cdrom devices given. Previous device %s ignored\n",
+              devices[0]);
+      free(devices[0]);
+      memmove(devices, devices + 1, --ndevices * sizeof(char *));
+    }
+
+  if (force_cdrom_sectors != -1 &&
+      (force_cdrom_sectors < 0 || force_cdrom_sectors > 100)) {
+    report("Default sector read size must be 1<= n <= 100\n");
+    exit(1);
+  }
+  if (force_cdrom_overlap != -1 &&
+      (force_cdrom_overlap < 0 ||
+       force_cdrom_overlap > CDIO_CD_FRAMES_PER_SEC)) {
+    report("Search overlap sectors must be 0<= n <=75\n");
+    exit(1);
+  }
+  if (force_cdrom_speed == 0)
+    force_cdrom_speed = -1;
+
+  if (checksum_db_name && checksum_db_load(checksum_db_name)) {
+    report("Cannot read checksum database %s: %s", checksum_db_name,
+           strerror(errno));
+    exit(1);
+  }
+
+  if (optind >= argc && !query_only) {
+    if (batch)
+      span_arg = NULL;
+    else {
+      /* D'oh.  No span. Fetch me a brain, Igor. */
+      usage(stderr);
+      exit(1);
+    }
+  } else if (argv[optind]) {
+    span_arg = strdup(argv[optind]);
+    if (optind + 1 < argc)
+      outfile_arg = argv[optind + 1];
+  }
+
+  printit = isatty(STDERR_FILENO) || (logfile != NULL);
+
+  report(PARANOIA_VERSION);
+  if (verbose) {
+    report("Using cdda library version: %s", cdda_version());
+    report("Using paranoia library version: %s", paranoia_version());
+  }
+
+  if (multi_drive && ndevices == 0) {
+    /* rip every drive that has an audio CD in it */
+    driver_id_t driver_id;
+    char **ppsz_cd_drives =
+        cdio_get_devices_with_cap_ret(NULL, CDIO_FS_AUDIO, false, &driver_id);
+    char **ppsz;
+
+    for (ppsz = ppsz_cd_drives; ppsz && *ppsz; ppsz++)
+      add_device(*ppsz);
+    cdio_free_device_list(ppsz_cd_drives);
+
+    if (ndevices == 0) {
+      report("\nUnable find or access a CD-ROM drive with an audio CD"
+             " in it.");
+      exit(1);
+    }
+  }
+
+  nworkers = ndevices ? ndevices : 1;
+  workers = calloc(nworkers, sizeof(rip_worker_t));
+  if (workers == NULL) {
+    report("Out of memory");
+    exit(1);
+  }
+  for (i = 0; i < nworkers; i++) {
+    rip_worker_t *w = &workers[i];
+    w->device = ndevices ? devices[i] : NULL;
+    w->span = span_arg ? strdup(span_arg) : NULL;
+    memset(w->dispcache, ' ', sizeof(w->dispcache) - 1);
+    w->heartbeat = ' ';
+    if (multi_drive)
+      name_worker(w, i);
+  }
+
+  if (nworkers > 1 && outfile_arg && !strcmp(outfile_arg, "-")) {
+    report("Several drives can't all be output to stdout.");
+    exit(1);
+  }
+
+  /* Open every drive before giving up privileges; a drive that can't
+     be used is only fatal when it is the only one. */
+  for (i = 0; i < nworkers; i++) {
+    rip_worker_t *w = &workers[i];
+    report_set_tag(w->tag);
+    if (open_drive(w)) {
+      w->status = 1;
+      if (w->d) {
+        cdda_close(w->d);
+        w->d = NULL;
+      }
+      if (nworkers == 1)
+        exit(1);
+    }
+  }
+  report_set_tag(NULL);
+
+  {
+    /* this is probably a good idea in general */
+#if defined(HAVE_GETUID) && (defined(HAVE_SETEUID) || defined(HAVE_SETEGID))
+    int dummy __attribute__((unused));
+#endif
+#if defined(HAVE_GETUID) && defined(HAVE_SETEUID)
+    dummy = seteuid(getuid());
+#endif
+#if defined(HAVE_GETGID) && defined(HAVE_SETEGID)
+    dummy = setegid(getgid());
+#endif
+  }
+
+#ifdef HAVE_PTHREAD
+  if (nworkers > 1) {
+    for (i = 0; i < nworkers; i++) {
+      rip_worker_t *w = &workers[i];
+      if (w->d && pthread_create(&w->thread, NULL, rip_worker, w) == 0)
+        w->threaded = 1;
+    }
+    for (i = 0; i < nworkers; i++)
+      if (workers[i].threaded)
+        pthread_join(workers[i].thread, NULL);
+  }
+#endif
+
+  /* Without threads, or where a thread couldn't be started, drives are
+     ripped one after another. */
+  for (i = 0; i < nworkers; i++) {
+    if (workers[i].d)
+      rip_worker(&workers[i]);
+    if (workers[i].status > status)
+      status = workers[i].status;
+  }
+
+  if (status == 0 && !query_only)
+    report("Done.\n\n");
+
+  return status;
+}
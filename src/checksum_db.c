@@ -0,0 +1,147 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+*/
+
+/******************************************************************
+ *
+ * Known-good track checksums for --checksum-db
+ *
+ * One track per line: its length in sectors, then its CRC-32 and
+ * AccurateRip v1 and v2 checksums in hex, then optionally '#' and a
+ * name.  Blank lines and lines starting with '#' are ignored.  Tracks
+ * are only ever appended, so the file can be shared, concatenated or
+ * edited by hand.
+ *
+ ******************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+# define __CDIO_CONFIG_H__ 1
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cdio/paranoia/cdda.h>
+#include <cdio/paranoia/paranoia.h>
+
+#include "checksum_db.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+/* drives finishing together may look up and add tracks at once */
+static pthread_mutex_t db_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define db_lock() pthread_mutex_lock(&db_mutex)
+#define db_unlock() pthread_mutex_unlock(&db_mutex)
+#else
+#define db_lock()
+#define db_unlock()
+#endif
+
+typedef struct db_entry {
+  long sectors;
+  uint32_t crc32;
+  uint32_t ar_v1;
+  uint32_t ar_v2;
+  char *name; /* never NULL */
+} db_entry_t;
+
+static char *db_path = NULL;
+static db_entry_t *db = NULL;
+static long db_n = 0;
+static long db_alloc = 0;
+
+static int db_insert(long sectors, uint32_t crc32, uint32_t ar_v1,
+                     uint32_t ar_v2, const char *name) {
+  db_entry_t *e;
+
+  if (db_n == db_alloc) {
+    long alloc = db_alloc ? db_alloc * 2 : 64;
+    db_entry_t *grown = realloc(db, alloc * sizeof(*db));
+    if (!grown)
+      return -1;
+    db = grown;
+    db_alloc = alloc;
+  }
+  e = &db[db_n];
+  e->sectors = sectors;
+  e->crc32 = crc32;
+  e->ar_v1 = ar_v1;
+  e->ar_v2 = ar_v2;
+  e->name = strdup(name);
+  if (!e->name)
+    return -1;
+  db_n++;
+  return 0;
+}
+
+int checksum_db_load(const char *path) {
+  static char empty[] = "";
+  char line[1024];
+  FILE *f;
+
+  free(db_path);
+  db_path = strdup(path);
+  if (!db_path)
+    return -1;
+
+  f = fopen(path, "r");
+  if (!f)
+    return errno == ENOENT ? 0 : -1;
+
+  while (fgets(line, sizeof(line), f)) {
+    char *name = strchr(line, '#');
+    unsigned long crc32, ar_v1, ar_v2;
+    long sectors;
+
+    if (name) {
+      *name++ = '\0';
+      name += strspn(name, " \t");
+      name[strcspn(name, "\r\n")] = '\0';
+    } else
+      name = empty;
+    if (sscanf(line, "%ld %lx %lx %lx", &sectors, &crc32, &ar_v1, &ar_v2) !=
+        4)
+      continue;
+    if (db_insert(sectors, crc32, ar_v1, ar_v2, name)) {
+      fclose(f);
+      return -1;
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+const char *checksum_db_find(long sectors, const paranoia_checksum_t *c) {
+  const char *found = NULL;
+  long i;
+
+  db_lock();
+  for (i = 0; i < db_n && !found; i++)
+    if (db[i].sectors == sectors && db[i].crc32 == c->crc32 &&
+        db[i].ar_v1 == c->ar_v1 && db[i].ar_v2 == c->ar_v2)
+      found = db[i].name;
+  db_unlock();
+  return found;
+}
+
+int checksum_db_add(long sectors, const paranoia_checksum_t *c,
+                    const char *name) {
+  int ret = -1;
+  FILE *f;
+
+  db_lock();
+  if (!db_path) {
+    errno = EINVAL;
+  } else if ((f = fopen(db_path, "a"))) {
+    fprintf(f, "%ld %08lx %08lx %08lx # %s\n", sectors,
+            (unsigned long)c->crc32, (unsigned long)c->ar_v1,
+            (unsigned long)c->ar_v2, name);
+    if (fclose(f) == 0)
+      ret = db_insert(sectors, c->crc32, c->ar_v1, c->ar_v2, name);
+  }
+  db_unlock();
+  return ret;
+}
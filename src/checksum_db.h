@@ -0,0 +1,26 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+*/
+
+/** checksum_db_load() - read the known-good track checksums in file
+ * (path).  A file that doesn't exist yet is an empty database.
+ * Returns 0, or -1 with errno set.
+ *
+ */
+extern int checksum_db_load(const char *path);
+
+/** checksum_db_find() - is a track of (sectors) sectors with checksums
+ * (c) in the database?  Returns the name it was added under ("" if
+ * none), or NULL.
+ *
+ */
+extern const char *checksum_db_find(long sectors,
+                                    const paranoia_checksum_t *c);
+
+/** checksum_db_add() - add a track to the database and append it to
+ * its file, with (name) as a comment.  Returns 0, or -1 with errno
+ * set.
+ *
+ */
+extern int checksum_db_add(long sectors, const paranoia_checksum_t *c,
+                           const char *name);
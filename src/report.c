@@ -24,3 +24,39 @@
 int quiet = 0;
 int verbose = CDDA_MESSAGE_FORGETIT;
 FILE *reportfile = NULL;
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+
+static pthread_mutex_t report_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t report_key;
+static pthread_once_t report_key_once = PTHREAD_ONCE_INIT;
+
+static void report_key_init(void) { pthread_key_create(&report_key, NULL); }
+
+void report_lock(void) { pthread_mutex_lock(&report_mutex); }
+
+void report_unlock(void) { pthread_mutex_unlock(&report_mutex); }
+
+const char *report_tag(void) {
+  const char *tag;
+  pthread_once(&report_key_once, report_key_init);
+  tag = pthread_getspecific(report_key);
+  return tag ? tag : "";
+}
+
+void report_set_tag(const char *tag) {
+  pthread_once(&report_key_once, report_key_init);
+  pthread_setspecific(report_key, tag);
+}
+#else
+static const char *report_current_tag = "";
+
+void report_lock(void) {}
+
+void report_unlock(void) {}
+
+const char *report_tag(void) { return report_current_tag; }
+
+void report_set_tag(const char *tag) { report_current_tag = tag ? tag : ""; }
+#endif
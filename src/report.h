@@ -6,35 +6,55 @@ extern int verbose;
 extern int quiet;
 extern FILE *reportfile;
 
+/* Serialize output when several drives are being ripped at once.
+   Without threads these do nothing. */
+extern void report_lock(void);
+extern void report_unlock(void);
+
+/* Prefix put in front of report() lines from the calling thread,
+   e.g. "[sr0] " when ripping several drives; "" otherwise. */
+extern const char *report_tag(void);
+extern void report_set_tag(const char *tag);
+
 #define report(...)                                                            \
   {                                                                            \
+    report_lock();                                                             \
     if (!quiet) {                                                              \
+      fputs(report_tag(), stderr);                                             \
       fprintf(stderr, __VA_ARGS__);                                            \
       fputc('\n', stderr);                                                     \
     }                                                                          \
     if (reportfile) {                                                          \
+      fputs(report_tag(), reportfile);                                         \
       fprintf(reportfile, __VA_ARGS__);                                        \
       fputc('\n', reportfile);                                                 \
     }                                                                          \
+    report_unlock();                                                           \
   }
 #define reportC(...)                                                           \
   {                                                                            \
+    report_lock();                                                             \
     if (!quiet) {                                                              \
       fprintf(stderr, __VA_ARGS__);                                            \
     }                                                                          \
     if (reportfile) {                                                          \
       fprintf(reportfile, __VA_ARGS__);                                        \
     }                                                                          \
+    report_unlock();                                                           \
   }
 #define printC(...)                                                            \
   {                                                                            \
+    report_lock();                                                             \
     if (!quiet) {                                                              \
       fprintf(stderr, __VA_ARGS__);                                            \
     }                                                                          \
+    report_unlock();                                                           \
   }
 #define logC(...)                                                              \
   {                                                                            \
+    report_lock();                                                             \
     if (reportfile) {                                                          \
       fprintf(reportfile, __VA_ARGS__);                                        \
     }                                                                          \
+    report_unlock();                                                           \
   }
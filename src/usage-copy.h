@@ -27,6 +27,30 @@ const char usage_help[] =
     "  -L --log-debug           <file> : save detailed device autosense and\n"
     "                                    debugging output to file\n"
     "                                    stderr (for wrapper scripts)\n"
+    "     --stats-json          <file> : at exit, save read statistics and the\n"
+    "                                    time spent reading, verifying and\n"
+    "                                    writing to file as JSON, one line\n"
+    "                                    per drive\n"
+    "     --adapt-cache                : size the drive cache model from seek\n"
+    "                                    timings while ripping\n"
+    "     --c2                         : trust the drive's C2 error pointers\n"
+    "                                    and read clean sectors only once\n"
+    "     --two-pass                   : read without verifying, then again,\n"
+    "                                    and rip only what differs with\n"
+    "                                    paranoia\n"
+    "     --checksums                  : report the CRC-32 and AccurateRip\n"
+    "                                    checksums of each file\n"
+    "     --checksum-db         <file> : keep checksums of good rips in file;\n"
+    "                                    implies --two-pass, and a first\n"
+    "                                    read matching one is kept without\n"
+    "                                    reading it again\n"
+    "     --defer[=n]                  : after n reads (default 5) without\n"
+    "                                    progress, put a place off and rip\n"
+    "                                    it at the end of the file, slowed\n"
+    "                                    down\n"
+    "     --profile-db          <file> : remember what was learned about each\n"
+    "                                    drive model in file, and start from\n"
+    "                                    it next time\n"
     "  -V --version                    : print version info and quit\n"
     "  -Q --query                      : autosense drive, query disc and quit\n"
     "  -B --batch                      : 'batch' mode (saves each track to a\n"
@@ -56,6 +80,10 @@ const char usage_help[] =
     "                                    compatibility.\n"
     "  -g --force-generic-device <dev> : really an alias for -d. Kept for \n"
     "                                    compatibility.\n"
+    "  -M --multi-drive                : rip every drive given with -d at\n"
+    "                                    once, or every drive holding an\n"
+    "                                    audio CD if none is given.  Output\n"
+    "                                    names get the device name prefixed\n"
     "  -S --force-read-speed <n>       : read from device at specified speed; "
     "by\n"
     "                                    default, cdparanoia sets drive to "
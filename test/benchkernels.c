@@ -0,0 +1,622 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Microbenchmark for the paranoia matching kernels, run by
+   "make bench-kernels".
+
+   The kernels are timed on their own, outside of any rip, against a
+   vector A and a second "read" B of the same audio:
+
+     sort_setup     index A (sort_setup() plus the sort_getmatch()
+                    that builds it); a sample is one sample indexed
+     sort_getmatch  look up a sample of B in A's index within the
+                    jitter window and walk every candidate with
+                    sort_nextmatch(); a sample is one candidate
+     overlap        i_paranoia_overlap() from a known matching pair;
+     overlap2       i_paranoia_overlap2(), likewise with read flags;
+                    a sample is one sample of the run found
+     rift_f         i_analyze_rift_f() and i_analyze_rift_r() on a
+     rift_r         rift of dropped, repeated or garbled samples; a
+                    sample is one sample of rift
+     stutter_or_gap i_stutter_or_gap() on the same rifts
+
+   The audio is digital silence, loud (clipped) synthetic music, or
+   the real music in test/data/cdda.bin.  B is either an exact copy
+   of A or a heavily jittered read of it: fragments of one to four
+   sectors, each displaced by up to two sectors.  The overlap kernels
+   are timed with every match kernel set the CPU supports.
+
+   Each measurement prints one line of JSON with the ns per call and
+   ns per sample, and where Linux perf counters can be opened, the
+   cache misses per call; otherwise that field is -1.
+
+   The library sources are compiled in directly, since the kernels
+   are internal to it. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+# define __CDIO_CONFIG_H__ 1
+#endif
+
+#include "../lib/paranoia/gap.c"
+#include "../lib/paranoia/isort.c"
+#include "../lib/paranoia/match.c"
+#include "../lib/paranoia/overlap.c"
+#include "../lib/paranoia/p_block.c"
+#include "../lib/paranoia/reader.c"
+#include "../lib/paranoia/paranoia.c"
+#include "../lib/paranoia/crc32.c"
+#include "../lib/paranoia/twopass.c"
+
+#include <stdio.h>
+#include <time.h>
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef DATA_DIR
+#define DATA_DIR "./data"
+#endif
+
+#define SECTOR_WORDS (CD_FRAMEWORDS)
+#define JITTER_WORDS (2 * SECTOR_WORDS)
+#define NRIFTS 64
+#define RIFT_WINDOW 4096
+
+static long nwords = 16 * SECTOR_WORDS;
+static double min_seconds = 0.2;
+#ifdef HAVE_LINUX_PERF_EVENT_H
+static int perf_fd = -1;
+#endif
+
+/* One rift for the gap kernels: A and B agree up to (at), and again
+   from (gap) samples past it with B shifted by (shift).  (fa, fb) is
+   the first sample that differs scanning forward, (ra, rb) the first
+   scanning back from the end. */
+typedef struct {
+  int16_t a[RIFT_WINDOW], b[RIFT_WINDOW];
+  long sizeA, sizeB;
+  long at, gap, shift;
+  long fa, fb, ra, rb;
+} rift_t;
+
+/* Everything one scenario times. */
+typedef struct {
+  const char *input;
+  const char *jitter;
+  int16_t *a, *b;
+  unsigned char *flagsA, *flagsB;
+  long *offset;        /* B[j] is A[j + offset[j]] */
+  long sizeB;
+  rift_t *rifts;
+} scenario_t;
+
+static unsigned long long rng_state = 0x9e3779b97f4a7c15ULL;
+
+static unsigned long
+rnd(void)
+{
+  unsigned long long z = (rng_state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return (unsigned long)((z ^ (z >> 31)) & 0x7fffffff);
+}
+
+static long
+rnd_range(long lo, long hi)
+{
+  return lo + (long)(rnd() % (unsigned long)(hi - lo + 1));
+}
+
+static double
+now(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+#endif
+}
+
+/**** Cache-miss counter *************************************************/
+
+static void
+perf_open(void)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  perf_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+static void
+perf_start(void)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  if (perf_fd >= 0) {
+    ioctl(perf_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+static long long
+perf_stop(void)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  long long count;
+
+  if (perf_fd >= 0) {
+    ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(perf_fd, &count, sizeof(count)) == sizeof(count))
+      return count;
+  }
+#endif
+  return -1;
+}
+
+/**** Inputs **************************************************************/
+
+static void
+fill_silence(int16_t *v, long n)
+{
+  memset(v, 0, n * sizeof(*v));
+}
+
+/* Heavily compressed pop: a few loud partials (triangle waves, so no
+   libm is needed), noise, and clipping. */
+static long
+triangle(long t, long period)
+{
+  long phase = t % period;
+  return (phase < period / 2 ? 4 * phase : 4 * (period - phase)) * 32767
+    / period - 32767;
+}
+
+static void
+fill_loud(int16_t *v, long n)
+{
+  long i;
+  for (i = 0; i < n; i += 2) {
+    long t = i / 2;
+    long x = triangle(t, 802) * 9 / 10 + triangle(t, 200) * 6 / 10
+      + triangle(t, 25) * 4 / 10 + (long)(rnd() % 19661) - 9830;
+    if (x > 32767)
+      x = 32767;
+    if (x < -32768)
+      x = -32768;
+    v[i] = x;
+    v[i + 1] = -x / 2;
+  }
+}
+
+/* The start of the test disc, where its one sound is; the rest of it
+   is silence.  cdda.bin is little-endian. */
+static int
+fill_real(int16_t *v, long n)
+{
+  FILE *f = fopen(DATA_DIR "/cdda.bin", "rb");
+  unsigned char *raw = malloc(n * 2);
+  long i, got = 0;
+
+  if (f) {
+    got = fread(raw, 2, n, f);
+    fclose(f);
+  }
+  for (i = 0; i < got; i++)
+    v[i] = (int16_t)(raw[2 * i] | (raw[2 * i + 1] << 8));
+  free(raw);
+  return got == n;
+}
+
+/* Read A back as B: an exact copy, or fragments of one to four
+   sectors each displaced by up to JITTER_WORDS, with the edges of
+   each fragment flagged the way the reader flags read boundaries. */
+static void
+make_read(scenario_t *s, int jitter)
+{
+  long j = 0;
+
+  memset(s->flagsA, 0, nwords);
+  memset(s->flagsB, 0, nwords);
+  for (j = 0; j < nwords; j += 4 * SECTOR_WORDS) {
+    s->flagsA[j] |= FLAGS_EDGE;
+    s->flagsA[min(j + 4 * SECTOR_WORDS, nwords) - 1] |= FLAGS_EDGE;
+  }
+
+  j = 0;
+  while (j < nwords) {
+    long len = jitter ? rnd_range(SECTOR_WORDS, 4 * SECTOR_WORDS) : nwords;
+    long off = jitter ? rnd_range(-JITTER_WORDS / 2, JITTER_WORDS / 2) * 2 : 0;
+    long k;
+
+    len = min(len, nwords - j);
+    for (k = j; k < j + len; k++) {
+      long src = max(0, min(nwords - 1, k + off));
+      s->b[k] = s->a[src];
+      s->offset[k] = src - k;
+    }
+    s->flagsB[j] |= FLAGS_EDGE;
+    s->flagsB[j + len - 1] |= FLAGS_EDGE;
+    j += len;
+  }
+  s->sizeB = nwords;
+}
+
+/* Rifts: B drops (gap) samples of A, repeats them, or garbles them. */
+static void
+make_rifts(scenario_t *s)
+{
+  int r;
+
+  for (r = 0; r < NRIFTS; r++) {
+    rift_t *rf = &s->rifts[r];
+    long base = rnd_range(0, nwords - RIFT_WINDOW - 1);
+    long gap = rnd_range(1, 256);
+    long at = rnd_range(RIFT_WINDOW / 4, RIFT_WINDOW / 2);
+    long k, a, b;
+
+    memcpy(rf->a, s->a + base, sizeof(rf->a));
+    memcpy(rf->b, rf->a, at * sizeof(int16_t));
+    switch (r % 3) {
+    case 0: /* B dropped samples */
+      memcpy(rf->b + at, rf->a + at + gap,
+             (RIFT_WINDOW - at - gap) * sizeof(int16_t));
+      rf->sizeB = RIFT_WINDOW - gap;
+      rf->shift = gap;
+      break;
+    case 1: /* B stuttered */
+      memcpy(rf->b + at, rf->a + at - gap,
+             (RIFT_WINDOW - at) * sizeof(int16_t));
+      rf->sizeB = RIFT_WINDOW;
+      rf->shift = -gap;
+      break;
+    default: /* B garbled */
+      memcpy(rf->b + at, rf->a + at, (RIFT_WINDOW - at) * sizeof(int16_t));
+      for (k = at; k < at + gap; k++)
+        rf->b[k] = rf->a[k] ^ (int16_t)(1 + rnd() % 255);
+      rf->sizeB = RIFT_WINDOW;
+      rf->shift = 0;
+      break;
+    }
+    rf->sizeA = RIFT_WINDOW;
+    rf->at = at;
+    rf->gap = gap;
+
+    /* Silence has no rift to find; the kernels then start at (at). */
+    for (a = 0; a < at + gap && rf->a[a] == rf->b[a]; a++)
+      ;
+    rf->fa = rf->fb = a < at + gap ? a : at;
+    for (a = rf->sizeA - 1, b = rf->sizeB - 1 - max(0, -rf->shift);
+         a >= 0 && b >= 0 && rf->a[a] == rf->b[b]; a--, b--)
+      ;
+    if (a < at - gap || b < 0) {
+      a = at;
+      b = at - rf->shift;
+    }
+    rf->ra = a;
+    rf->rb = b;
+  }
+}
+
+/**** Kernels *************************************************************/
+
+typedef struct {
+  scenario_t *s;
+  sort_info_t *index;
+  sort_index_t type;
+  long abspos;
+} kernel_arg_t;
+
+static volatile long sink;
+
+static long
+run_sort_setup(kernel_arg_t *k, long *calls)
+{
+  sort_setup(k->index, k->s->a, &k->abspos, nwords, 0, nwords);
+  sink += (long)sort_getmatch(k->index, 0, 0, 0);
+  *calls = 1;
+  return nwords;
+}
+
+static long
+run_sort_getmatch(kernel_arg_t *k, long *calls)
+{
+  scenario_t *s = k->s;
+  long j, found = 0;
+
+  *calls = 0;
+  for (j = 0; j < s->sizeB; j += 7) {
+    sort_link_t *ptr = sort_getmatch(k->index, j, JITTER_WORDS + 16, s->b[j]);
+    while (ptr) {
+      found++;
+      ptr = sort_nextmatch(k->index, ptr);
+    }
+    ++*calls;
+  }
+  return found;
+}
+
+static long
+run_overlap(kernel_arg_t *k, long *calls, int flags)
+{
+  scenario_t *s = k->s;
+  long j, run = 0, begin, end;
+
+  *calls = 0;
+  for (j = 0; j < s->sizeB; j += 613) {
+    long ja = j + s->offset[j];
+    if (flags)
+      run += i_paranoia_overlap2(s->a, s->b, s->flagsA, s->flagsB, ja, j,
+                                 nwords, s->sizeB, &begin, &end);
+    else
+      run += i_paranoia_overlap(s->a, s->b, ja, j, nwords, s->sizeB,
+                                &begin, &end);
+    ++*calls;
+  }
+  return run;
+}
+
+static long
+run_overlap1(kernel_arg_t *k, long *calls)
+{
+  return run_overlap(k, calls, 0);
+}
+
+static long
+run_overlap2(kernel_arg_t *k, long *calls)
+{
+  return run_overlap(k, calls, 1);
+}
+
+static long
+run_rift_f(kernel_arg_t *k, long *calls)
+{
+  long r, total = 0, mA, mB, mC;
+
+  for (r = 0; r < NRIFTS; r++) {
+    rift_t *rf = &k->s->rifts[r];
+    i_analyze_rift_f(rf->a, rf->b, rf->sizeA, rf->sizeB, rf->fa, rf->fb,
+                     &mA, &mB, &mC);
+    sink += mA + mB + mC;
+    total += rf->gap;
+  }
+  *calls = NRIFTS;
+  return total;
+}
+
+/* The same rifts seen from the far side, with A and B aligned after
+   the rift. */
+static long
+run_rift_r(kernel_arg_t *k, long *calls)
+{
+  long r, total = 0, mA, mB, mC;
+
+  for (r = 0; r < NRIFTS; r++) {
+    rift_t *rf = &k->s->rifts[r];
+    i_analyze_rift_r(rf->a, rf->b, rf->sizeA, rf->sizeB, rf->ra, rf->rb,
+                     &mA, &mB, &mC);
+    sink += mA + mB + mC;
+    total += rf->gap;
+  }
+  *calls = NRIFTS;
+  return total;
+}
+
+static long
+run_stutter_or_gap(kernel_arg_t *k, long *calls)
+{
+  long r, total = 0;
+
+  for (r = 0; r < NRIFTS; r++) {
+    rift_t *rf = &k->s->rifts[r];
+    sink += i_stutter_or_gap(rf->a, rf->b, rf->at - rf->gap, rf->at, rf->gap);
+    total += rf->gap;
+  }
+  *calls = NRIFTS;
+  return total;
+}
+
+/* Run (fn) until at least min_seconds have passed and print a line. */
+static void
+measure(const char *kernel, const char *variant, kernel_arg_t *k,
+        long (*fn)(kernel_arg_t *, long *))
+{
+  long long misses;
+  long iters = 0, calls = 0, samples = 0, c;
+  double start, elapsed;
+
+  fn(k, &c); /* warm up, and build any index the kernel reuses */
+  perf_start();
+  start = now();
+  do {
+    long n;
+    for (n = 0; n < (iters ? iters : 1); n++) {
+      samples += fn(k, &c);
+      calls += c;
+    }
+    iters += n;
+    elapsed = now() - start;
+  } while (elapsed < min_seconds);
+  misses = perf_stop();
+
+  printf("{\"kernel\": \"%s\", \"variant\": \"%s\", \"input\": \"%s\", "
+         "\"jitter\": \"%s\", \"words\": %ld, \"calls\": %ld, "
+         "\"samples\": %ld, \"seconds\": %.6f, \"ns_per_call\": %.2f, "
+         "\"ns_per_sample\": %.4f, \"cache_misses_per_call\": %.2f}\n",
+         kernel, variant, k->s->input, k->s->jitter, nwords, calls, samples,
+         elapsed, calls ? elapsed * 1e9 / calls : 0.0,
+         samples ? elapsed * 1e9 / samples : 0.0,
+         misses < 0 || !calls ? -1.0 : (double)misses / calls);
+  fflush(stdout);
+}
+
+static void
+bench_scenario(scenario_t *s)
+{
+  static const struct {
+    const char *name;
+    sort_index_t type;
+  } indexes[] = {
+    { "buckets", SORT_INDEX_BUCKETS },
+    { "sorted",  SORT_INDEX_SORTED },
+  };
+  const match_kernel_t *const *m = i_match_available();
+  const match_kernel_t *best = i_match;
+  kernel_arg_t k;
+  unsigned int t;
+
+  memset(&k, 0, sizeof(k));
+  k.s = s;
+  for (t = 0; t < sizeof(indexes) / sizeof(indexes[0]); t++) {
+    k.index = sort_alloc_type(nwords, indexes[t].type);
+    k.type = indexes[t].type;
+    measure("sort_setup", indexes[t].name, &k, run_sort_setup);
+    sort_setup(k.index, s->a, &k.abspos, nwords, 0, nwords);
+    measure("sort_getmatch", indexes[t].name, &k, run_sort_getmatch);
+    sort_free(k.index);
+    k.index = NULL;
+  }
+
+  for (; *m; m++) {
+    i_match = *m;
+    measure("overlap", (*m)->name, &k, run_overlap1);
+    measure("overlap2", (*m)->name, &k, run_overlap2);
+  }
+  i_match = best;
+
+  if (s->rifts) {
+    measure("rift_f", "", &k, run_rift_f);
+    measure("rift_r", "", &k, run_rift_r);
+    measure("stutter_or_gap", "", &k, run_stutter_or_gap);
+  }
+}
+
+static void
+usage(const char *prog)
+{
+  fprintf(stderr,
+          "Usage: %s [-n sectors] [-t seconds] [-i input] [-s seed]\n"
+          "  input is silence, loud or real and may be repeated; by\n"
+          "  default all three are run, each read back both exactly\n"
+          "  and with heavy jitter.\n", prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+  static const char *inputs[] = { "silence", "loud", "real" };
+  int want[3] = { 0, 0, 0 }, any = 0;
+  scenario_t s;
+  unsigned int in;
+  int opt, jitter;
+
+  while ((opt = getopt(argc, argv, "n:t:i:s:h")) != -1) {
+    switch (opt) {
+    case 'n': nwords = atol(optarg) * SECTOR_WORDS; break;
+    case 't': min_seconds = atof(optarg); break;
+    case 's': rng_state = strtoull(optarg, NULL, 0); break;
+    case 'i':
+      for (in = 0; in < 3; in++)
+        if (!strcmp(optarg, inputs[in]))
+          break;
+      if (in == 3) {
+        usage(argv[0]);
+        return 1;
+      }
+      want[in] = any = 1;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (nwords < 2 * RIFT_WINDOW) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  i_match_init();
+  perf_open();
+  memset(&s, 0, sizeof(s));
+  s.a = malloc(nwords * sizeof(int16_t));
+  s.b = malloc(nwords * sizeof(int16_t));
+  s.flagsA = malloc(nwords);
+  s.flagsB = malloc(nwords);
+  s.offset = malloc(nwords * sizeof(long));
+  s.rifts = malloc(NRIFTS * sizeof(rift_t));
+
+  for (in = 0; in < 3; in++) {
+    if (any && !want[in])
+      continue;
+    s.input = inputs[in];
+    if (in == 0)
+      fill_silence(s.a, nwords);
+    else if (in == 1)
+      fill_loud(s.a, nwords);
+    else if (!fill_real(s.a, nwords)) {
+      fprintf(stderr, "Unable to read %s; skipping real audio\n",
+              DATA_DIR "/cdda.bin");
+      continue;
+    }
+    for (jitter = 0; jitter < 2; jitter++) {
+      scenario_t run = s;
+      run.jitter = jitter ? "heavy" : "none";
+      make_read(&run, jitter);
+      if (jitter)
+        make_rifts(&run);
+      else
+        run.rifts = NULL;
+      bench_scenario(&run);
+    }
+  }
+
+  free(s.a);
+  free(s.b);
+  free(s.flagsA);
+  free(s.flagsB);
+  free(s.offset);
+  free(s.rifts);
+  return 0;
+}
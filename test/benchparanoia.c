@@ -0,0 +1,459 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* End-to-end throughput benchmark, run by "make bench".
+
+   Each disc image given is ripped through a simulated drive (see
+   cdio_cddap_identify_sim()) in every paranoia mode cd-paranoia
+   offers, under every jitter/fragmentation class of
+   paranoia_jitter_t.  Each combination prints one line of JSON:
+
+     image, mode, test_flags  what was ripped, and how
+     sectors, repeats         disc length, and how many rips were timed
+     wall_s, cpu_s            totals over all repeats
+     sectors_per_s            audio sectors ripped per wall second
+     cpu_s_per_disc           CPU seconds per rip
+     max_rss_kb               peak resident set size
+     reads, sectors_read      drive reads issued, sectors they returned
+     rereads                  sectors read beyond one pass over the disc
+     allocs                   malloc/calloc/realloc calls (-1: unknown)
+     bad_sectors              sectors that differ from the image
+     gave_up                  rips that ran past -T seconds and had
+                              NEVERSKIP taken away so they could finish
+     callbacks                paranoia callback counts by kind
+
+   The drive is seeded the same way for every run, so the numbers only
+   move when the code does.  Each combination runs in its own process
+   where fork() is available, so max_rss_kb is its own. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+# define __CDIO_CONFIG_H__ 1
+#endif
+
+#include <cdio/paranoia/cdda.h>
+#include <cdio/paranoia/paranoia.h>
+#include <stdio.h>
+#include <time.h>
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+
+#if defined(HAVE_WORKING_FORK) && defined(HAVE_SYS_WAIT_H)
+#define BENCH_FORK 1
+#endif
+
+/* Count allocations by standing in front of the C library's.  This
+   only works where the C library exports its own entry points. */
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static long allocs = 0;
+
+void *
+malloc(size_t size)
+{
+  allocs++;
+  return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+  allocs++;
+  return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+  allocs++;
+  return __libc_realloc(ptr, size);
+}
+#else
+static long allocs = -1;
+#endif
+
+static const struct {
+  const char *name;
+  int mode;
+} modes[] = {
+  { "disable",        PARANOIA_MODE_DISABLE },                  /* -Z */
+  { "overlap",        PARANOIA_MODE_OVERLAP },                  /* -Y */
+  { "full",           PARANOIA_MODE_FULL ^ PARANOIA_MODE_NEVERSKIP },
+  { "full-neverskip", PARANOIA_MODE_FULL },                     /* -z */
+};
+
+static const int classes[] = {
+  0,
+  CDDA_TEST_JITTER_SMALL,
+  CDDA_TEST_JITTER_LARGE,
+  CDDA_TEST_JITTER_MASSIVE,
+  CDDA_TEST_FRAG_SMALL,
+  CDDA_TEST_FRAG_LARGE,
+  CDDA_TEST_FRAG_MASSIVE,
+  CDDA_TEST_UNDERRUN,
+};
+
+#define NMODES   (sizeof(modes) / sizeof(modes[0]))
+#define NCLASSES (sizeof(classes) / sizeof(classes[0]))
+
+static const char *cb_names[] = {
+  "read", "verify", "fixup_edge", "fixup_atom", "scratch", "repair",
+  "skip", "drift", "backoff", "overlap", "fixup_dropped", "fixup_duped",
+  "readerr", "cacheerr", "wrote", "finished"
+};
+
+#define NCALLBACKS (sizeof(cb_names) / sizeof(cb_names[0]))
+
+static int repeats = 3;
+static int max_retries = 20;
+static long latency_us = 0;
+static int threaded = 0;
+static double time_limit = 10;
+
+/* What one combination measures. */
+static long cb_counts[NCALLBACKS];
+static long reads, sectors_read, gave_up;
+static cdrom_paranoia_t *ripping;
+static int rip_mode;
+static double deadline;
+static long (*drive_read_audio)(cdrom_drive_t *d, void *p, lsn_t begin,
+                                long sectors);
+
+static void
+callback(long int inpos, paranoia_cb_mode_t function)
+{
+  if ((unsigned)function < NCALLBACKS)
+    cb_counts[function]++;
+}
+
+static double
+now(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+#endif
+}
+
+/* Sits between paranoia and the drive to count what it reads.  A
+   NEVERSKIP rip can retry forever on a drive that never gives the
+   same answer twice; past the deadline, let it skip. */
+static long
+counting_read(cdrom_drive_t *d, void *p, lsn_t begin, long sectors)
+{
+  long ret = drive_read_audio(d, p, begin, sectors);
+  reads++;
+  if (ret > 0)
+    sectors_read += ret;
+  if ((rip_mode & PARANOIA_MODE_NEVERSKIP) && time_limit > 0 &&
+      now() > deadline) {
+    gave_up++;
+    rip_mode &= ~PARANOIA_MODE_NEVERSKIP;
+    paranoia_modeset(ripping, rip_mode);
+  }
+  return ret;
+}
+
+static double
+cpu_time(void)
+{
+#ifdef HAVE_SYS_RESOURCE_H
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6
+    + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static long
+max_rss_kb(void)
+{
+#ifdef HAVE_SYS_RESOURCE_H
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+  return ru.ru_maxrss / 1024;
+#else
+  return ru.ru_maxrss;
+#endif
+#else
+  return -1;
+#endif
+}
+
+static cdrom_drive_t *
+open_sim(const char *image, const cdda_sim_t *sim)
+{
+  cdrom_drive_t *d = cdda_identify_sim(image, sim, CDDA_MESSAGE_FORGETIT,
+                                       NULL);
+  if (!d)
+    return NULL;
+  cdda_verbose_set(d, CDDA_MESSAGE_FORGETIT, CDDA_MESSAGE_FORGETIT);
+  if (cdda_open(d)) {
+    cdda_close(d);
+    return NULL;
+  }
+  return d;
+}
+
+/* The audio on the image, as a perfect drive reads it. */
+static uint8_t *
+read_reference(const char *image, lsn_t *first, lsn_t *last)
+{
+  cdrom_drive_t *d = open_sim(image, NULL);
+  uint8_t *buf;
+  lsn_t lsn;
+
+  if (!d)
+    return NULL;
+  *first = cdda_disc_firstsector(d);
+  *last = cdda_disc_lastsector(d);
+  buf = calloc(*last - *first + 1, CDIO_CD_FRAMESIZE_RAW);
+  for (lsn = *first; lsn <= *last; ) {
+    long n = cdda_read(d, buf + (lsn - *first) * CDIO_CD_FRAMESIZE_RAW,
+                       lsn, *last - lsn + 1);
+    if (n <= 0) {
+      free(buf);
+      buf = NULL;
+      break;
+    }
+    lsn += n;
+  }
+  cdda_close(d);
+  return buf;
+}
+
+/* Rip the whole disc once; returns the number of sectors that came
+   back wrong or not at all. */
+static long
+rip(cdrom_drive_t *d, int mode, const uint8_t *reference, lsn_t first,
+    lsn_t last)
+{
+  cdrom_paranoia_t *p = paranoia_init(d);
+  long bad = 0;
+  lsn_t lsn;
+
+  ripping = p;
+  rip_mode = mode;
+  deadline = now() + time_limit;
+  paranoia_modeset(p, mode);
+  if (threaded)
+    cdio_paranoia_threaded(p, 2);
+  paranoia_seek(p, first, SEEK_SET);
+  for (lsn = first; lsn <= last; lsn++) {
+    int16_t *buf = paranoia_read_limited(p, callback, max_retries);
+    char *err = cdda_errors(d);
+    char *mes = cdda_messages(d);
+
+    cdio_cddap_free_messages(err);
+    cdio_cddap_free_messages(mes);
+    if (!buf || memcmp(buf, reference + (lsn - first) *
+                       CDIO_CD_FRAMESIZE_RAW, CDIO_CD_FRAMESIZE_RAW))
+      bad++;
+  }
+  paranoia_free(p);
+  return bad;
+}
+
+static const char *
+basename_of(const char *path)
+{
+  const char *slash = strrchr(path, '/');
+  return slash ? slash + 1 : path;
+}
+
+/* Time one image/mode/class combination and print its line. */
+static int
+bench(const char *image, int m, int test_flags, const uint8_t *reference,
+      lsn_t first, lsn_t last)
+{
+  long sectors = last - first + 1;
+  double wall, cpu;
+  long bad = 0, allocs0;
+  cdda_sim_t sim;
+  unsigned int i;
+  int r;
+
+  memset(cb_counts, 0, sizeof(cb_counts));
+  reads = sectors_read = gave_up = 0;
+  allocs0 = allocs;
+  wall = now();
+  cpu = cpu_time();
+
+  for (r = 0; r < repeats; r++) {
+    cdrom_drive_t *d;
+
+    cdio_cddap_sim_init(&sim, test_flags);
+    sim.seed = r + 1;
+    sim.latency_us = latency_us;
+    d = open_sim(image, &sim);
+    if (!d) {
+      fprintf(stderr, "Unable to open %s\n", image);
+      return 1;
+    }
+    drive_read_audio = d->read_audio;
+    d->read_audio = counting_read;
+    bad += rip(d, modes[m].mode, reference, first, last);
+    cdda_close(d);
+  }
+
+  wall = now() - wall;
+  cpu = cpu_time() - cpu;
+
+  printf("{\"image\": \"%s\", \"mode\": \"%s\", \"test_flags\": %d, "
+         "\"sectors\": %ld, \"repeats\": %d, "
+         "\"wall_s\": %.6f, \"cpu_s\": %.6f, "
+         "\"sectors_per_s\": %.1f, \"cpu_s_per_disc\": %.6f, "
+         "\"max_rss_kb\": %ld, \"reads\": %ld, \"sectors_read\": %ld, "
+         "\"rereads\": %ld, \"allocs\": %ld, \"bad_sectors\": %ld, "
+         "\"gave_up\": %ld, \"callbacks\": {",
+         basename_of(image), modes[m].name, test_flags,
+         sectors, repeats, wall, cpu,
+         wall > 0 ? sectors * repeats / wall : 0.0, cpu / repeats,
+         max_rss_kb(), reads, sectors_read,
+         sectors_read - sectors * repeats,
+         allocs < 0 ? -1 : allocs - allocs0, bad, gave_up);
+  for (i = 0; i < NCALLBACKS; i++)
+    printf("%s\"%s\": %ld", i ? ", " : "", cb_names[i], cb_counts[i]);
+  printf("}}\n");
+  fflush(stdout);
+  return 0;
+}
+
+static void
+usage(const char *prog)
+{
+  fprintf(stderr,
+          "Usage: %s [-r repeats] [-R retries] [-T seconds] [-l latency-us] "
+          "[-t] [-m mode] [-x test-flags] image...\n"
+          "  -m and -x may be repeated; by default every paranoia mode\n"
+          "  (disable, overlap, full, full-neverskip) is run under every\n"
+          "  paranoia_jitter_t class.\n", prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int mode_set[NMODES], class_set[16];
+  unsigned int nmode = 0, nclass = 0;
+  int opt, i, rc = 0;
+
+  while ((opt = getopt(argc, argv, "r:R:T:l:tm:x:h")) != -1) {
+    switch (opt) {
+    case 'r': repeats = atoi(optarg); break;
+    case 'R': max_retries = atoi(optarg); break;
+    case 'T': time_limit = atof(optarg); break;
+    case 'l': latency_us = atol(optarg); break;
+    case 't': threaded = 1; break;
+    case 'm': {
+      unsigned int m;
+      for (m = 0; m < NMODES; m++)
+        if (!strcmp(optarg, modes[m].name))
+          break;
+      if (m == NMODES || nmode == NMODES) {
+        usage(argv[0]);
+        return 1;
+      }
+      mode_set[nmode++] = m;
+      break;
+    }
+    case 'x':
+      if (nclass == sizeof(class_set) / sizeof(class_set[0])) {
+        usage(argv[0]);
+        return 1;
+      }
+      class_set[nclass++] = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (optind >= argc || repeats < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (!nmode)
+    for (nmode = 0; nmode < NMODES; nmode++)
+      mode_set[nmode] = nmode;
+  if (!nclass)
+    for (nclass = 0; nclass < NCLASSES; nclass++)
+      class_set[nclass] = classes[nclass];
+
+  for (i = optind; i < argc; i++) {
+    lsn_t first, last;
+    uint8_t *reference = read_reference(argv[i], &first, &last);
+    unsigned int m, c;
+
+    if (!reference) {
+      fprintf(stderr, "Unable to read %s\n", argv[i]);
+      rc = 1;
+      continue;
+    }
+    for (m = 0; m < nmode; m++)
+      for (c = 0; c < nclass; c++) {
+#ifdef BENCH_FORK
+        int status;
+        pid_t pid = fork();
+
+        if (pid == 0)
+          _exit(bench(argv[i], mode_set[m], class_set[c], reference,
+                      first, last));
+        if (pid < 0 || waitpid(pid, &status, 0) != pid ||
+            !WIFEXITED(status) || WEXITSTATUS(status))
+          rc = 1;
+#else
+        rc |= bench(argv[i], mode_set[m], class_set[c], reference,
+                    first, last);
+#endif
+      }
+    free(reference);
+  }
+  return rc;
+}
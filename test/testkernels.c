@@ -0,0 +1,268 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Tests that the alternative implementations of the paranoia kernels
+   give the same answers as the original ones: every match kernel set
+   the CPU can run agrees with the scalar one, and the sorted sample
+   index finds the same matches as the bucket index.
+
+   The library sources are compiled in directly, since the kernels
+   are internal to it. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+# define __CDIO_CONFIG_H__ 1
+#endif
+
+#include "../lib/paranoia/gap.c"
+#include "../lib/paranoia/isort.c"
+#include "../lib/paranoia/match.c"
+#include "../lib/paranoia/overlap.c"
+#include "../lib/paranoia/p_block.c"
+#include "../lib/paranoia/reader.c"
+#include "../lib/paranoia/paranoia.c"
+#include "../lib/paranoia/crc32.c"
+#include "../lib/paranoia/twopass.c"
+
+#include <stdio.h>
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#define MAX_WORDS 5000
+
+static unsigned long seed = 1;
+
+/* Repeatable on every platform, unlike rand(). */
+static long
+next_random(void)
+{
+  seed = seed * 1103515245UL + 12345UL;
+  return (long)((seed >> 16) & 0x7fff);
+}
+
+/* Fill v with n samples: all from (span) values around zero if span
+   is small, so that most of them repeat, or anything at all. */
+static void
+fill(int16_t *v, long n, long span)
+{
+  long j;
+
+  for (j = 0; j < n; j++)
+    v[j] = span < 65536
+      ? (int16_t)(next_random() % span - span / 2)
+      : (int16_t)(next_random() ^ (next_random() << 15));
+}
+
+/* Compare kernel set k with the scalar set on n samples of a and b
+   and their flags.  0 if they disagree. */
+static int
+same_run(const match_kernel_t *k, const match_kernel_t *scalar,
+         const int16_t *a, const int16_t *b, const unsigned char *fa,
+         const unsigned char *fb, long n)
+{
+  const int16_t *ae = a + n - 1, *be = b + n - 1;
+  const unsigned char *fae = fa + n - 1, *fbe = fb + n - 1;
+  long want[4], got[4];
+  int j;
+
+  want[0] = scalar->fwd(a, b, n);
+  got[0] = k->fwd(a, b, n);
+  want[1] = n ? scalar->back(ae, be, n) : 0;
+  got[1] = n ? k->back(ae, be, n) : 0;
+  want[2] = scalar->fwd_flags(a, b, fa, fb, n);
+  got[2] = k->fwd_flags(a, b, fa, fb, n);
+  want[3] = n ? scalar->back_flags(ae, be, fae, fbe, n) : 0;
+  got[3] = n ? k->back_flags(ae, be, fae, fbe, n) : 0;
+
+  for (j = 0; j < 4; j++)
+    if (got[j] != want[j]) {
+      static const char *const which[4] = {
+        "fwd", "back", "fwd_flags", "back_flags"
+      };
+      printf("-- %s %s: %ld samples matched of %ld, scalar says %ld\n",
+             k->name, which[j], got[j], n, want[j]);
+      return 0;
+    }
+  return 1;
+}
+
+/* Every match kernel set i_match_available() reports gives the same
+   answers as the scalar set, for lengths around each vector width and
+   buffers at every alignment.  The buffers are allocated at their
+   exact size, so that a kernel reading past either end shows up under
+   a memory checker. */
+static int
+match_kernels_agree(void)
+{
+  static const long lengths[] = {
+    0, 1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 1000
+  };
+  const match_kernel_t *const *list = i_match_available();
+  int ok = 1;
+  int k;
+
+  for (k = 1; ok && list[k]; k++) {
+    size_t l;
+    for (l = 0; ok && l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+      long n = lengths[l];
+      int align, t;
+
+      for (align = 0; ok && align < 4; align++)
+        for (t = 0; ok && t < 50; t++) {
+          /* the first (align) samples put the rest off alignment */
+          long size = n + align;
+          int16_t *a = malloc(sizeof(int16_t) * (size ? size : 1));
+          int16_t *b = malloc(sizeof(int16_t) * (size ? size : 1));
+          unsigned char *fa = malloc(size ? size : 1);
+          unsigned char *fb = malloc(size ? size : 1);
+          long j;
+
+          fill(a, size, t % 2 ? 4 : 65536);
+          memcpy(b, a, sizeof(int16_t) * size);
+          memset(fa, 0, size);
+          memset(fb, 0, size);
+          /* Some runs match all the way, others stop at a differing
+             sample or at flags; edge flags on one side only don't
+             stop them. */
+          if (n && t % 5)
+            for (j = 0; j < 1 + t % 3; j++)
+              b[align + next_random() % n]++;
+          if (n && t % 3 == 0) {
+            long at = align + next_random() % n;
+            switch (next_random() % 4) {
+            case 0: fa[at] = fb[at] = MATCH_FLAG_EDGE; break;
+            case 1: fa[at] = MATCH_FLAG_UNREAD; break;
+            case 2: fb[at] = MATCH_FLAG_UNREAD; break;
+            default: fa[at] = MATCH_FLAG_EDGE; break;
+            }
+          }
+          ok = same_run(list[k], list[0], a + align, b + align,
+                        fa + align, fb + align, n);
+          free(a);
+          free(b);
+          free(fa);
+          free(fb);
+        }
+    }
+  }
+  return ok;
+}
+
+/* Every match sort_getmatch()/sort_nextmatch() hand out for one
+   query, as offsets into the vector; returns how many, or more than
+   the vector holds if they don't stop. */
+static long
+matches(sort_info_t *i, long post, long overlap, int value, long *out)
+{
+  sort_link_t *ptr = sort_getmatch(i, post, overlap, value);
+  long n = 0;
+
+  while (ptr && n <= is(i)) {
+    out[n++] = ipos(i, ptr);
+    ptr = sort_nextmatch(i, ptr);
+  }
+  return n;
+}
+
+/* Ask both indexes of v the same queries.  0 if they disagree. */
+static int
+same_matches(const char *what, sort_info_t *a, sort_info_t *b,
+             const int16_t *v, long size)
+{
+  static long ma[MAX_WORDS + 1], mb[MAX_WORDS + 1];
+  int q;
+
+  for (q = 0; q < 200; q++) {
+    long post = next_random() % (size + 20) - 10;
+    long overlap = next_random() % (size + 1);
+    /* mostly values that are there, sometimes ones that aren't */
+    int value = q % 4 ? v[next_random() % size]
+      : (int)(next_random() - 16384);
+    long na = matches(a, post, overlap, value, ma);
+    long nb = matches(b, post, overlap, value, mb);
+
+    if (na != nb || memcmp(ma, mb, na * sizeof(long))) {
+      printf("-- %s: sort_getmatch(%ld, %ld, %d) found %ld matches "
+             "with buckets, %ld sorted\n", what, post, overlap, value,
+             na, nb);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* The bucket and sorted indexes of the same samples, set up afresh
+   for one range and then slid along it as a keyed index, agree. */
+static int
+sort_indexes_agree(void)
+{
+  static const long sizes[] = { 1, 2, 7, CD_FRAMEWORDS, MAX_WORDS };
+  static const long spans[] = { 2, 16, 65536 };
+  static int16_t v[MAX_WORDS];
+  sort_info_t *a = sort_alloc_type(MAX_WORDS, SORT_INDEX_BUCKETS);
+  sort_info_t *b = sort_alloc_type(MAX_WORDS, SORT_INDEX_SORTED);
+  long abspos = 1000;
+  int ok = 1;
+  size_t s, t;
+
+  for (s = 0; ok && s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    for (t = 0; ok && t < sizeof(spans) / sizeof(spans[0]); t++) {
+      long size = sizes[s];
+      long lo = abspos + next_random() % size;
+      long step;
+      char what[80];
+
+      fill(v, size, spans[t]);
+      snprintf(what, sizeof(what), "%ld samples of %ld values", size,
+               spans[t]);
+      sort_setup(a, v, &abspos, size, lo, abspos + size);
+      sort_setup(b, v, &abspos, size, lo, abspos + size);
+      ok = same_matches(what, a, b, v, size);
+
+      /* The keyed index adds and drops samples at either end. */
+      for (step = 0; ok && step < 8; step++) {
+        long from = abspos + next_random() % size;
+        long to = from + next_random() % (size + 1);
+
+        sort_setup_keyed(a, 1, v, &abspos, size, from, to);
+        sort_setup_keyed(b, 1, v, &abspos, size, from, to);
+        ok = same_matches(what, a, b, v, size);
+      }
+    }
+  sort_free(a);
+  sort_free(b);
+  return ok;
+}
+
+int
+main(int argc, const char *argv[])
+{
+  int failures = 0;
+
+  if (!match_kernels_agree())
+    failures++;
+
+  if (!sort_indexes_agree())
+    failures++;
+
+  if (failures)
+    return 1;
+  printf("-- Kernels agree\n");
+  return 0;
+}
@@ -0,0 +1,917 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Tests the simulated drive: a perfect one reads like the image, a
+   bad one is bad the same way every time for a given seed, and
+   paranoia gets the image back through each kind of misbehavior. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+# define __CDIO_CONFIG_H__ 1
+#endif
+
+#include <cdio/paranoia/cdda.h>
+#include <cdio/paranoia/paranoia.h>
+#include <stdio.h>
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#define SKIP_TEST_RC 77
+
+#ifndef DATA_DIR
+#define DATA_DIR "./data"
+#endif
+
+static const char *cue_file = DATA_DIR "/cdda.cue";
+static uint8_t *reference = NULL;
+static lsn_t first_lsn, last_lsn;
+
+static void
+callback(long int inpos, paranoia_cb_mode_t function)
+{
+}
+
+static cdrom_drive_t *
+open_sim(const cdda_sim_t *sim)
+{
+  cdrom_drive_t *d = cdda_identify_sim(cue_file, sim,
+                                       CDDA_MESSAGE_FORGETIT, NULL);
+  if (!d)
+    return NULL;
+  cdda_verbose_set(d, CDDA_MESSAGE_FORGETIT, CDDA_MESSAGE_FORGETIT);
+  if (cdda_open(d)) {
+    cdda_close(d);
+    return NULL;
+  }
+  return d;
+}
+
+/* Read the whole disc raw, in the drive's own read sizes. */
+static uint8_t *
+read_raw(cdrom_drive_t *d)
+{
+  long sectors = last_lsn - first_lsn + 1;
+  uint8_t *buf = calloc(sectors, CDIO_CD_FRAMESIZE_RAW);
+  lsn_t lsn = first_lsn;
+
+  while (lsn <= last_lsn) {
+    long n = cdda_read(d, buf + (lsn - first_lsn) * CDIO_CD_FRAMESIZE_RAW,
+                       lsn, last_lsn - lsn + 1);
+    if (n <= 0) {
+      free(buf);
+      return NULL;
+    }
+    lsn += n;
+  }
+  return buf;
+}
+
+/* Rip the disc through paranoia, with the given PARANOIA_SORTINDEX_*
+   index, and compare with the reference; trusting C2 error pointers
+   if (c2), when it must also read most sectors only once. */
+static int
+rip_matches(const char *what, const cdda_sim_t *sim, int c2, int sortindex)
+{
+  cdrom_drive_t *d = open_sim(sim);
+  cdrom_paranoia_t *p;
+  lsn_t lsn;
+  int ok = 1;
+
+  if (!d) {
+    printf("-- %s: unable to open simulated drive\n", what);
+    return 0;
+  }
+  p = paranoia_init(d);
+  paranoia_modeset(p, PARANOIA_MODE_FULL ^ PARANOIA_MODE_NEVERSKIP);
+  paranoia_c2(p, c2);
+  paranoia_sortindex(p, sortindex);
+  paranoia_seek(p, first_lsn, SEEK_SET);
+  for (lsn = first_lsn; lsn <= last_lsn; lsn++) {
+    int16_t *buf = paranoia_read_limited(p, callback, 20);
+    if (!buf || memcmp(buf, reference + (lsn - first_lsn) *
+                       CDIO_CD_FRAMESIZE_RAW, CDIO_CD_FRAMESIZE_RAW)) {
+      printf("-- %s: sector %ld differs from the image\n", what,
+             (long) lsn);
+      ok = 0;
+      break;
+    }
+  }
+  if (ok && c2) {
+    paranoia_stats_t st;
+    paranoia_get_stats(p, &st);
+    if (st.c2_sectors < st.sectors_read ||
+        st.sectors_read > (last_lsn - first_lsn + 1) * 3 / 2) {
+      printf("-- %s: %ld sectors read for %ld\n", what, st.sectors_read,
+             (long) (last_lsn - first_lsn + 1));
+      ok = 0;
+    }
+  }
+  paranoia_free(p);
+  cdda_close(d);
+  return ok;
+}
+
+/* Rip the disc in two passes, re-ripping with paranoia only the ranges
+   that read differently twice, and compare with the reference. */
+static int
+two_pass_matches(const char *what, const cdda_sim_t *sim)
+{
+  cdrom_drive_t *d = open_sim(sim);
+  cdrom_paranoia_t *p;
+  long sectors = last_lsn - first_lsn + 1;
+  uint8_t *buf = calloc(sectors, CDIO_CD_FRAMESIZE_RAW);
+  paranoia_range_t ranges[16];
+  lsn_t lsn;
+  int i, n, ok = 1;
+
+  if (!d || !buf) {
+    printf("-- %s: unable to open simulated drive\n", what);
+    free(buf);
+    return 0;
+  }
+  p = paranoia_init(d);
+  paranoia_modeset(p, PARANOIA_MODE_DISABLE);
+  paranoia_seek(p, first_lsn, SEEK_SET);
+  paranoia_checksums(p, 1);
+  for (lsn = first_lsn; lsn <= last_lsn; lsn++) {
+    int16_t *samples = paranoia_read_limited(p, callback, 20);
+    if (samples)
+      memcpy(buf + (lsn - first_lsn) * CDIO_CD_FRAMESIZE_RAW, samples,
+             CDIO_CD_FRAMESIZE_RAW);
+  }
+
+  n = paranoia_recheck(p, ranges, 16, callback, 20);
+  if (n < 1 || n > 16) {
+    printf("-- %s: %d ranges read differently\n", what, n);
+    ok = 0;
+  }
+  paranoia_modeset(p, PARANOIA_MODE_FULL ^ PARANOIA_MODE_NEVERSKIP);
+  for (i = 0; ok && i < n; i++) {
+    uint8_t *at = buf + (ranges[i].first - first_lsn) * CDIO_CD_FRAMESIZE_RAW;
+    if (paranoia_reread(p, &ranges[i], (int16_t *)at, NULL, callback, 20) !=
+        ranges[i].last - ranges[i].first + 1) {
+      printf("-- %s: re-reading %ld-%ld failed\n", what,
+             (long) ranges[i].first, (long) ranges[i].last);
+      ok = 0;
+    }
+  }
+  if (ok && memcmp(buf, reference, sectors * CDIO_CD_FRAMESIZE_RAW)) {
+    printf("-- %s: the rip differs from the image\n", what);
+    ok = 0;
+  }
+  free(buf);
+  paranoia_free(p);
+  cdda_close(d);
+  return ok;
+}
+
+/* Rip a scratched disc putting off what won't verify; everything else
+   must match the reference, and each range put off must read again. */
+static int
+deferred_matches(const char *what, const cdda_sim_t *sim)
+{
+  cdrom_drive_t *d = open_sim(sim);
+  cdrom_paranoia_t *p;
+  long sectors = last_lsn - first_lsn + 1;
+  uint8_t *buf = calloc(sectors, CDIO_CD_FRAMESIZE_RAW);
+  char *deferred = calloc(sectors, 1);
+  paranoia_range_t ranges[16];
+  lsn_t lsn;
+  int i, n, total = 0, ok = 1;
+
+  if (!d || !buf || !deferred) {
+    printf("-- %s: unable to open simulated drive\n", what);
+    free(buf);
+    free(deferred);
+    return 0;
+  }
+  p = paranoia_init(d);
+  paranoia_modeset(p, PARANOIA_MODE_FULL ^ PARANOIA_MODE_NEVERSKIP);
+  paranoia_defer(p, 3);
+  paranoia_seek(p, first_lsn, SEEK_SET);
+  for (lsn = first_lsn; lsn <= last_lsn; lsn++) {
+    int16_t *samples = paranoia_read_limited(p, callback, 20);
+    if (samples)
+      memcpy(buf + (lsn - first_lsn) * CDIO_CD_FRAMESIZE_RAW, samples,
+             CDIO_CD_FRAMESIZE_RAW);
+  }
+
+  while (ok && (n = paranoia_deferred(p, ranges, 16)) > 0) {
+    for (i = 0; ok && i < n; i++) {
+      uint8_t *at =
+        buf + (ranges[i].first - first_lsn) * CDIO_CD_FRAMESIZE_RAW;
+      if (ranges[i].first < first_lsn || ranges[i].last > last_lsn ||
+          ranges[i].last < ranges[i].first ||
+          paranoia_reread(p, &ranges[i], (int16_t *)at, NULL, callback,
+                          20) != ranges[i].last - ranges[i].first + 1) {
+        printf("-- %s: range %ld-%ld put off didn't read again\n", what,
+               (long) ranges[i].first, (long) ranges[i].last);
+        ok = 0;
+      }
+      for (lsn = ranges[i].first; ok && lsn <= ranges[i].last; lsn++)
+        deferred[lsn - first_lsn] = 1;
+    }
+    total += n;
+  }
+  if (ok && total == 0) {
+    printf("-- %s: nothing was put off\n", what);
+    ok = 0;
+  }
+  for (lsn = first_lsn; ok && lsn <= last_lsn; lsn++)
+    if (!deferred[lsn - first_lsn] &&
+        memcmp(buf + (lsn - first_lsn) * CDIO_CD_FRAMESIZE_RAW,
+               reference + (lsn - first_lsn) * CDIO_CD_FRAMESIZE_RAW,
+               CDIO_CD_FRAMESIZE_RAW)) {
+      printf("-- %s: sector %ld differs from the image\n", what,
+             (long) lsn);
+      ok = 0;
+    }
+  free(buf);
+  free(deferred);
+  paranoia_free(p);
+  cdda_close(d);
+  return ok;
+}
+
+/* Sectors skip callbacks were made for, as a bitmap of the disc. */
+static char *skipped_at;
+
+static void
+skip_callback(long int inpos, paranoia_cb_mode_t function)
+{
+  lsn_t lsn = inpos / CD_FRAMEWORDS;
+
+  if (function == PARANOIA_CB_SKIP && skipped_at && lsn >= first_lsn &&
+      lsn <= last_lsn)
+    skipped_at[lsn - first_lsn] = 1;
+}
+
+/* Rip a scratched disc letting paranoia skip, once sector by sector
+   with paranoia_read_limited() and once in batches with
+   paranoia_read_batch(), which must hand back the same samples.  Its
+   status bytes must flag each sector skipped at and each that differs
+   from the reference.  Then read past the end of the track without
+   verification: the batch comes up as short as paranoia_read_limited()
+   does. */
+static int
+batch_matches(const char *what, const cdda_sim_t *sim)
+{
+  cdrom_drive_t *d = open_sim(sim);
+  cdrom_paranoia_t *p;
+  long sectors = last_lsn - first_lsn + 1;
+  long bytes = sectors * CDIO_CD_FRAMESIZE_RAW;
+  uint8_t *one = malloc(bytes);
+  uint8_t *batch = malloc(bytes);
+  unsigned char *status = malloc(sectors);
+  long done, got, n, skips = 0;
+  lsn_t lsn;
+  int ok = 1;
+
+  skipped_at = calloc(sectors, 1);
+  if (!d || !one || !batch || !status || !skipped_at) {
+    printf("-- %s: unable to open simulated drive\n", what);
+    ok = 0;
+    goto out;
+  }
+  p = paranoia_init(d);
+  paranoia_modeset(p, PARANOIA_MODE_FULL ^ PARANOIA_MODE_NEVERSKIP);
+  paranoia_seek(p, first_lsn, SEEK_SET);
+  for (lsn = first_lsn; ok && lsn <= last_lsn; lsn++) {
+    int16_t *buf = paranoia_read_limited(p, skip_callback, 20);
+    if (!buf)
+      ok = 0;
+    else
+      memcpy(one + (lsn - first_lsn) * CDIO_CD_FRAMESIZE_RAW, buf,
+             CDIO_CD_FRAMESIZE_RAW);
+  }
+  paranoia_free(p);
+  cdda_close(d);
+
+  /* The same drive again, from the same seed. */
+  d = open_sim(sim);
+  if (!d) {
+    ok = 0;
+    goto out;
+  }
+  p = paranoia_init(d);
+  paranoia_modeset(p, PARANOIA_MODE_FULL ^ PARANOIA_MODE_NEVERSKIP);
+  paranoia_seek(p, first_lsn, SEEK_SET);
+  for (done = 0; ok && done < sectors; done += got) {
+    /* an odd size, so batches start all over the place */
+    long want = sectors - done < 37 ? sectors - done : 37;
+
+    got = paranoia_read_batch(p, (int16_t *)(batch + done *
+                                              CDIO_CD_FRAMESIZE_RAW),
+                              want, status + done, callback, 20);
+    if (got < 1)
+      ok = 0;
+  }
+  if (ok && memcmp(one, batch, bytes)) {
+    printf("-- %s: batches differ from single sectors\n", what);
+    ok = 0;
+  }
+  for (lsn = first_lsn; ok && lsn <= last_lsn; lsn++) {
+    long i = lsn - first_lsn;
+    int differs = memcmp(batch + i * CDIO_CD_FRAMESIZE_RAW,
+                         reference + i * CDIO_CD_FRAMESIZE_RAW,
+                         CDIO_CD_FRAMESIZE_RAW) != 0;
+
+    skips += skipped_at[i];
+    if ((status[i] & PARANOIA_SECTOR_UNVERIFIED) ||
+        ((skipped_at[i] || differs) &&
+         !(status[i] & PARANOIA_SECTOR_SKIPPED))) {
+      printf("-- %s: sector %ld has status %d\n", what, (long) lsn,
+             status[i]);
+      ok = 0;
+    }
+  }
+  if (ok && !skips) {
+    printf("-- %s: nothing was skipped\n", what);
+    ok = 0;
+  }
+
+  /* Streaming stops at the end of the track. */
+  paranoia_modeset(p, PARANOIA_MODE_DISABLE);
+  paranoia_seek(p, last_lsn - 9, SEEK_SET);
+  for (n = 0; n < 40 && paranoia_read_limited(p, callback, 20); n++)
+    ;
+  paranoia_seek(p, last_lsn - 9, SEEK_SET);
+  got = paranoia_read_batch(p, (int16_t *)batch, 40, status, callback, 20);
+  if (ok && (n != 10 || got != n ||
+             memcmp(batch, reference + (last_lsn - 9 - first_lsn) *
+                    CDIO_CD_FRAMESIZE_RAW, got * CDIO_CD_FRAMESIZE_RAW))) {
+    printf("-- %s: %ld sectors batched at the end, %ld single\n", what,
+           got, n);
+    ok = 0;
+  }
+  for (n = 0; ok && n < got; n++)
+    if (status[n] != PARANOIA_SECTOR_UNVERIFIED) {
+      printf("-- %s: unverified sector has status %d\n", what, status[n]);
+      ok = 0;
+    }
+  if (ok && paranoia_read_batch(p, (int16_t *)batch, 40, status, callback,
+                                20) != -1) {
+    printf("-- %s: a batch past the end read something\n", what);
+    ok = 0;
+  }
+  paranoia_free(p);
+
+ out:
+  if (d)
+    cdda_close(d);
+  free(one);
+  free(batch);
+  free(status);
+  free(skipped_at);
+  skipped_at = NULL;
+  return ok;
+}
+
+/* A borrowed span stays as it was while the root grows past it and
+   moves to new buffers; releasing it frees the buffer it held, and
+   paranoia_free() copes with spans never released. */
+static int
+borrow_holds(const cdda_sim_t *sim)
+{
+  cdrom_drive_t *d = open_sim(sim);
+  cdrom_paranoia_t *p;
+  paranoia_span_t span, kept;
+  paranoia_stats_t st;
+  uint8_t *copy;
+  lsn_t lsn;
+  int ok = 1;
+
+  if (!d)
+    return 0;
+  p = paranoia_init(d);
+  paranoia_modeset(p, PARANOIA_MODE_FULL ^ PARANOIA_MODE_NEVERSKIP);
+  /* small reads, so that the root grows many times */
+  paranoia_cachemodel_size(p, 20);
+  paranoia_seek(p, first_lsn, SEEK_SET);
+
+  if (paranoia_borrow(p, 4, &span, callback, 20) < 1) {
+    paranoia_free(p);
+    cdda_close(d);
+    return 0;
+  }
+  copy = malloc(span.sectors * CDIO_CD_FRAMESIZE_RAW);
+  memcpy(copy, span.samples, span.sectors * CDIO_CD_FRAMESIZE_RAW);
+
+  for (lsn = span.lsn + span.sectors; ok && lsn < first_lsn + 200; lsn++)
+    if (!paranoia_read_limited(p, callback, 20))
+      ok = 0;
+  paranoia_get_stats(p, &st);
+  if (st.retired_buffers < 1 ||
+      memcmp(span.samples, copy, span.sectors * CDIO_CD_FRAMESIZE_RAW) ||
+      memcmp(copy, reference + (span.lsn - first_lsn) *
+             CDIO_CD_FRAMESIZE_RAW, span.sectors * CDIO_CD_FRAMESIZE_RAW))
+    ok = 0;
+
+  paranoia_release(p, &span);
+  paranoia_get_stats(p, &st);
+  if (st.retired_buffers != 0 || span.samples)
+    ok = 0;
+
+  /* Held across the end of paranoia itself. */
+  if (paranoia_borrow(p, 4, &kept, callback, 20) < 1)
+    ok = 0;
+  for (lsn = kept.lsn + kept.sectors; ok && lsn <= last_lsn; lsn++)
+    if (!paranoia_read_limited(p, callback, 20))
+      ok = 0;
+  paranoia_free(p);
+  cdda_close(d);
+  free(copy);
+  return ok;
+}
+
+/* Rip with the adaptive cache model on, starting from a model of
+   (model) sectors, and compare with the reference.  The model must
+   end up between lo and hi sectors. */
+static int
+cache_adapts(const char *what, const cdda_sim_t *sim, int model, long lo,
+             long hi)
+{
+  cdrom_drive_t *d = open_sim(sim);
+  cdrom_paranoia_t *p;
+  paranoia_stats_t st;
+  lsn_t lsn;
+  int ok = 1;
+
+  if (!d) {
+    printf("-- %s: unable to open simulated drive\n", what);
+    return 0;
+  }
+  p = paranoia_init(d);
+  paranoia_modeset(p, PARANOIA_MODE_FULL ^ PARANOIA_MODE_NEVERSKIP);
+  paranoia_cachemodel_size(p, model);
+  paranoia_cachemodel_adapt(p, 1);
+  paranoia_seek(p, first_lsn, SEEK_SET);
+  for (lsn = first_lsn; lsn <= last_lsn; lsn++) {
+    int16_t *buf = paranoia_read_limited(p, callback, 20);
+    if (!buf || memcmp(buf, reference + (lsn - first_lsn) *
+                       CDIO_CD_FRAMESIZE_RAW, CDIO_CD_FRAMESIZE_RAW)) {
+      printf("-- %s: sector %ld differs from the image\n", what,
+             (long) lsn);
+      ok = 0;
+      break;
+    }
+  }
+  paranoia_get_stats(p, &st);
+  if (ok && (st.cache_model < lo || st.cache_model > hi)) {
+    printf("-- %s: cache model of %ld sectors\n", what, st.cache_model);
+    ok = 0;
+  }
+  paranoia_free(p);
+  cdda_close(d);
+  return ok;
+}
+
+/* Does the profile database at path hold line? */
+static int
+file_has(const char *path, const char *line)
+{
+  char buf[1024];
+  FILE *f = fopen(path, "r");
+  int found = 0;
+
+  if (!f)
+    return 0;
+  while (!found && fgets(buf, sizeof(buf), f))
+    found = !strcmp(buf, line);
+  fclose(f);
+  return found;
+}
+
+/* Save a simulated drive's profile into a database that has another
+   drive's section, use it again, and then damage it. */
+static int
+profile_round_trip(void)
+{
+  const char *path = "testsim-profile.tmp";
+  cdrom_drive_t *d;
+  cdda_profile_t *prof;
+  cdrom_paranoia_t *p;
+  paranoia_stats_t st;
+  FILE *f;
+  int ok = 1;
+
+  if (!(f = fopen(path, "w")))
+    return 0;
+  fputs("[OTHER DRIVE 1.0]\nnsectors=7\nfuture_key=3\n", f);
+  fclose(f);
+
+  /* No section yet; save one. */
+  d = cdda_identify_sim(cue_file, NULL, CDDA_MESSAGE_FORGETIT, NULL);
+  if (!d || cdda_profile_use(d, path) != 0 || cdda_open(d)) {
+    if (d)
+      cdda_close(d);
+    remove(path);
+    return 0;
+  }
+  prof = cdda_profile(d);
+  prof->cache_sectors = 300;
+  prof->dynoverlap = 2000;
+  prof->dyndrift = -40;
+  if (cdda_profile_save(d) ||
+      !file_has(path, "[OTHER DRIVE 1.0]\n") ||
+      !file_has(path, "nsectors=7\n") || !file_has(path, "future_key=3\n"))
+    ok = 0;
+  cdda_close(d);
+
+  /* Read it back. */
+  d = cdda_identify_sim(cue_file, NULL, CDDA_MESSAGE_FORGETIT, NULL);
+  if (!d || cdda_profile_use(d, path) != 1 ||
+      cdda_profile(d)->cache_sectors != 300 ||
+      cdda_profile(d)->dynoverlap != 2000 ||
+      cdda_profile(d)->dyndrift != -40 ||
+      cdda_profile(d)->nsectors != 13)
+    ok = 0;
+  if (d)
+    cdda_close(d);
+
+  /* Values out of range are clamped, both reading the file and in
+     paranoia_init(). */
+  if ((f = fopen(path, "a"))) {
+    fputs("nsectors=99999999\nbigendian=7\n", f);
+    fclose(f);
+  }
+  d = cdda_identify_sim(cue_file, NULL, CDDA_MESSAGE_FORGETIT, NULL);
+  if (!d || cdda_profile_use(d, path) != 1 || cdda_open(d)) {
+    ok = 0;
+  } else {
+    if (d->nsectors < 1 || d->nsectors > 200 ||
+        cdda_profile(d)->bigendianp != 1)
+      ok = 0;
+    cdda_profile(d)->dyndrift = -2000000000L;
+    p = paranoia_init(d);
+    paranoia_get_stats(p, &st);
+    if (st.dyndrift < -32 * CD_FRAMEWORDS)
+      ok = 0;
+    paranoia_free(p);
+  }
+  if (d)
+    cdda_close(d);
+
+  remove(path);
+  return ok;
+}
+
+int
+main(int argc, const char *argv[])
+{
+  cdrom_drive_t *d = cdda_identify(cue_file, CDDA_MESSAGE_FORGETIT, NULL);
+  cdda_sim_t sim;
+  uint8_t *a, *b;
+  long bytes;
+  int i, failures = 0;
+  static const int classes[] = {
+    CDDA_TEST_JITTER_SMALL,
+    CDDA_TEST_JITTER_SMALL | CDDA_TEST_ALWAYS_JITTER,
+    CDDA_TEST_JITTER_LARGE,
+    CDDA_TEST_FRAG_SMALL,
+    CDDA_TEST_FRAG_LARGE,
+    CDDA_TEST_JITTER_SMALL | CDDA_TEST_ALWAYS_JITTER | CDDA_TEST_UNDERRUN,
+  };
+
+  if (!d || cdda_open(d)) {
+    printf("-- Unable to open %s\n", cue_file);
+    return SKIP_TEST_RC;
+  }
+  first_lsn = cdda_disc_firstsector(d);
+  last_lsn = cdda_disc_lastsector(d);
+  bytes = (last_lsn - first_lsn + 1) * CDIO_CD_FRAMESIZE_RAW;
+  reference = read_raw(d);
+
+  if (cdda_sim_set(d, &sim) != -405) {
+    printf("-- cdda_sim_set() accepted a real drive\n");
+    failures++;
+  }
+  cdda_close(d);
+  if (!reference) {
+    printf("-- Reference read failed\n");
+    return 1;
+  }
+
+  /* A perfect drive. */
+  d = open_sim(NULL);
+  a = d ? read_raw(d) : NULL;
+  if (!a || memcmp(a, reference, bytes)) {
+    printf("-- A perfect simulated drive doesn't read like the image\n");
+    failures++;
+  }
+  free(a);
+  if (d) {
+    /* ...in quick, mostly sequential reads, timed like a real
+       drive's. */
+    cdda_latency_t l;
+    long sequential = 0, seeks = 0;
+    cdda_latency(d, &l);
+    for (i = 0; i < CDDA_LATENCY_BUCKETS; i++) {
+      sequential += l.count[CDDA_LATENCY_SEQUENTIAL][i];
+      seeks += l.count[CDDA_LATENCY_SEEK][i];
+    }
+    if (sequential < 1 || sequential < seeks ||
+        l.max_us[CDDA_LATENCY_SEQUENTIAL] > 100000 || l.retries) {
+      printf("-- Read latency wasn't recorded as it happened\n");
+      failures++;
+    }
+    cdda_close(d);
+  }
+
+  /* A bad drive, twice with the same seed. */
+  cdio_cddap_sim_init(&sim, CDDA_TEST_JITTER_LARGE | CDDA_TEST_FRAG_LARGE);
+  sim.seed = 42;
+  sim.dropdupe_percent = 10;
+  sim.scratches = 3;
+  sim.cache_sectors = 20;
+  d = open_sim(&sim);
+  a = d ? read_raw(d) : NULL;
+  if (d)
+    cdda_close(d);
+  d = open_sim(&sim);
+  b = d ? read_raw(d) : NULL;
+  if (!a || !b || memcmp(a, b, bytes)) {
+    printf("-- The same seed gave different reads\n");
+    failures++;
+  } else if (!memcmp(a, reference, bytes)) {
+    printf("-- A bad simulated drive read perfectly\n");
+    failures++;
+  }
+  free(a);
+  free(b);
+
+  /* Reseeding restarts the same sequence. */
+  if (d) {
+    cdda_sim_set(d, &sim);
+    a = read_raw(d);
+    cdda_sim_set(d, &sim);
+    b = read_raw(d);
+    if (!a || !b || memcmp(a, b, bytes)) {
+      printf("-- cdda_sim_set() didn't restart the sequence\n");
+      failures++;
+    }
+    free(a);
+    free(b);
+    cdda_close(d);
+  }
+
+  /* An unreadable sector fails, and stops reads short of it. */
+  {
+    lsn_t bad = first_lsn + 10;
+    int16_t buf[10 * CD_FRAMESAMPLES * 2];
+
+    memset(&sim, 0, sizeof(sim));
+    sim.unreadable = &bad;
+    sim.n_unreadable = 1;
+    d = open_sim(&sim);
+    if (!d || cdda_read(d, buf, bad, 1) >= 0 ||
+        cdda_read(d, buf, first_lsn + 5, 10) != 5) {
+      printf("-- Unreadable sectors were read\n");
+      failures++;
+    }
+    if (d)
+      cdda_close(d);
+  }
+
+  /* Reads go through read size control: an unreadable sector and a
+     slow one are remembered as trouble, the unreadable one isn't
+     retried again straight after, and reads grow back to full size
+     past them. */
+  {
+    lsn_t bad = first_lsn + 100;
+    lsn_t slow = first_lsn + 200;
+    int16_t buf[13 * CD_FRAMESAMPLES * 2];
+    cdda_range_t r[8];
+    cdda_latency_t before, after;
+    lsn_t lsn = first_lsn;
+    int found_bad = 0, found_slow = 0, ok = 1;
+
+    memset(&sim, 0, sizeof(sim));
+    sim.unreadable = &bad;
+    sim.n_unreadable = 1;
+    sim.slow = &slow;
+    sim.n_slow = 1;
+    sim.slow_us = 100000;
+    d = open_sim(&sim);
+    while (d && ok && lsn < first_lsn + 260) {
+      long n;
+
+      cdda_latency(d, &before);
+      n = cdda_read(d, buf, lsn, 13);
+      cdda_latency(d, &after);
+      if (n <= 0) {
+        if (lsn != bad || after.retries != before.retries)
+          ok = 0;
+        lsn++;
+      } else if ((lsn <= bad && lsn + n > bad) ||
+                 memcmp(buf, reference + (lsn - first_lsn) *
+                        CDIO_CD_FRAMESIZE_RAW, n * CDIO_CD_FRAMESIZE_RAW))
+        ok = 0;
+      else
+        lsn += n;
+    }
+    if (d && ok) {
+      int n = cdda_trouble(d, r, 8);
+      long commands = 0;
+
+      for (i = 0; i < n && i < 8; i++) {
+        if (r[i].begin <= bad && bad < r[i].end)
+          found_bad = 1;
+        if (r[i].begin <= slow && slow < r[i].end)
+          found_slow = 1;
+      }
+      cdda_latency(d, &before);
+      ok = cdda_read(d, buf, lsn, 13) == 13;
+      cdda_latency(d, &after);
+      for (i = 0; i < CDDA_LATENCY_SERIES; i++) {
+        int j;
+        for (j = 0; j < CDDA_LATENCY_BUCKETS; j++)
+          commands += after.count[i][j] - before.count[i][j];
+      }
+      if (commands != 1)
+        ok = 0;
+    }
+    if (!d || !ok || !found_bad || !found_slow) {
+      printf("-- Read size control on the simulated drive failed\n");
+      failures++;
+    }
+    if (d)
+      cdda_close(d);
+  }
+
+  /* A seek into an unreadable stretch skips it with no root yet, and
+     what follows it still comes from the disc. */
+  {
+    lsn_t bad[5];
+    cdrom_paranoia_t *p = NULL;
+    lsn_t lsn;
+    int ok = 1;
+
+    for (i = 0; i < 5; i++)
+      bad[i] = first_lsn + 100 + i;
+    memset(&sim, 0, sizeof(sim));
+    sim.unreadable = bad;
+    sim.n_unreadable = 5;
+    d = open_sim(&sim);
+    if (d) {
+      p = paranoia_init(d);
+      paranoia_modeset(p, PARANOIA_MODE_FULL ^ PARANOIA_MODE_NEVERSKIP);
+      paranoia_seek(p, bad[0], SEEK_SET);
+      for (lsn = bad[0]; ok && lsn <= last_lsn; lsn++) {
+        int16_t *buf = paranoia_read_limited(p, callback, 20);
+        uint8_t copy[CDIO_CD_FRAMESIZE_RAW];
+
+        if (!buf) {
+          ok = 0;
+          break;
+        }
+        /* all of it, the sectors filled in for the skip included */
+        memcpy(copy, buf, sizeof(copy));
+        if (lsn > bad[4] &&
+            memcmp(copy, reference + (lsn - first_lsn) *
+                   CDIO_CD_FRAMESIZE_RAW, sizeof(copy)))
+          ok = 0;
+      }
+      paranoia_free(p);
+      cdda_close(d);
+    }
+    if (!p || !ok) {
+      printf("-- Skipping an unreadable stretch with no root failed\n");
+      failures++;
+    }
+  }
+
+  /* Paranoia sees through every test class. */
+  for (i = 0; i < (int)(sizeof(classes) / sizeof(classes[0])); i++) {
+    char what[40];
+    cdio_cddap_sim_init(&sim, classes[i]);
+    sim.seed = i + 1;
+    snprintf(what, sizeof(what), "test flags %d", classes[i]);
+    if (!rip_matches(what, &sim, 0, PARANOIA_SORTINDEX_BUCKETS))
+      failures++;
+  }
+  memset(&sim, 0, sizeof(sim));
+  sim.seed = 7;
+  sim.dropdupe_percent = 5;
+  sim.cache_sectors = 40;
+  if (!rip_matches("dropped samples with a cache", &sim, 0,
+                   PARANOIA_SORTINDEX_BUCKETS))
+    failures++;
+
+  /* The sorted sample index sees through jitter just as well. */
+  cdio_cddap_sim_init(&sim, CDDA_TEST_JITTER_LARGE | CDDA_TEST_FRAG_SMALL);
+  sim.seed = 11;
+  if (!rip_matches("sorted index", &sim, 0, PARANOIA_SORTINDEX_SORTED))
+    failures++;
+
+  /* A drive with C2 error pointers is trusted for what it doesn't
+     flag. */
+  memset(&sim, 0, sizeof(sim));
+  sim.c2 = 1;
+  if (!rip_matches("C2 error pointers", &sim, 1,
+                   PARANOIA_SORTINDEX_BUCKETS))
+    failures++;
+
+  /* Two passes find where a drive that mostly reads right didn't. */
+  memset(&sim, 0, sizeof(sim));
+  sim.seed = 3;
+  sim.jitter_bytes = 64;
+  sim.jitter_percent = 20;
+  if (!two_pass_matches("two passes", &sim))
+    failures++;
+
+  /* Scratches are put off, and everything else reads on past them. */
+  memset(&sim, 0, sizeof(sim));
+  sim.seed = 5;
+  sim.scratches = 2;
+  if (!deferred_matches("deferred scratches", &sim))
+    failures++;
+
+  /* Batches read what single sectors do, and say which were
+     skipped. */
+  memset(&sim, 0, sizeof(sim));
+  sim.seed = 5;
+  sim.scratches = 2;
+  if (!batch_matches("read_batch", &sim))
+    failures++;
+
+  /* Checksums come out the same however the samples are handed over,
+     and match AccurateRip's for the image. */
+  {
+    static const uint16_t one = 1;
+    int flags = PARANOIA_CHECKSUM_FIRST | PARANOIA_CHECKSUM_LAST |
+                (*(const uint8_t *)&one ? 0 : PARANOIA_CHECKSUM_BIGENDIAN);
+    long sectors = last_lsn - first_lsn + 1;
+    paranoia_checksum_t whole, parts;
+    long at, step;
+
+    paranoia_checksum_init(&whole, sectors, flags);
+    paranoia_checksum_add(&whole, reference, bytes);
+    paranoia_checksum_init(&parts, sectors, flags);
+    for (at = 0, step = 4; at < bytes; at += step, step += 1236)
+      paranoia_checksum_add(&parts, reference + at,
+                            step < bytes - at ? step : bytes - at);
+    if (whole.crc32 != parts.crc32 || whole.ar_v1 != parts.ar_v1 ||
+        whole.ar_v2 != parts.ar_v2 || whole.ar_v1 != 0x2ED9AF4E ||
+        whole.ar_v2 != 0x3C6EB129) {
+      printf("-- Checksums %08lx %08lx %08lx and %08lx %08lx %08lx\n",
+             (unsigned long) whole.crc32, (unsigned long) whole.ar_v1,
+             (unsigned long) whole.ar_v2, (unsigned long) parts.crc32,
+             (unsigned long) parts.ar_v1, (unsigned long) parts.ar_v2);
+      failures++;
+    }
+  }
+
+  /* Borrowed spans hold still while the root moves on. */
+  cdio_cddap_sim_init(&sim, CDDA_TEST_JITTER_SMALL);
+  sim.seed = 5;
+  if (!borrow_holds(&sim)) {
+    printf("-- A borrowed span didn't hold\n");
+    failures++;
+  }
+
+  /* The adaptive cache model finds the drive's cache size from how
+     long its seeks take, growing a model that is too small and
+     shrinking one that is too big, as far as the disc allows. */
+  memset(&sim, 0, sizeof(sim));
+  sim.cache_sectors = 100;
+  sim.seek_us = 20000;
+  if (!cache_adapts("small cache model", &sim, 20, 100, 200))
+    failures++;
+  sim.cache_sectors = 60;
+  if (!cache_adapts("big cache model", &sim, 300, 60, 299))
+    failures++;
+
+  /* A drive profile survives a save and use, with the other drives'
+     sections kept. */
+  if (!profile_round_trip()) {
+    printf("-- The drive profile didn't round-trip\n");
+    failures++;
+  }
+
+  free(reference);
+  if (failures)
+    return 1;
+  printf("-- Simulated drive OK\n");
+  return 0;
+}
@@ -0,0 +1,190 @@
+/*
+  Copyright (C) 2026 Rocky Bernstein <rocky@gnu.org>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Stress test for the thread-safety contract in cdda.h: many drive
+   objects, each read from its own thread with simulated jitter, must
+   all come back with exactly the data a plain single-threaded read
+   gives.  Half of the rips also use a paranoia reader thread, so the
+   error/message log is written and drained from different threads. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+# define __CDIO_CONFIG_H__ 1
+#endif
+
+#include <cdio/paranoia/cdda.h>
+#include <cdio/paranoia/paranoia.h>
+#include <stdio.h>
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#define SKIP_TEST_RC 77
+
+#ifndef HAVE_PTHREAD
+int
+main(int argc, const char *argv[])
+{
+  printf("-- No thread support; skipping.\n");
+  return SKIP_TEST_RC;
+}
+#else
+
+#include <pthread.h>
+
+#ifndef DATA_DIR
+#define DATA_DIR "./data"
+#endif
+
+#define NUM_THREADS 8
+#define NUM_PASSES  3
+
+static const char *cue_file = DATA_DIR "/cdda.cue";
+static uint8_t *reference = NULL;
+static lsn_t first_lsn, last_lsn;
+
+typedef struct {
+  int index;
+  int failures;
+} job_t;
+
+static void
+callback(long int inpos, paranoia_cb_mode_t function)
+{
+}
+
+static cdrom_drive_t *
+open_drive(void)
+{
+  cdrom_drive_t *d = cdda_identify(cue_file, CDDA_MESSAGE_FORGETIT, NULL);
+  if (!d)
+    return NULL;
+  cdda_verbose_set(d, CDDA_MESSAGE_LOGIT, CDDA_MESSAGE_LOGIT);
+  if (cdda_open(d)) {
+    cdda_close(d);
+    return NULL;
+  }
+  return d;
+}
+
+static void *
+rip(void *arg)
+{
+  job_t *job = arg;
+  int pass;
+
+  for (pass = 0; pass < NUM_PASSES; pass++) {
+    cdrom_drive_t *d = open_drive();
+    cdrom_paranoia_t *p;
+    lsn_t lsn;
+
+    if (!d) {
+      job->failures++;
+      continue;
+    }
+
+    /* The jitter models check_paranoia.sh uses: -x 5 and -x 69. */
+    d->i_test_flags = CDDA_TEST_JITTER_SMALL | CDDA_TEST_ALWAYS_JITTER;
+    if ((job->index + pass) & 1)
+      d->i_test_flags |= CDDA_TEST_UNDERRUN;
+
+    p = paranoia_init(d);
+    paranoia_modeset(p, PARANOIA_MODE_FULL ^ PARANOIA_MODE_NEVERSKIP);
+    if (job->index & 1)
+      cdio_paranoia_threaded(p, 2);
+    paranoia_seek(p, first_lsn, SEEK_SET);
+
+    for (lsn = first_lsn; lsn <= last_lsn; lsn++) {
+      int16_t *buf = paranoia_read_limited(p, callback, 20);
+      char *err = cdda_errors(d);
+      char *mes = cdda_messages(d);
+
+      cdio_cddap_free_messages(err);
+      cdio_cddap_free_messages(mes);
+      if (!buf || memcmp(buf, reference + (lsn - first_lsn) *
+                         CDIO_CD_FRAMESIZE_RAW, CDIO_CD_FRAMESIZE_RAW)) {
+        job->failures++;
+        break;
+      }
+    }
+
+    paranoia_free(p);
+    cdda_close(d);
+  }
+  return NULL;
+}
+
+int
+main(int argc, const char *argv[])
+{
+  cdrom_drive_t *d = open_drive();
+  pthread_t threads[NUM_THREADS];
+  job_t jobs[NUM_THREADS];
+  long sectors;
+  int i, failures = 0;
+
+  if (!d) {
+    printf("-- Unable to open %s\n", cue_file);
+    return SKIP_TEST_RC;
+  }
+
+  /* A plain read, no jitter, no paranoia, is the reference. */
+  first_lsn = cdda_disc_firstsector(d);
+  last_lsn = cdda_disc_lastsector(d);
+  sectors = last_lsn - first_lsn + 1;
+  reference = calloc(sectors, CDIO_CD_FRAMESIZE_RAW);
+  for (i = 0; i < sectors; i++)
+    if (cdda_read(d, reference + i * CDIO_CD_FRAMESIZE_RAW,
+                  first_lsn + i, 1) != 1) {
+      printf("-- Reference read of sector %ld failed\n",
+             (long) first_lsn + i);
+      cdda_close(d);
+      free(reference);
+      return 1;
+    }
+  cdda_close(d);
+
+  for (i = 0; i < NUM_THREADS; i++) {
+    jobs[i].index = i;
+    jobs[i].failures = 0;
+    if (pthread_create(&threads[i], NULL, rip, &jobs[i])) {
+      printf("-- Unable to start thread %d\n", i);
+      return 1;
+    }
+  }
+  for (i = 0; i < NUM_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    if (jobs[i].failures) {
+      printf("-- Thread %d: %d of %d rips differ from the reference\n",
+             i, jobs[i].failures, NUM_PASSES);
+      failures += jobs[i].failures;
+    }
+  }
+
+  free(reference);
+  if (failures)
+    return 1;
+  printf("-- %d threads x %d rips of %ld sectors matched\n",
+         NUM_THREADS, NUM_PASSES, sectors);
+  return 0;
+}
+#endif /* HAVE_PTHREAD */